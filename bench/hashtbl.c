@@ -0,0 +1,161 @@
+/*
+ * ww: a simple editor
+ * Copyright (C) 2026 malloc-nbytes
+ * Contact: zdhdev@yahoo.com
+
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, see <https://www.gnu.org/licenses/>.
+ */
+
+// Throughput of SET_DEFINE/MAP_DEFINE on string keys. Build and run with
+// `make bench' from src/.
+
+#include "set.h"
+#include "map.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+SET_IMPL(char *, cstr_set);
+
+MAP_DEFINE(const char *, size_t, cstr_map);
+MAP_IMPL(const char *, size_t, cstr_map);
+
+static unsigned
+set_hash(char **s)
+{
+        return hash_cstr(*s);
+}
+
+static int
+set_cmp(char **a, char **b)
+{
+        return strcmp(*a, *b);
+}
+
+static unsigned
+map_hash(const char **s)
+{
+        return hash_cstr(*s);
+}
+
+static int
+map_cmp(const char **a, const char **b)
+{
+        return strcmp(*a, *b);
+}
+
+static double
+now(void)
+{
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+// Identifier-like keys, the kind the editor indexes.
+static char **
+make_keys(size_t n,
+          const char *prefix)
+{
+        char **keys = (char **)malloc(sizeof(*keys) * n);
+
+        for (size_t i = 0; i < n; ++i) {
+                char buf[64];
+                snprintf(buf, sizeof(buf), "%s_%zx_%zu", prefix, i * 2654435761u, i);
+                keys[i] = strdup(buf);
+        }
+
+        return keys;
+}
+
+static void
+report(const char *what,
+       size_t      n,
+       double      secs)
+{
+        printf("  %-16s %8.1f ns/op\n", what, secs * 1e9 / (double)n);
+}
+
+static void
+bench(size_t n)
+{
+        char       **keys = make_keys(n, "word");
+        char       **miss = make_keys(n, "none");
+        cstr_set     set  = cstr_set_create(set_hash, set_cmp, NULL);
+        cstr_map     map  = cstr_map_create(map_hash, map_cmp);
+        size_t       hits = 0;
+        double       t;
+
+        printf("%zu keys\n", n);
+
+        t = now();
+        for (size_t i = 0; i < n; ++i)
+                cstr_set_insert(&set, keys[i]);
+        report("set insert", n, now() - t);
+
+        t = now();
+        for (size_t i = 0; i < n; ++i)
+                hits += (size_t)cstr_set_contains(&set, keys[i]);
+        report("set hit", n, now() - t);
+
+        t = now();
+        for (size_t i = 0; i < n; ++i)
+                hits += (size_t)cstr_set_contains(&set, miss[i]);
+        report("set miss", n, now() - t);
+
+        t = now();
+        for (size_t i = 0; i < n; i += 2)
+                cstr_set_remove(&set, keys[i]);
+        report("set remove", n/2, now() - t);
+
+        t = now();
+        for (size_t i = 0; i < n; ++i)
+                cstr_map_insert(&map, keys[i], i);
+        report("map insert", n, now() - t);
+
+        t = now();
+        for (size_t i = 0; i < n; ++i)
+                hits += *cstr_map_get(&map, keys[i]) == i;
+        report("map get", n, now() - t);
+
+        t = now();
+        for (size_t i = 0; i < n; ++i)
+                cstr_map_remove(&map, keys[i]);
+        report("map remove", n, now() - t);
+
+        // n hits and n/2 set entries left, anything else is a bug.
+        if (hits != n + n || cstr_set_size(&set) != n - (n+1)/2 || cstr_map_size(&map) != 0) {
+                fprintf(stderr, "bench: wrong results\n");
+                exit(1);
+        }
+
+        cstr_set_destroy(&set);
+        cstr_map_destroy(&map);
+        for (size_t i = 0; i < n; ++i) {
+                free(keys[i]);
+                free(miss[i]);
+        }
+        free(keys);
+        free(miss);
+}
+
+int
+main(void)
+{
+        bench(1000);
+        bench(100000);
+        bench(1000000);
+        return 0;
+}
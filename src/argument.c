@@ -130,6 +130,8 @@ usage(void)
         printf("  -v, --version          show only version information\n");
         printf("      --copying          show copying information\n");
         printf("      --create-config    create a default configuration file\n");
+        printf("      --restore          reopen the buffers of the last session in this directory\n");
+        printf("                         and save them again on exit\n");
         exit(0);
 }
 
@@ -186,6 +188,10 @@ parse_2hy_option(argument **a)
                 copying();
         if (!strcmp(s, FLAG_2HY_CREATECONFIG))
                 create_config();
+        if (!strcmp(s, FLAG_2HY_RESTORE)) {
+                glconf.prelude.restore = 1;
+                return;
+        }
         if (!strcmp(s, FLAG_2HY_VERSION))
                 version();
         else
@@ -29,10 +29,14 @@
 #include "helpbuf.h"
 #include "flags.h"
 #include "utils.h"
-#include "trie.h"
-#include "set.h"
+#include "wordindex.h"
 #include "art.h"
 #include "confirmbox.h"
+#include "compile.h"
+#include "symindex.h"
+#include "colidx.h"
+#include "killring.h"
+#include "clipboard.h"
 
 #include <assert.h>
 #include <stdio.h>
@@ -47,13 +51,271 @@
 #include <poll.h>
 
 #define TAB_WIDTH        8
-#define MAX_AUTOCOMPLETE 32
+// Words only found in other buffers rank as if they were this many
+// lines away.
+#define AC_FOREIGN_DIST ((size_t)1 << 16)
+// Edits scattered over more places than this put their words back
+// into the index without waiting for a completion.
+#define AC_DIRTY_RUNS_MAX 64
 
 PAIR_DEFINE (int, int, int_pair);
 PAIR_IMPL   (int, int, int_pair);
 ARRAY_DEFINE(int_pair, int_pair_ar);
 
-SET_IMPL(char *, cstr_set);
+// First marker at or after `row'.
+static size_t
+marker_lower_bound(const buffer *b,
+                   size_t        row)
+{
+        size_t lo = 0, hi = b->markers.len;
+
+        while (lo < hi) {
+                size_t mid = lo + (hi-lo)/2;
+                if (b->markers.data[mid].row < row)
+                        lo = mid+1;
+                else
+                        hi = mid;
+        }
+
+        return lo;
+}
+
+static const buffer_marker *
+marker_at_row(const buffer *b,
+              size_t        row)
+{
+        size_t i = marker_lower_bound(b, row);
+
+        if (i < b->markers.len && b->markers.data[i].row == row)
+                return &b->markers.data[i];
+        return NULL;
+}
+
+void
+buffer_add_marker(buffer     *b,
+                  size_t      row,
+                  unsigned    col,
+                  int         sev,
+                  const char *msg)
+{
+        buffer_marker m = (buffer_marker) {
+                .row = row,
+                .col = col,
+                .sev = sev,
+                .msg = strdup(msg ? msg : ""),
+        };
+
+        // Keep rows sorted, equal rows in insertion order.
+        array_insert_at(b->markers, marker_lower_bound(b, row+1), m);
+}
+
+void
+buffer_clear_markers(buffer *b)
+{
+        for (size_t i = 0; i < b->markers.len; ++i)
+                free(b->markers.data[i].msg);
+        array_clear(b->markers);
+}
+
+// Lines were inserted before `at': markers move down with their text.
+static void
+markers_lines_inserted(buffer *b,
+                       size_t  at,
+                       size_t  n)
+{
+        for (size_t i = marker_lower_bound(b, at); i < b->markers.len; ++i)
+                b->markers.data[i].row += n;
+}
+
+// Lines [at, at+n) went away. With `join', their text was appended to
+// line at-1 and the markers follow it, otherwise they are dropped.
+static void
+markers_lines_removed(buffer *b,
+                      size_t  at,
+                      size_t  n,
+                      int     join)
+{
+        size_t w = 0;
+
+        for (size_t i = 0; i < b->markers.len; ++i) {
+                buffer_marker m = b->markers.data[i];
+
+                if (m.row >= at + n) {
+                        m.row -= n;
+                } else if (m.row >= at) {
+                        if (!join || at == 0) {
+                                free(m.msg);
+                                continue;
+                        }
+                        m.row = at-1;
+                }
+                b->markers.data[w++] = m;
+        }
+        b->markers.len = w;
+}
+
+// Where `row' went once rows [at, at+n) were inserted, or removed
+// with `gone'. Rows that were removed land on the first row after.
+static size_t
+row_moved(size_t row,
+          size_t at,
+          size_t n,
+          int    gone)
+{
+        if (row < at)
+                return row;
+        if (!gone)
+                return row + n;
+        return row >= at + n ? row - n : at;
+}
+
+// Keep the views that are not being edited through on the same text.
+// They are clamped to the buffer once they are used (buffer_view_use).
+static void
+views_rows_moved(buffer *b,
+                 size_t  at,
+                 size_t  n,
+                 int     gone)
+{
+        for (size_t i = 0; i <= b->views.len; ++i) {
+                buffer_view *w = i < b->views.len ? b->views.data[i] : &b->home;
+
+                if (w == b->v)
+                        continue;
+
+                w->al   = row_moved(w->al, at, n, gone);
+                w->cy   = (unsigned)row_moved(w->cy, at, n, gone);
+                w->sy   = (unsigned)row_moved(w->sy, at, n, gone);
+                w->voff = row_moved(w->voff, at, n, gone);
+        }
+}
+
+// First run of `d' that ends at or after `row'.
+static size_t
+ac_run_at(const row_run_ar *d,
+          size_t            row)
+{
+        size_t lo = 0;
+        size_t hi = d->len;
+
+        while (lo < hi) {
+                size_t mid = lo + (hi - lo)/2;
+
+                if (d->data[mid].to < row)
+                        lo = mid + 1;
+                else
+                        hi = mid;
+        }
+
+        return lo;
+}
+
+// Add rows [from, to) to the dirty runs, joining the ones they touch.
+static void
+ac_mark(row_run_ar *d,
+        size_t      from,
+        size_t      to)
+{
+        size_t  i = ac_run_at(d, from);
+        size_t  j = i;
+        row_run r = { .from = from, .to = to };
+
+        for (; j < d->len && d->data[j].from <= to; ++j) {
+                if (d->data[j].from < r.from)
+                        r.from = d->data[j].from;
+                if (d->data[j].to > r.to)
+                        r.to = d->data[j].to;
+        }
+
+        array_splice(*d, i, j - i, &r, 1);
+}
+
+// New rows have no words in the index yet. Removed ones were
+// forgotten before they went. Only the runs from `at' on move.
+static void
+ac_rows_moved(buffer *b,
+              size_t  at,
+              size_t  n,
+              int     gone)
+{
+        row_run_ar *d = &b->ac_dirty;
+        size_t      i = ac_run_at(d, at);
+        size_t      w = i;
+
+        if (!gone) {
+                for (; i < d->len; ++i) {
+                        if (d->data[i].from >= at)
+                                d->data[i].from += n;
+                        if (d->data[i].to > at)
+                                d->data[i].to += n;
+                }
+                ac_mark(d, at, at + n);
+                return;
+        }
+
+        for (; i < d->len; ++i) {
+                row_run r = {
+                        .from = row_moved(d->data[i].from, at, n, 1),
+                        .to   = row_moved(d->data[i].to, at, n, 1),
+                };
+
+                if (r.from == r.to)
+                        continue;
+                if (w > 0 && d->data[w-1].to == r.from)
+                        d->data[w-1].to = r.to;
+                else
+                        d->data[w++] = r;
+        }
+        d->len = w;
+}
+
+static void
+rows_inserted(buffer *b,
+              size_t  at,
+              size_t  n)
+{
+        markers_lines_inserted(b, at, n);
+        views_rows_moved(b, at, n, 0);
+        ac_rows_moved(b, at, n, 0);
+}
+
+static void
+rows_removed(buffer *b,
+             size_t  at,
+             size_t  n,
+             int     join)
+{
+        markers_lines_removed(b, at, n, join);
+        views_rows_moved(b, at, n, 1);
+        ac_rows_moved(b, at, n, 1);
+}
+
+static void
+markers_lines_swapped(buffer *b,
+                      size_t  r0,
+                      size_t  r1)
+{
+        int moved = 0;
+
+        for (size_t i = 0; i < b->markers.len; ++i) {
+                buffer_marker *m = &b->markers.data[i];
+                if (m->row == r0)
+                        m->row = r1, moved = 1;
+                else if (m->row == r1)
+                        m->row = r0, moved = 1;
+        }
+
+        // Only two adjacent rows changed places, insertion sort is enough.
+        for (size_t i = 1; moved && i < b->markers.len; ++i) {
+                buffer_marker m = b->markers.data[i];
+                size_t j = i;
+                while (j > 0 && b->markers.data[j-1].row > m.row) {
+                        b->markers.data[j] = b->markers.data[j-1];
+                        --j;
+                }
+                b->markers.data[j] = m;
+        }
+}
 
 static int
 line_selection_range(const buffer *b,
@@ -70,8 +332,6 @@ static buffer_action right(buffer *b);
 static buffer_action left(buffer *b);
 static buffer_action tab(buffer *b, int add_multiplier);
 
-char_ar g_cpy_buf = {0};
-
 char *
 buffer_to_cstr(const buffer *b)
 {
@@ -94,7 +354,7 @@ buffer_to_cstr(const buffer *b)
 void
 buffer_append_cstr(buffer *b, char *s)
 {
-        linep_ar lns = lines_from(s);
+        linep_ar lns = lines_from(b->pool, s);
         for (size_t i = 0; i < lns.len; ++i)
                 array_append(b->lines, lns.data[i]);
         array_free(lns);
@@ -117,17 +377,17 @@ find_next_expand_region(buffer *b,
         char start;
         int  stack;
 
-        start = str_at(&b->lines.data[b->al]->txt, b->cx);
+        start = str_at(&b->lines.data[b->v->al]->txt, b->v->cx);
         stack = 1;
 
         right(b);
 
-        for (size_t i = b->al; i < b->lines.len; ++i) {
+        for (size_t i = b->v->al; i < b->lines.len; ++i) {
                 const line *ln   = b->lines.data[i];
                 const str  *s    = &ln->txt;
                 size_t      j    = 0;
 
-                for (j = i == b->al ? b->cx : 0; j < str_len(s); ++j) {
+                for (j = i == b->v->al ? b->v->cx : 0; j < str_len(s); ++j) {
                         char ch = str_at(s, j);
 
                         if (start == '(' && ch == ')')
@@ -159,45 +419,60 @@ find_next_expand_region(buffer *b,
         return 0;
 }
 
+static void
+ac_session_reset(buffer *b)
+{
+        b->ac_sess.words_n = 0;
+        b->ac_sess.cycle   = 0;
+}
+
 static void
 collect_ac_from_buffer(buffer *b)
 {
-#define BUFCAP 1024
-        for (size_t i = 0; i < b->lines.len; ++i) {
-                const line *ln = b->lines.data[i];
-                const str *s = &ln->txt;
-                const char *sraw = str_cstr(s);
-                int foundalpha = 0;
-                char buf[BUFCAP] = {0};
-                size_t bufn = 0;
-
-                for (size_t j = 0; j < s->len; ++j) {
-                        char ch = sraw[j];
-
-                        if (!isalpha(ch) && ch != '_') {
-                                if (foundalpha) {
-                                        if (!cstr_set_contains(&b->found_words, buf)) {
-                                                char *word = strdup(buf);
-                                                cstr_set_insert(&b->found_words, word);
-                                                trie_insert(b->ac, word);
-                                        }
-                                        bufn = 0;
-                                        memset(buf, 0, sizeof(buf));
-                                }
-                        } else if (bufn < BUFCAP) {
-                                buf[bufn++] = ch;
-                                foundalpha = 1;
-                        }
-                }
+        ac_session_reset(b);
+        wordindex_update(&b->ac_refs, &b->lines);
+        array_clear(b->ac_dirty);
+}
 
-                if (strlen(buf) && !cstr_set_contains(&b->found_words, buf)) {
-                        char *word = strdup(buf);
-                        cstr_set_insert(&b->found_words, word);
-                        trie_insert(b->ac, word);
-                }
+// Take the words of rows [first, last] out of the index before they are
+// edited, ac_flush puts them back once they are needed. Rows already
+// out, mostly the one typed in, are left alone.
+static void
+ac_forget(buffer *b,
+          size_t  first,
+          size_t  last)
+{
+        row_run_ar *d    = &b->ac_dirty;
+        row_run_ar  gaps = array_empty(row_run_ar);
+        size_t      to   = last < b->lines.len ? last + 1 : b->lines.len;
+        size_t      r    = first;
+
+        if (first >= to)
+                return;
+
+        for (size_t i = ac_run_at(d, first); r < to && i < d->len && d->data[i].from < to; ++i) {
+                if (d->data[i].from > r)
+                        array_append(gaps, ((row_run) { .from = r, .to = d->data[i].from }));
+                if (d->data[i].to > r)
+                        r = d->data[i].to;
+        }
+
+        if (r < to)
+                array_append(gaps, ((row_run) { .from = r, .to = to }));
+
+        if (gaps.len) {
+                wordindex_remove_rows(&b->ac_refs, &b->lines, gaps.data, gaps.len);
+                ac_mark(d, first, to);
         }
 
-#undef BUFCAP
+        array_free(gaps);
+}
+
+static void
+ac_flush(buffer *b)
+{
+        wordindex_add_rows(&b->ac_refs, &b->lines, b->ac_dirty.data, b->ac_dirty.len);
+        array_clear(b->ac_dirty);
 }
 
 void
@@ -205,29 +480,123 @@ buffer_jump_to_verts(buffer *b,
                      size_t  x,
                      size_t  y)
 {
+        buffer_ensure_loaded(b);
+
         if (y > b->lines.len-1)
                 return;
         if (x > b->lines.data[y]->txt.len-1)
-                return;
-        b->cx       = (unsigned)x;
-        b->cy       = (unsigned)y;
-        b->al       = (unsigned)y;
-        b->wish_col = (unsigned)x;
+                x = b->lines.data[y]->txt.len-1;
+        b->v->cx       = (unsigned)x;
+        b->v->cy       = (unsigned)y;
+        b->v->al       = (unsigned)y;
+        b->v->wish_col = (unsigned)x;
         buffer_adjust_scroll(b);
 }
 
 void
 buffer_free(buffer *b)
 {
+        for (size_t i = 0; i < b->views.len; ++i)
+                free(b->views.data[i]);
+        array_free(b->views);
         str_destroy(&b->name);
         str_destroy(&b->path);
         str_destroy(&b->last_search);
-        cstr_set_destroy(&b->found_words);
-        trie_destroy(b->ac);
+        wordindex_release(&b->ac_refs);
+        array_free(b->ac_dirty);
+        str_destroy(&b->ac_sess.prefix);
+        buffer_clear_markers(b);
+        array_free(b->markers);
+        buffer_clear_lines(b);
+        array_free(b->lines);
+        slab_pool_destroy(b->pool);
 
         free(b);
 }
 
+// Another view of `b', starting where its current view is. Views only
+// hold a place in the text, the lines stay shared by all of them.
+buffer_view *
+buffer_view_open(buffer *b)
+{
+        buffer_view *v = (buffer_view *)alloc(sizeof(buffer_view));
+
+        *v = *b->v;
+        array_append(b->views, v);
+
+        return v;
+}
+
+void
+buffer_view_close(buffer_view *v)
+{
+        buffer *b = v->buf;
+
+        if (v == &b->home)
+                return;
+
+        for (size_t i = 0; i < b->views.len; ++i) {
+                if (b->views.data[i] == v) {
+                        array_rm_at(b->views, i);
+                        break;
+                }
+        }
+
+        if (b->v == v)
+                b->v = &b->home;
+
+        free(v);
+}
+
+// Edit and draw `v's buffer through `v' from now on. The text may
+// have changed through another view, so the cursor is put back in it.
+buffer *
+buffer_view_use(buffer_view *v)
+{
+        buffer *b = v->buf;
+
+        b->v = v;
+
+        if (b->lines.len == 0)
+                return b;
+
+        if (v->al >= b->lines.len)
+                v->al = b->lines.len-1;
+        if (v->cy > v->al)
+                v->cy = (unsigned)v->al;
+        if (v->sy >= b->lines.len)
+                v->sy = (unsigned)b->lines.len-1;
+        if (v->voff > v->al)
+                v->voff = v->al;
+        if (v->cx >= b->lines.data[v->al]->txt.len)
+                v->cx = b->lines.data[v->al]->txt.len
+                        ? (unsigned)b->lines.data[v->al]->txt.len-1 : 0;
+
+        return b;
+}
+
+// Free all lines at once: the buffer's own go with its slabs, only text
+// that outgrew its line and lines from other pools are freed one by one.
+void
+buffer_clear_lines(buffer *b)
+{
+        killring_release(b);
+
+        for (size_t i = 0; i < b->lines.len; ++i) {
+                line *ln = b->lines.data[i];
+
+                // The pool reset takes the lines themselves, but text
+                // that spilled to the heap and column indexes go here.
+                if (slab_owner(ln) != b->pool)
+                        line_free(ln);
+                else if (!str_is_inline(&ln->txt) || ln->txt.len >= COLIDX_MIN)
+                        str_destroy(&ln->txt);
+        }
+
+        slab_pool_reset(b->pool);
+        array_clear(b->lines);
+}
+
 void
 buffer_make_builtin(buffer *b)
 {
@@ -268,7 +637,7 @@ ww_helpbuf_alloc(unsigned  w,
 
         b = buffer_from(str_from(BUFFER_BUILTIN_HELP),
                         str_from(BUFFER_BUILTIN_HELP),
-                        w, h, ws, hs, lines_from(data.chars),
+                        w, h, ws, hs, lines_from(NULL, data.chars),
                         parent);
 
         buffer_make_readonly(b);
@@ -279,18 +648,6 @@ ww_helpbuf_alloc(unsigned  w,
         return b;
 }
 
-static unsigned
-cstr_set_hash(char **s)
-{
-        return (unsigned)**s;
-}
-
-static int
-cstr_set_cmp(char **s0, char **s1)
-{
-        return strcmp(*s0, *s1);
-}
-
 buffer *
 buffer_from(str      name,
             str      path,
@@ -307,35 +664,162 @@ buffer_from(str      name,
         b->name        = name;
         b->path        = path;
         b->builtin     = 0;
-        b->size.w      = w;
-        b->size.h      = h;
-        b->size.ws     = ws;
-        b->size.hs     = hs;
+        b->pool        = slab_pool_create();
         b->lines       = lns;
-        b->cx          = 0;
-        b->cy          = 0;
-        b->wish_col    = 0;
-        b->al          = 0;
-        b->hoff        = 0;
-        b->voff        = 0;
-        b->state       = BS_NORMAL;
+        b->home        = (buffer_view) {
+                .buf   = b,
+                .size  = { .w = w, .h = h, .ws = ws, .hs = hs },
+                .state = BS_NORMAL,
+        };
+        b->v           = &b->home;
+        b->views       = array_empty(buffer_viewp_ar);
         b->saved       = 1;
-        b->sx          = 0;
-        b->sy          = 0;
         b->writable    = 1;
         b->last_search = str_create();
         b->parent      = parent;
         b->last_tab    = 0;
-        b->ac          = trie_alloc();
-        b->ac_cycle    = 0;
-        b->found_words = cstr_set_create(cstr_set_hash, cstr_set_cmp, NULL);
+        b->ac_refs     = array_empty(wordref_ar);
+        b->ac_dirty    = array_empty(row_run_ar);
+        b->ac_sess     = (buffer_ac_session) {
+                .prefix  = str_create(),
+                .words_n = 0,
+                .cycle   = 0,
+        };
         b->paste       = 0;
+        b->yanked      = 0;
+        b->yank_y      = 0;
+        b->yank_x      = 0;
+        b->markers     = array_empty(buffer_marker_ar);
+        b->mru_prev    = NULL;
+        b->mru_next    = NULL;
+        b->reg_path    = NULL;
+        b->evicted     = 0;
+        b->stamped     = 0;
+
+        collect_ac_from_buffer(b);
+
+        return b;
+}
+
+static linep_ar
+read_lines(slab_pool  *pool,
+           const char *path,
+           file_stamp *stamp,
+           int        *stamped)
+{
+        const char *data;
+        size_t      n;
+        linep_ar    lns;
+
+        // Stamp first: a write racing the read then only makes the
+        // buffer look modified on disk, never the other way around.
+        *stamped = file_stamp_get(path, stamp);
+
+        if (!(data = map_file(path, &n))) {
+                *stamped = 0;
+                return array_empty(linep_ar);
+        }
+
+        lns = lines_from_n(pool, data, n);
+        unmap_file(data, n);
+
+        return lns;
+}
+
+// A buffer for the file at `path', remembering which version of the
+// file it holds so it can later be evicted and read back.
+buffer *
+buffer_load(str       name,
+            str       path,
+            unsigned  w,
+            unsigned  h,
+            unsigned  ws,
+            unsigned  hs,
+            ww       *parent)
+{
+        buffer *b;
+
+        // Empty first, so the lines can go straight into its pool.
+        b        = buffer_from(name, path, w, h, ws, hs, array_empty(linep_ar), parent);
+        b->lines = read_lines(b->pool, str_cstr(&b->path), &b->stamp, &b->stamped);
 
         collect_ac_from_buffer(b);
 
         return b;
 }
 
+// Like buffer_load, but the file is not read until the buffer is first
+// shown.
+buffer *
+buffer_load_deferred(str       name,
+                     str       path,
+                     unsigned  w,
+                     unsigned  h,
+                     unsigned  ws,
+                     unsigned  hs,
+                     ww       *parent)
+{
+        buffer *b;
+
+        b          = buffer_from(name, path, w, h, ws, hs, array_empty(linep_ar), parent);
+        b->evicted = 1;
+
+        return b;
+}
+
+// Drop the text of a buffer that is identical to its file, keeping the
+// cursor and scroll position. Returns 1 if it was dropped.
+int
+buffer_evict(buffer *b)
+{
+        file_stamp now;
+
+        if (b->evicted || b->builtin || !b->saved || !b->stamped || b->v->state != BS_NORMAL)
+                return 0;
+
+        if (!file_stamp_get(str_cstr(&b->path), &now) || !file_stamp_eq(&now, &b->stamp))
+                return 0;
+
+        buffer_clear_lines(b);
+        array_free(b->lines);
+        b->lines = array_empty(linep_ar);
+
+        wordindex_release(&b->ac_refs);
+        b->ac_refs = array_empty(wordref_ar);
+        array_clear(b->ac_dirty);
+        ac_session_reset(b);
+
+        b->evicted = 1;
+
+        return 1;
+}
+
+void
+buffer_ensure_loaded(buffer *b)
+{
+        if (!b->evicted)
+                return;
+
+        b->lines   = read_lines(b->pool, str_cstr(&b->path), &b->stamp, &b->stamped);
+        b->evicted = 0;
+
+        // The file may have changed while it was out of memory.
+        if (b->lines.len == 0) {
+                b->v->al = b->v->cx = b->v->cy = b->v->wish_col = 0;
+                b->v->voff = b->v->hoff = 0;
+        } else {
+                if (b->v->al >= b->lines.len)
+                        b->v->al = b->lines.len-1;
+                if (b->v->cx >= b->lines.data[b->v->al]->txt.len)
+                        b->v->cx = (unsigned)b->lines.data[b->v->al]->txt.len-1;
+                if (b->v->voff > b->v->al)
+                        b->v->voff = b->v->al;
+                b->v->cy = (unsigned)b->v->al;
+        }
+
+        collect_ac_from_buffer(b);
+}
+
 void
 buffer_make_readonly(buffer *b)
 {
@@ -347,23 +831,29 @@ static int_ar
 find_line_matches(const buffer *b,
                   const str    *s)
 {
-        assert(b->state == BS_SEARCH);
+        assert(b->v->state == BS_SEARCH);
 
         static int_ar     ar;
-        const char       *sraw;
         const char       *query;
+        size_t            qlen;
 
         ar    = array_empty(int_ar);
-        sraw  = str_cstr(s);
-        query = str_cstr(&b->last_search);
+        query = b->last_search.chars;
+        qlen  = str_len(&b->last_search);
 
-        if (!sraw || !query || !str_len(&b->last_search))
+        if (!query || !qlen)
                 return ar;
 
-        for (size_t i = 0; i < str_len(s); ++i) {
-                if (!memcmp(query, sraw+i, str_len(&b->last_search))) {
+        // The line may be the one with a gap.
+        for (size_t i = 0; i + qlen <= str_len(s); ++i) {
+                size_t k = 0;
+
+                while (k < qlen && str_at(s, i+k) == query[k])
+                        ++k;
+
+                if (k == qlen) {
                         array_append(ar, (int)i);
-                        i += str_len(&b->last_search)-1;
+                        i += qlen-1;
                 }
         }
 
@@ -396,11 +886,11 @@ buffer_search(buffer *b, int reverse)
         int         adjust;
 
         input       = &b->last_search;
-        b->state    = BS_SEARCH;
+        b->v->state = BS_SEARCH;
         first       = 1;
-        old_cx      = b->cx;
-        old_cy      = b->cy;
-        old_al      = b->al;
+        old_cx      = b->v->cx;
+        old_cy      = b->v->cy;
+        old_al      = b->v->al;
         step        = 0;
         adjust      = 1;
 
@@ -411,7 +901,7 @@ buffer_search(buffer *b, int reverse)
                         step = 0;
 
                         for (size_t i = 0; i < pairs.len; ++i) {
-                                if (pairs.data[i].l < (int)b->al)
+                                if (pairs.data[i].l < (int)b->v->al)
                                         ++step;
                                 else
                                         break;
@@ -426,17 +916,17 @@ buffer_search(buffer *b, int reverse)
                 adjust = 0;
 
                 if (pairs.len > 0 && step < (int)pairs.len) {
-                        b->al = (size_t)pairs.data[step].l;
-                        b->cy = (unsigned)pairs.data[step].l;
-                        b->cx = (unsigned)pairs.data[step].r;
+                        b->v->al = (size_t)pairs.data[step].l;
+                        b->v->cy = (unsigned)pairs.data[step].l;
+                        b->v->cx = (unsigned)pairs.data[step].r;
                         buffer_adjust_scroll(b);
                 }
 
                 buffer_center_view(b);
                 buffer_draw(b);
 
-                gotoxy(0, b->size.h);
-                clear_line(0, b->size.h);
+                gotoxy(0, b->v->size.h);
+                clear_line(0, b->v->size.h);
                 printf("Search [ %s", str_cstr(input));
                 fflush(stdout);
 
@@ -444,26 +934,26 @@ buffer_search(buffer *b, int reverse)
                 if (ty == INPUT_TYPE_NORMAL) {
                         if (first && (BACKSPACE(ch)
                                       || (ty == INPUT_TYPE_NORMAL && ch != '\n'))) {
-                                b->cx = old_cx; b->cy = old_cy; b->al = old_al;
+                                b->v->cx = old_cx; b->v->cy = old_cy; b->v->al = old_al;
                                 str_clear(&b->last_search);
                                 first  = 0;
                                 adjust = 1;
                         }
                         if (BACKSPACE(ch)) {
-                                b->cx = old_cx; b->cy = old_cy; b->al = old_al;
+                                b->v->cx = old_cx; b->v->cy = old_cy; b->v->al = old_al;
                                 if (str_len(input) > 0)
                                         str_pop(input);
                                 adjust = 1;
                         } else if (ENTER(ch)) {
                                 if (pairs.len > 0 && step < (int)pairs.len) {
-                                        b->al       = (size_t)pairs.data[step].l;
-                                        b->cy       = (unsigned)pairs.data[step].l;
-                                        b->cx       = (unsigned)pairs.data[step].r;
-                                        b->wish_col = b->cx;
+                                        b->v->al       = (size_t)pairs.data[step].l;
+                                        b->v->cy       = (unsigned)pairs.data[step].l;
+                                        b->v->cx       = (unsigned)pairs.data[step].r;
+                                        b->v->wish_col = b->v->cx;
                                 }
                                 break;
                         } else {
-                                b->cx = old_cx; b->cy = old_cy; b->al = old_al;
+                                b->v->cx = old_cx; b->v->cy = old_cy; b->v->al = old_al;
                                 adjust = 1;
                                 str_append(input, ch);
                         }
@@ -473,22 +963,26 @@ buffer_search(buffer *b, int reverse)
                 } else if (ty == INPUT_TYPE_CTRL && ch == CTRL_R) {
                         if (step > 0)
                                 --step;
-                } else if (ty == INPUT_TYPE_CTRL && ch == CTRL_Y && g_cpy_buf.len > 0) {
+                } else if (ty == INPUT_TYPE_CTRL && ch == CTRL_Y && killring_current()) {
+                        const kill_entry *e = killring_current();
+
                         if (first) {
-                                b->cx = old_cx; b->cy = old_cy; b->al = old_al;
+                                b->v->cx = old_cx; b->v->cy = old_cy; b->v->al = old_al;
                                 str_clear(&b->last_search);
                                 first  = 0;
                                 adjust = 1;
                         }
-                        for (size_t i = 0; i < g_cpy_buf.len; ++i)
-                                str_append(input, g_cpy_buf.data[i]);
+                        for (size_t i = 0; i < killring_runs(e); ++i) {
+                                sv run = killring_run(e, i);
+                                str_append_n(input, run.s, run.len);
+                        }
                 } else {
-                        b->cx = old_cx; b->cy = old_cy; b->al = old_al;
+                        b->v->cx = old_cx; b->v->cy = old_cy; b->v->al = old_al;
                         break;
                 }
         }
 
-        b->state = BS_NORMAL;
+        b->v->state = BS_NORMAL;
 
         buffer_center_view(b);
         buffer_adjust_scroll(b);
@@ -506,16 +1000,10 @@ writable(const buffer *b)
         return 1;
 }
 
-static void
-clear_cpy(void)
-{
-        array_clear(g_cpy_buf);
-}
-
 static const char *
 state_to_cstr(const buffer *b)
 {
-        switch (b->state) {
+        switch (b->v->state) {
         case BS_NORMAL:    return "normal";
         case BS_SELECTION: return "selection";
         case BS_SEARCH:    return "search";
@@ -529,9 +1017,12 @@ visual_column(const str *s,
               size_t     char_idx,
               unsigned   tab_width)
 {
+        if (s->len >= COLIDX_MIN)
+                return (unsigned)colidx_column(s, char_idx, tab_width);
+
         unsigned col = 0;
         for (size_t i = 0; i < char_idx && i < s->len; ++i) {
-                if (s->chars[i] == '\t') {
+                if (str_at(s, i) == '\t') {
                         col += tab_width - (col % tab_width);
                 } else {
                         ++col;
@@ -553,12 +1044,15 @@ char_index_at_visual_col(const str *s,
                          unsigned   target_col,
                          unsigned   tab_width)
 {
+        if (s->len >= COLIDX_MIN)
+                return colidx_index(s, target_col, tab_width);
+
         // Find the character index for a given visual column
         unsigned col = 0;
         for (size_t i = 0; i < s->len; ++i) {
                 if (col >= target_col)
                         return i;
-                if (s->chars[i] == '\t') {
+                if (str_at(s, i) == '\t') {
                         col += tab_width - (col % tab_width);
                 } else {
                         ++col;
@@ -570,22 +1064,22 @@ char_index_at_visual_col(const str *s,
 static void
 adjust_cursor(buffer *b)
 {
-        const str *s = &b->lines.data[b->al]->txt;
-        unsigned   x = visual_column(s, b->cx, TAB_WIDTH);
-        gotoxy(b->size.ws + (unsigned)(x > b->hoff ? x - b->hoff : 0U),
-               b->size.hs + (unsigned)(b->cy - b->voff));
+        const str *s = &b->lines.data[b->v->al]->txt;
+        unsigned   x = visual_column(s, b->v->cx, TAB_WIDTH);
+        gotoxy(b->v->size.ws + (unsigned)(x > b->v->hoff ? x - b->v->hoff : 0U),
+               b->v->size.hs + (unsigned)(b->v->cy - b->v->voff));
 }
 
 static unsigned
 get_win_hight(const buffer *b)
 {
-        return b->size.h > 0 ? b->size.h - 1 - b->size.hs : 0;
+        return b->v->size.h > 0 ? b->v->size.h - 1 - b->v->size.hs : 0;
 }
 
 static unsigned
 get_win_width(const buffer *b)
 {
-        return b->size.w > 0 ? b->size.w : 80;
+        return b->v->size.w > 0 ? b->v->size.w : 80;
 }
 
 static int
@@ -593,11 +1087,11 @@ adjust_vscroll(buffer *b)
 {
         size_t win_h = get_win_hight(b);
 
-        if (b->cy < b->voff) {
-                b->voff = b->cy;
+        if (b->v->cy < b->v->voff) {
+                b->v->voff = b->v->cy;
                 return 1;
-        } else if (b->cy >= b->voff + win_h) {
-                b->voff = b->cy - win_h + 1;
+        } else if (b->v->cy >= b->v->voff + win_h) {
+                b->v->voff = b->v->cy - win_h + 1;
                 return 1;
         }
         return 0;
@@ -607,16 +1101,16 @@ static int
 adjust_hscroll(buffer *b)
 {
         const unsigned  tabw  = TAB_WIDTH;
-        const str      *s     = &b->lines.data[b->al]->txt;
+        const str      *s     = &b->lines.data[b->v->al]->txt;
         unsigned        win_w = get_win_width(b);
 
-        unsigned cursor_visual = visual_column(s, b->cx, tabw);
+        unsigned cursor_visual = visual_column(s, b->v->cx, tabw);
 
-        if (cursor_visual < b->hoff) {
-                b->hoff = cursor_visual;
+        if (cursor_visual < b->v->hoff) {
+                b->v->hoff = cursor_visual;
                 return 1;
-        } else if (cursor_visual >= b->hoff + win_w) {
-                b->hoff = cursor_visual - win_w + 1;
+        } else if (cursor_visual >= b->v->hoff + win_w) {
+                b->v->hoff = cursor_visual - win_w + 1;
                 return 1;
         }
         return 0;
@@ -633,16 +1127,19 @@ buffer_adjust_scroll(buffer *b)
         return res ? BA_REDRAW : BA_NOP;
 }
 
+// Delete the selection. With `taken', the lines after the first that
+// it removes are appended there instead of being freed, unchanged.
 static buffer_action
-del_selection(buffer *b)
+remove_selection(buffer   *b,
+                 linep_ar *taken)
 {
-        if (b->state != BS_SELECTION)
+        if (b->v->state != BS_SELECTION)
                 return BA_NOP;
 
-        size_t anchor_y = (size_t)b->sy;
-        size_t anchor_x = (size_t)b->sx;
-        size_t cursor_y = b->al;
-        size_t cursor_x = b->cx;
+        size_t anchor_y = (size_t)b->v->sy;
+        size_t anchor_x = (size_t)b->v->sx;
+        size_t cursor_y = b->v->al;
+        size_t cursor_x = b->v->cx;
 
         // normalize
         int forward = (anchor_y < cursor_y) ||
@@ -657,178 +1154,167 @@ del_selection(buffer *b)
                 goto cleanup;
 
         b->saved = 0;
+        ac_forget(b, start_y, end_y);
 
         if (start_y == end_y) {
                 // single-line deletion
                 line *ln = b->lines.data[start_y];
 
-                size_t remove_count = end_x - start_x;
-                for (size_t i = 0; i < remove_count; ++i)
-                        str_rm(&ln->txt, start_x);
+                str_erase_range(&ln->txt, start_x, end_x - start_x);
 
-                b->cx = (unsigned)start_x;
-                b->al = (unsigned)start_y;
-                b->cy = (unsigned)start_y;
+                b->v->cx = (unsigned)start_x;
+                b->v->al = (unsigned)start_y;
+                b->v->cy = (unsigned)start_y;
         } else {
                 // multi-line deletion
 
-                // first line
-                {
-                        line *first = b->lines.data[start_y];
-                        size_t len_first = str_len(&first->txt);
-                        if (start_x < len_first) {
-                                while (str_len(&first->txt) > start_x)
-                                        str_rm(&first->txt, start_x);
-                        }
-                }
+                // join the start of the first line and the end of the last
+                line *first = b->lines.data[start_y];
+                line *last  = b->lines.data[end_y];
 
-                // last line
-                {
-                        line *last = b->lines.data[end_y];
-                        for (size_t i = 0; i < end_x; ++i)
-                                str_rm(&last->txt, 0);
-                }
+                str_cut(&first->txt, start_x);
+                str_append_n(&first->txt, last->txt.chars + end_x, last->txt.len - end_x);
 
-                // delete all middle lines
+                // drop the middle lines and the last one in one go
                 size_t lines_to_remove = end_y - start_y - 1;
-                for (size_t i = 0; i < lines_to_remove; ++i) {
-                        line_free(b->lines.data[start_y + 1]);
-                        array_rm_at(b->lines, start_y + 1);
-                }
-
-                // join the first and last lines
-                line *first = b->lines.data[start_y];
-                line *last  = b->lines.data[start_y + 1];
-
-                str_concat(&first->txt, str_cstr(&last->txt));
-                line_free(last);
-                array_rm_at(b->lines, start_y + 1);
+                if (taken)
+                        lines_take(&b->lines, start_y + 1, lines_to_remove + 1, taken);
+                else
+                        lines_splice(&b->lines, start_y + 1, lines_to_remove + 1, NULL, 0);
+                rows_removed(b, start_y + 1, lines_to_remove, 0);
+                rows_removed(b, start_y + 1, 1, 1);
 
                 // place cursor at the join point
-                b->cx = (unsigned)start_x;
-                b->al = (unsigned)start_y;
-                b->cy = (unsigned)start_y;
+                b->v->cx = (unsigned)start_x;
+                b->v->al = (unsigned)start_y;
+                b->v->cy = (unsigned)start_y;
         }
 
  cleanup:
-        b->wish_col = b->cx;
-        b->state    = BS_NORMAL;
+        b->v->wish_col = b->v->cx;
+        b->v->state    = BS_NORMAL;
 
         buffer_adjust_scroll(b);
         return BA_REDRAW;
 }
 
+static buffer_action
+del_selection(buffer *b)
+{
+        return remove_selection(b, NULL);
+}
+
 static buffer_action
 up(buffer *b)
 {
-        if (b->cy > 0) {
-                const str *olds = &b->lines.data[b->al]->txt;
-                unsigned desired = visual_column(olds, /*b->wish_col*/b->cx, TAB_WIDTH);
-                --b->cy;
-                --b->al;
-                const str *news = &b->lines.data[b->al]->txt;
-                b->cx = (unsigned)char_index_at_visual_col(news, desired, TAB_WIDTH);
-                if (desired < b->wish_col)
-                        b->cx = b->wish_col;
+        if (b->v->cy > 0) {
+                const str *olds = &b->lines.data[b->v->al]->txt;
+                unsigned desired = visual_column(olds, /*b->v->wish_col*/b->v->cx, TAB_WIDTH);
+                --b->v->cy;
+                --b->v->al;
+                const str *news = &b->lines.data[b->v->al]->txt;
+                b->v->cx = (unsigned)char_index_at_visual_col(news, desired, TAB_WIDTH);
+                if (desired < b->v->wish_col)
+                        b->v->cx = b->v->wish_col;
         }
 
-        if (b->cx > b->lines.data[b->al]->txt.len-1)
-                b->cx = (unsigned)b->lines.data[b->al]->txt.len-1;
+        if (b->v->cx > b->lines.data[b->v->al]->txt.len-1)
+                b->v->cx = (unsigned)b->lines.data[b->v->al]->txt.len-1;
 
         adjust_cursor(b);
-        return buffer_adjust_scroll(b) == BA_REDRAW || b->state == BS_SELECTION ? BA_REDRAW : BA_XY;
+        return buffer_adjust_scroll(b) == BA_REDRAW || b->v->state == BS_SELECTION ? BA_REDRAW : BA_XY;
 }
 
 static buffer_action
 down(buffer *b)
 {
-        if (b->cy < b->lines.len-1) {
-                const str *olds = &b->lines.data[b->al]->txt;
-                unsigned desired = visual_column(olds, /*b->wish_col*/b->cx, TAB_WIDTH);
-                ++b->cy;
-                ++b->al;
-                const str *news = &b->lines.data[b->al]->txt;
-                b->cx = (unsigned)char_index_at_visual_col(news, desired, TAB_WIDTH);
-                if (desired < b->wish_col)
-                        b->cx = b->wish_col;
+        if (b->v->cy < b->lines.len-1) {
+                const str *olds = &b->lines.data[b->v->al]->txt;
+                unsigned desired = visual_column(olds, /*b->v->wish_col*/b->v->cx, TAB_WIDTH);
+                ++b->v->cy;
+                ++b->v->al;
+                const str *news = &b->lines.data[b->v->al]->txt;
+                b->v->cx = (unsigned)char_index_at_visual_col(news, desired, TAB_WIDTH);
+                if (desired < b->v->wish_col)
+                        b->v->cx = b->v->wish_col;
 
         }
 
-        if (b->cx > b->lines.data[b->al]->txt.len-1)
-                b->cx = (unsigned)b->lines.data[b->al]->txt.len-1;
+        if (b->v->cx > b->lines.data[b->v->al]->txt.len-1)
+                b->v->cx = (unsigned)b->lines.data[b->v->al]->txt.len-1;
 
         adjust_cursor(b);
-        return buffer_adjust_scroll(b) == BA_REDRAW || b->state == BS_SELECTION ? BA_REDRAW : BA_XY;
+        return buffer_adjust_scroll(b) == BA_REDRAW || b->v->state == BS_SELECTION ? BA_REDRAW : BA_XY;
 }
 
 static buffer_action
 right(buffer *b)
 {
-        str *s = &b->lines.data[b->al]->txt;
+        str *s = &b->lines.data[b->v->al]->txt;
 
-        if (b->cx < str_len(s)-1) {
-                ++b->cx;
-        } else if (b->cy < b->lines.len-1) {
-                ++b->cy;
-                ++b->al;
-                b->cx = 0;
+        if (b->v->cx < str_len(s)-1) {
+                ++b->v->cx;
+        } else if (b->v->cy < b->lines.len-1) {
+                ++b->v->cy;
+                ++b->v->al;
+                b->v->cx = 0;
         }
-        b->wish_col = b->cx;
+        b->v->wish_col = b->v->cx;
 
         adjust_cursor(b);
-        return buffer_adjust_scroll(b) == BA_REDRAW || b->state == BS_SELECTION ? BA_REDRAW : BA_XY;
+        return buffer_adjust_scroll(b) == BA_REDRAW || b->v->state == BS_SELECTION ? BA_REDRAW : BA_XY;
 }
 
 static buffer_action
 left(buffer *b)
 {
-        if (b->cx > 0) {
-                --b->cx;
-        } else if (b->cy > 0) {
-                --b->cy;
-                --b->al;
-                str *prev = &b->lines.data[b->al]->txt;
-                b->cx = (unsigned)str_len(prev)-1;
+        if (b->v->cx > 0) {
+                --b->v->cx;
+        } else if (b->v->cy > 0) {
+                --b->v->cy;
+                --b->v->al;
+                str *prev = &b->lines.data[b->v->al]->txt;
+                b->v->cx = (unsigned)str_len(prev)-1;
         }
-        b->wish_col = b->cx;
+        b->v->wish_col = b->v->cx;
 
         adjust_cursor(b);
-        return buffer_adjust_scroll(b) == BA_REDRAW || b->state == BS_SELECTION ? BA_REDRAW : BA_XY;
+        return buffer_adjust_scroll(b) == BA_REDRAW || b->v->state == BS_SELECTION ? BA_REDRAW : BA_XY;
 }
 
 static buffer_action
 bol(buffer *b)
 {
-        b->cx = 0;
-        b->wish_col = 0;
+        b->v->cx = 0;
+        b->v->wish_col = 0;
         adjust_cursor(b);
-        return buffer_adjust_scroll(b) == BA_REDRAW || b->state == BS_SELECTION ? BA_REDRAW : BA_XY;
+        return buffer_adjust_scroll(b) == BA_REDRAW || b->v->state == BS_SELECTION ? BA_REDRAW : BA_XY;
 }
 
 static buffer_action
 eol(buffer *b)
 {
-        str *s = &b->lines.data[b->al]->txt;
-        b->cx = (unsigned)str_len(s)-1;
-        b->wish_col = (unsigned)str_len(s)-1;
+        str *s = &b->lines.data[b->v->al]->txt;
+        b->v->cx = (unsigned)str_len(s)-1;
+        b->v->wish_col = (unsigned)str_len(s)-1;
         adjust_cursor(b);
-        return buffer_adjust_scroll(b) == BA_REDRAW || b->state == BS_SELECTION ? BA_REDRAW : BA_XY;
+        return buffer_adjust_scroll(b) == BA_REDRAW || b->v->state == BS_SELECTION ? BA_REDRAW : BA_XY;
 }
 
 static buffer_action
 jump_next_word(buffer *b, int skip_underscores)
 {
-        const line *ln;
-        const str  *s;
+        line       *ln;
+        str        *s;
         const char *sraw;
         int         hitchars;
         size_t      i;
 
-        ln       = b->lines.data[b->al];
+        ln       = b->lines.data[b->v->al];
         s        = &ln->txt;
         sraw     = str_cstr(s);
         hitchars = 0;
-        i        = b->cx;
+        i        = b->v->cx;
 
         if (str_len(s) <= 0)
                 return BA_NOP;
@@ -842,11 +1328,11 @@ jump_next_word(buffer *b, int skip_underscores)
         }
 
         if (i == str_len(s))
-                b->cx = (unsigned)str_len(s)-1;
+                b->v->cx = (unsigned)str_len(s)-1;
         else
-                b->cx = (unsigned)i;
+                b->v->cx = (unsigned)i;
 
-        b->wish_col = b->cx;
+        b->v->wish_col = b->v->cx;
 
         adjust_cursor(b);
         return buffer_adjust_scroll(b) == BA_REDRAW ? BA_REDRAW : BA_XY;
@@ -855,19 +1341,19 @@ jump_next_word(buffer *b, int skip_underscores)
 static buffer_action
 jump_prev_word(buffer *b)
 {
-        const line *ln;
-        const str  *s;
+        line       *ln;
+        str        *s;
         const char *sraw;
         int         hitchars;
         size_t      i;
 
-        ln       = b->lines.data[b->al];
+        ln       = b->lines.data[b->v->al];
         s        = &ln->txt;
         sraw     = str_cstr(s);
         hitchars = 0;
-        i        = b->cx-1;
+        i        = b->v->cx-1;
 
-        if (str_len(s) == 0 || b->cx == 0)
+        if (str_len(s) == 0 || b->v->cx == 0)
                 return BA_NOP;
 
         while (i > 0) {
@@ -878,12 +1364,12 @@ jump_prev_word(buffer *b)
                 --i;
         }
 
-        b->cx = (unsigned)i;
+        b->v->cx = (unsigned)i;
 
-        if (!isalnum(sraw[b->cx]))
-                ++b->cx;
+        if (!isalnum(sraw[b->v->cx]))
+                ++b->v->cx;
 
-        b->wish_col = b->cx;
+        b->v->wish_col = b->v->cx;
 
         adjust_cursor(b);
         return buffer_adjust_scroll(b) == BA_REDRAW ? BA_REDRAW : BA_XY;
@@ -898,13 +1384,12 @@ del_word(buffer *b)
         int          hitchars;
         size_t       i;
 
-        ln       = b->lines.data[b->al];
+        ln       = b->lines.data[b->v->al];
         s        = &ln->txt;
         sraw     = str_cstr(s);
         hitchars = 0;
-        i        = b->cx;
+        i        = b->v->cx;
 
-        //clear_cpy();
         while (i < str_len(s)) {
                 if (sraw[i] == 10)
                         break;
@@ -912,8 +1397,12 @@ del_word(buffer *b)
                         hitchars = 1;
                 else if (!isalnum(sraw[i]) && hitchars)
                         break;
-                //array_append(g_cpy_buf, str_at(s, i));
-                str_rm(s, i);
+                ++i;
+        }
+
+        if (i > b->v->cx) {
+                ac_forget(b, b->v->al, b->v->al);
+                str_erase_range(s, b->v->cx, i - b->v->cx);
         }
 
         buffer_adjust_scroll(b);
@@ -925,9 +1414,9 @@ prev_paragraph(buffer *b)
 {
         size_t nextln;
 
-        nextln = b->cy;
+        nextln = b->v->cy;
 
-        for (int i = (int)b->cy-1; i >= 0; --i) {
+        for (int i = (int)b->v->cy-1; i >= 0; --i) {
                 const line *l  = b->lines.data[i];
                 const line *l2 = b->lines.data[i+1];
                 nextln         = (size_t)i;
@@ -938,12 +1427,12 @@ prev_paragraph(buffer *b)
                 }
         }
 
-        b->cy = (unsigned)nextln;
-        b->cx = 0;
-        b->al = nextln;
+        b->v->cy = (unsigned)nextln;
+        b->v->cx = 0;
+        b->v->al = nextln;
 
         adjust_cursor(b);
-        return (buffer_adjust_scroll(b) == BA_REDRAW || b->state == BS_SELECTION) ? BA_REDRAW : BA_XY;
+        return (buffer_adjust_scroll(b) == BA_REDRAW || b->v->state == BS_SELECTION) ? BA_REDRAW : BA_XY;
 }
 
 static buffer_action
@@ -951,9 +1440,9 @@ next_paragraph(buffer *b)
 {
         size_t nextln;
 
-        nextln = b->cy;
+        nextln = b->v->cy;
 
-        for (size_t i = b->cy+1; i < b->lines.len; ++i) {
+        for (size_t i = b->v->cy+1; i < b->lines.len; ++i) {
                 const line *l  = b->lines.data[i];
                 const line *l2 = b->lines.data[i+1];
                 nextln         = i;
@@ -964,12 +1453,12 @@ next_paragraph(buffer *b)
                 }
         }
 
-        b->cy = (unsigned)nextln;
-        b->cx = 0;
-        b->al = nextln;
+        b->v->cy = (unsigned)nextln;
+        b->v->cx = 0;
+        b->v->al = nextln;
 
         adjust_cursor(b);
-        return (buffer_adjust_scroll(b) == BA_REDRAW || b->state == BS_SELECTION) ? BA_REDRAW : BA_XY;
+        return (buffer_adjust_scroll(b) == BA_REDRAW || b->v->state == BS_SELECTION) ? BA_REDRAW : BA_XY;
 }
 
 static buffer_action
@@ -978,29 +1467,27 @@ kill_line(buffer *b)
         if (!writable(b))
                 return BA_NOP;
 
-        line *ln;
-        const str *s;
+        linep_ar taken;
 
         if (b->lines.len <= 0)
                 return BA_NOP;
 
-        ln = b->lines.data[b->al];
-        s  = &ln->txt;
-
-        clear_cpy();
-        for (size_t i = 0; i < str_len(s); ++i)
-                array_append(g_cpy_buf, str_at(s, i));
+        // The line itself goes to the kill ring.
+        ac_forget(b, b->v->al, b->v->al);
 
-        line_free(ln);
-        array_rm_at(b->lines, b->al);
+        taken = array_empty(linep_ar);
+        lines_take(&b->lines, b->v->al, 1, &taken);
+        killring_take_lines(b, taken, taken.data[0]->txt.len);
+        clipboard_export(b, killring_current());
+        rows_removed(b, b->v->al, 1, 0);
 
-        if (b->al > b->lines.len-1) {
-                --b->al;
-                --b->cy;
+        if (b->v->al > b->lines.len-1) {
+                --b->v->al;
+                --b->v->cy;
         }
 
-        b->cx       = 0;
-        b->wish_col = 0;
+        b->v->cx       = 0;
+        b->v->wish_col = 0;
 
         buffer_adjust_scroll(b);
         return BA_REDRAW;
@@ -1009,10 +1496,10 @@ kill_line(buffer *b)
 static int
 prev_line_all_spaces(buffer *b)
 {
-        if (b->al == 0)
+        if (b->v->al == 0)
                 return 0;
 
-        const str *s = &b->lines.data[b->al-1]->txt;
+        const str *s = &b->lines.data[b->v->al-1]->txt;
 
         for (size_t i = 0; i < s->len; ++i) {
                 if (!isspace(s->chars[i]))
@@ -1034,55 +1521,65 @@ insert_char(buffer *b,
         if (!writable(b))
                 return BA_NOP;
 
-        if (b->state == BS_AUTO)
-                b->state = BS_NORMAL;
+        if (b->v->state == BS_AUTO) {
+                b->v->state      = BS_NORMAL;
+                b->ac_sess.cycle = 0;
+        }
 
         b->saved = 0;
 
-        if (!b->lines.data) {
-                char tmp[] = {'\n', 0};
-                array_append(b->lines, line_from(str_from(tmp)));
-        }
+        if (!b->lines.data)
+                array_append(b->lines, line_alloc(b->pool));
 
-        str_insert(&b->lines.data[b->al]->txt, b->cx, ch);
-        ++b->cx;
-        ++b->wish_col;
+        ac_forget(b, b->v->al, b->v->al);
+        str_insert(&b->lines.data[b->v->al]->txt, b->v->cx, ch);
+        ++b->v->cx;
+        ++b->v->wish_col;
 
         if (ch == '\n') {
                 const char *rest;
                 line       *newln;
 
-                rest  = str_cstr(&b->lines.data[b->al]->txt)+b->cx;
-                newln = line_from(str_from(rest));
+                rest  = str_cstr(&b->lines.data[b->v->al]->txt)+b->v->cx;
+                newln = line_from_cstr(b->pool, rest);
 
-                array_insert_at(b->lines, b->al+1, newln);
-                str_cut(&b->lines.data[b->al]->txt, b->cx);
+                array_insert_at(b->lines, b->v->al+1, newln);
+                str_cut(&b->lines.data[b->v->al]->txt, b->v->cx);
+
+                // Splitting in front of the text moves it, and its
+                // diagnostics, to the new line.
+                {
+                        const str *head = &b->lines.data[b->v->al]->txt;
+                        size_t     i    = 0;
+                        while (i < head->len && isspace(head->chars[i]))
+                                ++i;
+                        rows_inserted(b, i == head->len ? b->v->al : b->v->al+1, 1);
+                }
 
                 if (newline_advance) {
-                        b->cx = 0;
-                        b->wish_col = 0;
-                        ++b->cy;
-                        ++b->al;
+                        b->v->cx = 0;
+                        b->v->wish_col = 0;
+                        ++b->v->cy;
+                        ++b->v->al;
                 }
 
                 if (!b->paste && autotab && ((glconf.flags & FK_NODUMBINDENT) == 0))
                         tab(b, 1);
 
                 if (prev_line_all_spaces(b)) {
-                        str_clear(&b->lines.data[b->al-1]->txt);
-                        str_append(&b->lines.data[b->al-1]->txt, '\n');
+                        str_assign(&b->lines.data[b->v->al-1]->txt, "\n", 1);
                 }
 
         } else if (!b->paste && autobracket && (ch == '{' || ch == '(' || ch == '[' || ch == '\'' || ch == '"')) {
-                const str *cur = &b->lines.data[b->al]->txt;
-                int on_pair = cur->chars[b->cx] == ')'
-                                || cur->chars[b->cx] == '}'
-                                || cur->chars[b->cx] == ']'
-                                || cur->chars[b->cx] == '\''
-                                || cur->chars[b->cx] == '"';
-                if (isspace(cur->chars[b->cx]) || on_pair) {
+                const str *cur = &b->lines.data[b->v->al]->txt;
+                int on_pair = cur->chars[b->v->cx] == ')'
+                                || cur->chars[b->v->cx] == '}'
+                                || cur->chars[b->v->cx] == ']'
+                                || cur->chars[b->v->cx] == '\''
+                                || cur->chars[b->v->cx] == '"';
+                if (isspace(cur->chars[b->v->cx]) || on_pair) {
                         char opp = ch == '{' ? '}' : ch == '[' ? ']' : ch == '(' ? ')' : ch == '\'' ? '\'' : '"';
-                        str_insert(&b->lines.data[b->al]->txt, b->cx, opp);
+                        str_insert(&b->lines.data[b->v->al]->txt, b->v->cx, opp);
                 }
         }
 
@@ -1092,29 +1589,138 @@ insert_char(buffer *b,
         return (buffer_adjust_scroll(b) == BA_REDRAW || ch == '\n') ? BA_REDRAW : BA_XY;
 }
 
+// Insert a kill ring entry at the cursor the way insert_char would one
+// byte at a time with no auto-indent or pairing, but building each new
+// line once. Returns the number of lines added.
+static size_t
+insert_kill(buffer           *b,
+            const kill_entry *e)
+{
+        linep_ar  add;
+        line     *cur;
+        line     *part;  // the new line being filled
+        size_t    at;    // where text goes in `cur' until it ends a line
+        size_t    split; // where `cur' now ends, 0 while it does not
+        size_t    added;
+
+        if (!e)
+                return 0;
+
+        if (b->v->state == BS_AUTO) {
+                b->v->state      = BS_NORMAL;
+                b->ac_sess.cycle = 0;
+        }
+
+        b->saved = 0;
+
+        if (!b->lines.data)
+                array_append(b->lines, line_alloc(b->pool));
+
+        ac_forget(b, b->v->al, b->v->al);
+
+        cur   = b->lines.data[b->v->al];
+        part  = NULL;
+        at    = b->v->cx;
+        split = 0;
+        add   = array_empty(linep_ar);
+
+        for (size_t i = 0; i < killring_runs(e); ++i) {
+                sv          run = killring_run(e, i);
+                const char *p   = run.s;
+                const char *end = run.s + run.len;
+
+                while (p < end) {
+                        const char *nl = (const char *)memchr(p, '\n', (size_t)(end - p));
+                        size_t      n  = nl ? (size_t)(nl - p) + 1 : (size_t)(end - p);
+
+                        if (!split) {
+                                str_insert_n(&cur->txt, at, p, n);
+                                at += n;
+                                if (nl)
+                                        split = at;
+                        } else if (part) {
+                                str_append_n(&part->txt, p, n);
+                        } else {
+                                part = line_from_n(b->pool, p, n);
+                        }
+
+                        if (nl && part) {
+                                array_append(add, part);
+                                part = NULL;
+                        }
+
+                        p += n;
+                }
+        }
+
+        if (!split) {
+                b->v->wish_col += (unsigned)(at - b->v->cx);
+                b->v->cx        = (unsigned)at;
+                return 0;
+        }
+
+        // The text after the cursor ends up behind the last piece.
+        if (!part)
+                part = line_create_nothing(b->pool);
+
+        b->v->cx = (unsigned)part->txt.len;
+
+        str_append_n(&part->txt, cur->txt.chars + split, cur->txt.len - split);
+        array_append(add, part);
+        str_cut(&cur->txt, split);
+
+        lines_splice(&b->lines, b->v->al+1, 0, add.data, add.len);
+
+        // Same as splitting one newline at a time: a blank line keeps
+        // nothing but its newline and hands its diagnostics down.
+        for (size_t i = 0; i < add.len; ++i) {
+                str    *head = &b->lines.data[b->v->al+i]->txt;
+                size_t  j    = 0;
+
+                while (j < head->len && isspace(head->chars[j]))
+                        ++j;
+
+                if (j == head->len) {
+                        rows_inserted(b, b->v->al+i, 1);
+                        str_assign(head, "\n", 1);
+                } else {
+                        rows_inserted(b, b->v->al+i+1, 1);
+                }
+        }
+
+        b->v->al       += add.len;
+        b->v->cy       += (unsigned)add.len;
+        b->v->wish_col  = b->v->cx;
+
+        added = add.len;
+        array_free(add);
+
+        return added;
+}
+
 static buffer_action
 jump_to_top_of_buffer(buffer *b)
 {
         if (b->lines.len == 0) // not sure if this is required, but doesn't hurt
                 return BA_NOP;
 
-        b->cy = (unsigned)b->lines.len-1;
-        b->cx = 0;
-        b->wish_col = 0;
-        b->al = b->lines.len-1;
+        b->v->cy = (unsigned)b->lines.len-1;
+        b->v->cx = 0;
+        b->v->wish_col = 0;
+        b->v->al = b->lines.len-1;
         adjust_cursor(b);
-        return (buffer_adjust_scroll(b) == BA_REDRAW || b->state == BS_SELECTION) ? BA_REDRAW : BA_XY;
+        return (buffer_adjust_scroll(b) == BA_REDRAW || b->v->state == BS_SELECTION) ? BA_REDRAW : BA_XY;
 }
 
 static buffer_action
 jump_to_bottom_of_buffer(buffer *b)
 {
-        b->cy = 0;
-        b->cx = 0;
-        b->wish_col = 0;
-        b->al = 0;
+        b->v->cy = 0;
+        b->v->cx = 0;
+        b->v->wish_col = 0;
+        b->v->al = 0;
         adjust_cursor(b);
-        return (buffer_adjust_scroll(b) == BA_REDRAW || b->state == BS_SELECTION) ? BA_REDRAW : BA_XY;
+        return (buffer_adjust_scroll(b) == BA_REDRAW || b->v->state == BS_SELECTION) ? BA_REDRAW : BA_XY;
 }
 
 static buffer_action
@@ -1123,31 +1729,34 @@ del_char(buffer *b)
         if (!writable(b))
                 return BA_NOP;
 
-        if (b->state == BS_SELECTION)
+        if (b->v->state == BS_SELECTION)
                 return del_selection(b);
 
         line *ln;
         int   newline;
 
-        ln       = b->lines.data[b->al];
+        ln       = b->lines.data[b->v->al];
         newline  = 0;
         b->saved = 0;
+        ac_forget(b, b->v->al, b->v->al);
 
-        if (ln->txt.chars[b->cx] == '\n') {
+        if (str_at(&ln->txt, b->v->cx) == '\n') {
                 newline = 1;
-                if (b->al < b->lines.len-1) {
-                        str *s = &ln->txt;
-                        str_concat(s, str_cstr(&b->lines.data[b->al+1]->txt));
-                        line_free(b->lines.data[b->al+1]);
-                        array_rm_at(b->lines, b->al+1);
+                if (b->v->al < b->lines.len-1) {
+                        const str *next = &b->lines.data[b->v->al+1]->txt;
+
+                        ac_forget(b, b->v->al+1, b->v->al+1);
+                        str_append_n(&ln->txt, next->chars, next->len);
+                        lines_splice(&b->lines, b->v->al+1, 1, NULL, 0);
+                        rows_removed(b, b->v->al+1, 1, 1);
                 } else {
                         return 0;
                 }
         }
 
-        str_rm(&ln->txt, b->cx);
-        if (b->cx > str_len(&ln->txt)-1)
-                b->cx = (unsigned)str_len(&ln->txt)-1;
+        str_rm(&ln->txt, b->v->cx);
+        if (b->v->cx > str_len(&ln->txt)-1)
+                b->v->cx = (unsigned)str_len(&ln->txt)-1;
 
         //add_to_popxy(b);
         return (buffer_adjust_scroll(b) == BA_REDRAW || newline) ? BA_REDRAW : BA_XY;
@@ -1159,30 +1768,35 @@ backspace(buffer *b)
         if (!writable(b))
                 return BA_NOP;
 
-        if (b->state == BS_AUTO)
-                b->state = BS_NORMAL;
+        if (b->v->state == BS_AUTO) {
+                b->v->state      = BS_NORMAL;
+                b->ac_sess.cycle = 0;
+        }
 
         line *ln;
         int   newline;
 
-        ln       = b->lines.data[b->al];
+        ln       = b->lines.data[b->v->al];
         newline  = 0;
         b->saved = 0;
+        ac_forget(b, b->v->al, b->v->al);
 
-        if (b->cx == 0) {
-                if (b->al == 0)
+        if (b->v->cx == 0) {
+                if (b->v->al == 0)
                         return 0;
-                line   *prevln     = b->lines.data[b->al-1];
+                line   *prevln     = b->lines.data[b->v->al-1];
                 size_t  prevln_len = str_len(&prevln->txt);
 
+                ac_forget(b, b->v->al-1, b->v->al-1);
+
                 str_rm(&prevln->txt, prevln_len-1);
-                str_concat(&prevln->txt, str_cstr(&ln->txt));
-                line_free(b->lines.data[b->al]);
-                array_rm_at(b->lines, b->al);
+                str_append_n(&prevln->txt, ln->txt.chars, ln->txt.len);
+                lines_splice(&b->lines, b->v->al, 1, NULL, 0);
+                rows_removed(b, b->v->al, 1, 1);
 
-                --b->al;
-                b->cx = (unsigned)prevln_len-1;
-                --b->cy;
+                --b->v->al;
+                b->v->cx = (unsigned)prevln_len-1;
+                --b->v->cy;
 
                 buffer_adjust_scroll(b);
                 return BA_REDRAW;
@@ -1192,18 +1806,18 @@ backspace(buffer *b)
                 --b->last_tab;
                 for (size_t i = 0; i < (size_t)glconf.runtime.space_amt; ++i) {
                         left(b);
-                        str_rm(&ln->txt, b->cx);
-                        if (b->cx > str_len(&ln->txt)-1)
-                                b->cx = (unsigned)str_len(&ln->txt)-1;
+                        str_rm(&ln->txt, b->v->cx);
+                        if (b->v->cx > str_len(&ln->txt)-1)
+                                b->v->cx = (unsigned)str_len(&ln->txt)-1;
                 }
         } else {
                 left(b);
-                str_rm(&ln->txt, b->cx);
-                if (b->cx > str_len(&ln->txt)-1)
-                        b->cx = (unsigned)str_len(&ln->txt)-1;
+                str_rm(&ln->txt, b->v->cx);
+                if (b->v->cx > str_len(&ln->txt)-1)
+                        b->v->cx = (unsigned)str_len(&ln->txt)-1;
         }
 
-        b->wish_col = b->cx;
+        b->v->wish_col = b->v->cx;
 
         //add_to_popxy(b);
         return (buffer_adjust_scroll(b) == BA_REDRAW || newline) ? BA_REDRAW : BA_XY;
@@ -1218,15 +1832,17 @@ delete_until_eol(buffer *b)
         line *ln;
         const str *s;
 
-        ln = b->lines.data[b->al];
+        ln = b->lines.data[b->v->al];
         s  = &ln->txt;
 
-        clear_cpy();
-        for (size_t i = b->cx; i < str_len(s)-1; ++i)
-                array_append(g_cpy_buf, str_at(s, i));
+        if (b->v->cx < str_len(s)-1) {
+                killring_push(s->chars + b->v->cx, str_len(s)-1 - b->v->cx);
+                clipboard_export(b, killring_current());
+        }
 
-        str_cut(&ln->txt, b->cx);
-        str_insert(&ln->txt, b->cx, '\n');
+        ac_forget(b, b->v->al, b->v->al);
+        str_cut(&ln->txt, b->v->cx);
+        str_insert(&ln->txt, b->v->cx, '\n');
 
         //add_to_popxy(b);
 
@@ -1238,20 +1854,20 @@ delete_until_eol(buffer *b)
 static buffer_action
 jump_to_first_char(buffer *b)
 {
-        const str  *s;
+        str        *s;
         const char *sraw;
 
-        s    = &b->lines.data[b->al]->txt;
+        s    = &b->lines.data[b->v->al]->txt;
         sraw = str_cstr(s);
 
         for (size_t i = 0; i < str_len(s); ++i) {
                 if (sraw[i] != ' ' && sraw[i] != '\n' && sraw[i] != '\t' && sraw[i] != '\r') {
-                        b->cx = (unsigned)i;
+                        b->v->cx = (unsigned)i;
                         break;
                 }
         }
 
-        b->wish_col = b->cx;
+        b->v->wish_col = b->v->cx;
 
         adjust_cursor(b);
         return buffer_adjust_scroll(b) == BA_REDRAW ? BA_REDRAW : BA_XY;
@@ -1261,7 +1877,7 @@ buffer_action
 buffer_center_view(buffer *b)
 {
         int rows = (int)get_win_hight(b);
-        int vertical_offset = (int)b->cy - (rows/2);
+        int vertical_offset = (int)b->v->cy - (rows/2);
         if (vertical_offset < 0)
                 vertical_offset = 0;
 
@@ -1269,7 +1885,7 @@ buffer_center_view(buffer *b)
         if (max_offset < 0)
                 max_offset = 0;
 
-        b->voff = (unsigned)vertical_offset;
+        b->v->voff = (unsigned)vertical_offset;
         buffer_adjust_scroll(b);
 
         return BA_REDRAW;
@@ -1284,22 +1900,24 @@ combine_lines(buffer *b)
         str    *s1;
         size_t len;
 
-        if (b->al >= b->lines.len-1)
+        if (b->v->al >= b->lines.len-1)
                 return BA_NOP;
 
-        l0  = b->lines.data[b->al];
+        l0  = b->lines.data[b->v->al];
         s0  = &l0->txt;
-        l1  = b->lines.data[b->al+1];
+        l1  = b->lines.data[b->v->al+1];
         s1  = &l1->txt;
         len = str_len(s0);
 
+        ac_forget(b, b->v->al, b->v->al+1);
         s0->chars[s0->len-1] = ' ';
         str_trim_before(s1);
-        str_concat(s0, str_cstr(s1));
-        array_rm_at(b->lines, b->al+1);
+        str_append_n(s0, s1->chars, s1->len);
+        lines_splice(&b->lines, b->v->al+1, 1, NULL, 0);
+        rows_removed(b, b->v->al+1, 1, 1);
 
-        b->cx = (unsigned)len-1;
-        b->wish_col = b->cx;
+        b->v->cx = (unsigned)len-1;
+        b->v->wish_col = b->v->cx;
 
         //add_to_popxy(b);
 
@@ -1312,18 +1930,18 @@ page_down(buffer *b)
 {
         size_t h;
 
-        h = b->size.h;
+        h = b->v->size.h;
 
-        if (b->al + h > b->lines.len) {
-                b->al = b->lines.len-1;
-                b->cy = (unsigned)b->lines.len-1;
+        if (b->v->al + h > b->lines.len) {
+                b->v->al = b->lines.len-1;
+                b->v->cy = (unsigned)b->lines.len-1;
         } else {
-                b->al += h;
-                b->cy += (unsigned)h;
+                b->v->al += h;
+                b->v->cy += (unsigned)h;
         }
 
-        b->cx       = 0;
-        b->wish_col = 0;
+        b->v->cx       = 0;
+        b->v->wish_col = 0;
 
         buffer_adjust_scroll(b);
 
@@ -1335,18 +1953,18 @@ page_up(buffer *b)
 {
         size_t h;
 
-        h = b->size.h;
+        h = b->v->size.h;
 
-        if ((int)b->al - (int)h < 0) {
-                b->al = 0;
-                b->cy = 0;
+        if ((int)b->v->al - (int)h < 0) {
+                b->v->al = 0;
+                b->v->cy = 0;
         } else {
-                b->al -= h;
-                b->cy -= (unsigned)h;
+                b->v->al -= h;
+                b->v->cy -= (unsigned)h;
         }
 
-        b->cx       = 0;
-        b->wish_col = 0;
+        b->v->cx       = 0;
+        b->v->wish_col = 0;
 
         buffer_adjust_scroll(b);
 
@@ -1369,14 +1987,15 @@ super_backspace(buffer *b)
         line   *ln;
         size_t  start;
 
-        ln    = b->lines.data[b->al];
-        start = b->cx;
+        ln    = b->lines.data[b->v->al];
+        start = b->v->cx;
 
         // cursor at beginning of line fall back to regular backspace
-        if (b->cx == 0)
+        if (b->v->cx == 0)
                 return backspace(b);
 
         b->saved = 0;
+        ac_forget(b, b->v->al, b->v->al);
 
         while (start > 0 && backspace_stop((unsigned char)str_at(&ln->txt, start - 1)))
                 --start;
@@ -1387,12 +2006,12 @@ super_backspace(buffer *b)
         }
 
         // nothing to remove
-        if (start == b->cx)
+        if (start == b->v->cx)
                 return 0;
 
-        str_remove_range(&ln->txt, start, b->cx - start);
+        str_erase_range(&ln->txt, start, b->v->cx - start);
 
-        b->cx       = (unsigned)start;
+        b->v->cx    = (unsigned)start;
         b->last_tab = 0;
 
         //add_to_popxy(b);
@@ -1409,13 +2028,14 @@ buffer_dupline(buffer *b)
         str  *s;
         line *newln;
 
-        ln = b->lines.data[b->al];
+        ln = b->lines.data[b->v->al];
         s  = &ln->txt;
-        newln = line_from_cstr(str_cstr(s));
+        newln = line_from_cstr(b->pool, str_cstr(s));
 
-        array_insert_at(b->lines, b->al, newln);
-        ++b->al;
-        ++b->cy;
+        array_insert_at(b->lines, b->v->al, newln);
+        rows_inserted(b, b->v->al, 1);
+        ++b->v->al;
+        ++b->v->cy;
 
         //add_to_popxy(b);
         buffer_adjust_scroll(b);
@@ -1428,17 +2048,21 @@ movetxt_up(buffer *b)
         if (!writable(b))
                 return BA_NOP;
 
-        if (b->al <= 0)
+        if (b->v->al <= 0)
                 return BA_NOP;
 
         line *tmp;
 
-        tmp                    = b->lines.data[b->al];
-        b->lines.data[b->al]   = b->lines.data[b->al-1];
-        b->lines.data[b->al-1] = tmp;
+        // The words stay, the rows they were counted on do not.
+        ac_forget(b, b->v->al-1, b->v->al);
+
+        tmp                       = b->lines.data[b->v->al];
+        b->lines.data[b->v->al]   = b->lines.data[b->v->al-1];
+        b->lines.data[b->v->al-1] = tmp;
+        markers_lines_swapped(b, b->v->al, b->v->al-1);
 
-        --b->al;
-        --b->cy;
+        --b->v->al;
+        --b->v->cy;
         //add_to_popxy(b);
         buffer_adjust_scroll(b);
         return BA_REDRAW;
@@ -1450,17 +2074,20 @@ movetxt_down(buffer *b)
         if (!writable(b))
                 return BA_NOP;
 
-        if (b->al >= b->lines.len-1)
+        if (b->v->al >= b->lines.len-1)
                 return BA_NOP;
 
         line *tmp;
 
-        tmp                    = b->lines.data[b->al];
-        b->lines.data[b->al]   = b->lines.data[b->al+1];
-        b->lines.data[b->al+1] = tmp;
+        ac_forget(b, b->v->al, b->v->al+1);
 
-        ++b->al;
-        ++b->cy;
+        tmp                       = b->lines.data[b->v->al];
+        b->lines.data[b->v->al]   = b->lines.data[b->v->al+1];
+        b->lines.data[b->v->al+1] = tmp;
+        markers_lines_swapped(b, b->v->al, b->v->al+1);
+
+        ++b->v->al;
+        ++b->v->cy;
 
         //add_to_popxy(b);
         buffer_adjust_scroll(b);
@@ -1477,8 +2104,8 @@ upperlower_word(buffer *b,
         str        *s;
         const char *sraw;
 
-        start = b->cx;
-        ln    = b->lines.data[b->al];
+        start = b->v->cx;
+        ln    = b->lines.data[b->v->al];
         s     = &ln->txt;
         sraw  = str_cstr(s);
 
@@ -1488,13 +2115,15 @@ upperlower_word(buffer *b,
         if (start >= str_len(s))
                 return BA_NOP;
 
+        ac_forget(b, b->v->al, b->v->al);
+
         for (size_t i = 0; start < str_len(s) && (isalnum(sraw[start]) || sraw[start] == '_'); ++i, ++start) {
                 if ((!all && !i) || all)
                         s->chars[start] = (char)fun(s->chars[start]);
         }
 
-        b->cx = (unsigned)start;
-        b->wish_col = b->cx;
+        b->v->cx = (unsigned)start;
+        b->v->wish_col = b->v->cx;
 
         //add_to_popxy(b);
 
@@ -1549,18 +2178,21 @@ swap_chars(buffer *b)
         str  *s;
         char  ch;
 
-        ln = b->lines.data[b->al];
+        ln = b->lines.data[b->v->al];
         s  = &ln->txt;
-        ch = str_at(s, b->cx);
+        ch = str_at(s, b->v->cx);
 
-        if (b->cx >= str_len(s)-1 || b->cx == 0)
+        if (b->v->cx >= str_len(s)-1 || b->v->cx == 0)
                 return BA_NOP;
 
-        s->chars[b->cx]   = s->chars[b->cx-1];
-        s->chars[b->cx-1] = ch;
+        ac_forget(b, b->v->al, b->v->al);
+        s->chars[b->v->cx]   = s->chars[b->v->cx-1];
+        s->chars[b->v->cx-1] = ch;
+        if (s->len >= COLIDX_MIN)
+                colidx_edit(s, b->v->cx-1, 2, 2);
 
-        ++b->cx;
-        b->wish_col = b->cx;
+        ++b->v->cx;
+        b->v->wish_col = b->v->cx;
 
         //add_to_popxy(b);
         return BA_XY;
@@ -1569,81 +2201,104 @@ swap_chars(buffer *b)
 static buffer_action
 cancel(buffer *b)
 {
-        b->state = BS_NORMAL;
+        b->v->state = BS_NORMAL;
         return BA_REDRAW;
 }
 
 static buffer_action
 selection(buffer *b)
 {
-        if (b->state == BS_NORMAL)
-                b->state = BS_SELECTION;
-        else if (b->state == BS_SELECTION)
-                b->state = BS_NORMAL;
+        if (b->v->state == BS_NORMAL)
+                b->v->state = BS_SELECTION;
+        else if (b->v->state == BS_SELECTION)
+                b->v->state = BS_NORMAL;
         else
                 return BA_NOP;
 
-        b->sy = (unsigned)b->al;
-        b->sx = b->cx;
+        b->v->sy = (unsigned)b->v->al;
+        b->v->sx = b->v->cx;
 
         return BA_XY;
 }
 
+// The selection from its first character to the one after its last.
+static void
+selection_bounds(const buffer *b,
+                 size_t       *start_y,
+                 size_t       *start_x,
+                 size_t       *end_y,
+                 size_t       *end_x)
+{
+        if (b->v->sy < b->v->al || (b->v->sy == b->v->al && b->v->sx <= b->v->cx)) {
+                *start_y = b->v->sy;
+                *start_x = b->v->sx;
+                *end_y   = b->v->al;
+                *end_x   = b->v->cx;
+        } else {
+                *start_y = b->v->al;
+                *start_x = b->v->cx;
+                *end_y   = b->v->sy;
+                *end_x   = b->v->sx;
+        }
+}
+
+// Copying several lines only points the kill ring at them, it copies
+// their text once this buffer changes (see killring_unshare).
 static buffer_action
 copy_selection(buffer *b)
 {
-        if (b->state != BS_SELECTION)
+        if (b->v->state != BS_SELECTION)
                 return BA_NOP;
 
-        clear_cpy();
-
-        size_t start_line, start_col, end_line, end_col;
-
-        (void)end_col;
-        (void)start_col;
+        size_t start_y, start_x, end_y, end_x;
 
-        // determine absolute selection bounds
-        if (b->sy < b->al || (b->sy == b->al && b->sx <= b->cx)) {
-                start_line = b->sy;
-                start_col  = b->sx;
-                end_line   = b->al;
-                end_col    = b->cx;
-        } else {
-                start_line = b->al;
-                start_col  = b->cx;
-                end_line   = b->sy;
-                end_col    = b->sx;
-        }
-
-        // copy lines
-        for (size_t i = start_line; i <= end_line; ++i) {
-                str *ln = &b->lines.data[i]->txt;
-                size_t sel_start, sel_end;
-
-                if (!line_selection_range(b, i, ln->len, &sel_start, &sel_end))
-                        continue;
+        selection_bounds(b, &start_y, &start_x, &end_y, &end_x);
 
-                for (size_t j = sel_start; j < sel_end; ++j)
-                        array_append(g_cpy_buf, ln->chars[j]);
+        if (end_y < b->lines.len) {
+                if (start_y == end_y)
+                        killring_push(b->lines.data[start_y]->txt.chars + start_x, end_x - start_x);
+                else
+                        killring_share_lines(b, b->lines.data + start_y, end_y - start_y + 1, start_x, end_x);
+                clipboard_export(b, killring_current());
         }
 
-        b->state = BS_NORMAL;
+        b->v->state = BS_NORMAL;
 
         return BA_REDRAW;
 }
 
+// The cut lines go to the kill ring as they are, only the end of the
+// first one is copied.
 static buffer_action
 cut_selection(buffer *b)
 {
         if (!writable(b))
                 return BA_NOP;
 
-        if (b->state != BS_SELECTION)
+        if (b->v->state != BS_SELECTION)
                 return BA_NOP;
 
-        copy_selection(b);
-        b->state = BS_SELECTION;
-        buffer_action a = del_selection(b);
+        size_t        start_y, start_x, end_y, end_x;
+        buffer_action a;
+
+        selection_bounds(b, &start_y, &start_x, &end_y, &end_x);
+
+        if (end_y >= b->lines.len) {
+                a = del_selection(b);
+        } else if (start_y == end_y) {
+                killring_push(b->lines.data[start_y]->txt.chars + start_x, end_x - start_x);
+                clipboard_export(b, killring_current());
+                a = del_selection(b);
+        } else {
+                const str *first = &b->lines.data[start_y]->txt;
+                linep_ar   taken = array_empty(linep_ar);
+
+                array_append(taken, line_from_n(b->pool, first->chars + start_x, first->len - start_x));
+                a = remove_selection(b, &taken);
+                killring_take_lines(b, taken, end_x);
+                clipboard_export(b, killring_current());
+        }
+
         //add_to_popxy(b);
         return a == BA_REDRAW
                 ? BA_REDRAW : BA_XY;
@@ -1659,16 +2314,18 @@ paste(buffer *b)
 
         newline = 0;
 
-        if (b->state == BS_SELECTION) {
+        if (b->v->state == BS_SELECTION) {
                 del_selection(b);
                 newline = 1;
         }
 
-        for (size_t i = 0; i < g_cpy_buf.len; ++i) {
-                insert_char(b, g_cpy_buf.data[i], 1, 0, 0);
-                if (g_cpy_buf.data[i] == '\n')
-                        newline = 1;
-        }
+        b->yank_y = b->v->al;
+        b->yank_x = b->v->cx;
+
+        if (insert_kill(b, killring_current()))
+                newline = 1;
+
+        b->yanked = 1;
 
         //add_to_popxy(b);
 
@@ -1676,6 +2333,26 @@ paste(buffer *b)
                 ? BA_REDRAW : BA_XY;
 }
 
+// Right after a yank, replace the yanked text with the kill before it.
+static buffer_action
+yank_pop(buffer *b)
+{
+        if (!b->yanked || !writable(b))
+                return BA_NOP;
+
+        b->v->state = BS_SELECTION;
+        b->v->sy    = (unsigned)b->yank_y;
+        b->v->sx    = b->yank_x;
+        del_selection(b);
+
+        insert_kill(b, killring_rotate());
+
+        b->yanked = 1;
+
+        buffer_adjust_scroll(b);
+        return BA_REDRAW;
+}
+
 buffer_action
 buffer_save(buffer *b)
 {
@@ -1698,9 +2375,11 @@ buffer_save(buffer *b)
                 return BA_NOP;
         }
 
-        b->saved = 1;
+        b->saved   = 1;
+        b->stamped = file_stamp_get(b->path.chars, &b->stamp);
 
-        collect_ac_from_buffer(b);
+        ac_flush(b);
+        symindex_refresh();
 
         return BA_XY;
 }
@@ -1722,13 +2401,45 @@ jump_to_line(buffer *b)
         if (no > (int)b->lines.len || no <= 0)
                 return BA_REDRAW;
 
-        b->cx = 0;
-        b->cy = (unsigned)no-1;
-        b->al = (unsigned)no-1;
+        b->v->cx = 0;
+        b->v->cy = (unsigned)no-1;
+        b->v->al = (unsigned)no-1;
 
         return buffer_adjust_scroll(b) == BA_REDRAW ? BA_REDRAW : BA_XY;
 }
 
+// Move to the next (or previous) diagnostic in this buffer, wrapping
+// around at either end.
+static buffer_action
+jump_to_marker(buffer *b,
+               int     prev)
+{
+        const buffer_marker *m;
+        size_t               i;
+
+        if (b->markers.len == 0)
+                return BA_NOP;
+
+        if (prev) {
+                i = marker_lower_bound(b, b->v->al);
+                m = &b->markers.data[i > 0 ? i-1 : b->markers.len-1];
+        } else {
+                i = marker_lower_bound(b, b->v->al+1);
+                m = &b->markers.data[i < b->markers.len ? i : 0];
+        }
+
+        if (m->row >= b->lines.len)
+                return BA_NOP;
+
+        // Tools report display columns, not byte offsets.
+        buffer_jump_to_verts(b, char_index_at_visual_col(&b->lines.data[m->row]->txt,
+                                                         m->col, TAB_WIDTH),
+                             m->row);
+        buffer_center_view(b);
+
+        return BA_REDRAW;
+}
+
 static buffer_action
 metag(buffer *b)
 {
@@ -1741,6 +2452,12 @@ metag(buffer *b)
                         return BA_REQ_NEXTERROR;
                 if (ch == 'p')
                         return BA_REQ_PREVERROR;
+                if (ch == ']')
+                        return jump_to_marker(b, 0);
+                if (ch == '[')
+                        return jump_to_marker(b, 1);
+                if (ch == '.')
+                        return BA_REQ_GOTODEF;
         } break;
         case INPUT_TYPE_ALT: {
                 if (ch == 'g')
@@ -1814,51 +2531,218 @@ handle_normal_input_while_builtin(buffer *b, char ch)
 static str
 get_word_behind_cursor(const buffer *b)
 {
-        str res;
+        const char *chars = b->lines.data[b->v->al]->txt.chars;
+        size_t      st    = b->v->cx;
+        str         res;
 
         res = str_create();
 
-        for (int i = (int)b->cx-1; i >= 0; --i) {
-                char ch = b->lines.data[b->al]->txt.chars[(size_t)i];
-                if (!isalpha(ch) && ch != '_')
-                        break;
-                else
-                        str_insert(&res, 0/*res.len*/, ch);
-        }
+        while (st > 0 && (isalpha(chars[st-1]) || chars[st-1] == '_'))
+                --st;
+
+        str_append_n(&res, chars + st, b->v->cx - st);
 
         return res;
 }
 
+// The identifier the cursor is on or just after, empty if none.
+str
+buffer_word_at_cursor(const buffer *b)
+{
+        const str *s;
+        size_t     st;
+        size_t     en;
+
+        if (b->v->al >= b->lines.len)
+                return str_create();
+
+        s  = &b->lines.data[b->v->al]->txt;
+        st = b->v->cx < s->len ? b->v->cx : s->len;
+        en = st;
+
+        while (st > 0 && (isalnum(s->chars[st-1]) || s->chars[st-1] == '_'))
+                --st;
+        while (en < s->len && (isalnum(s->chars[en]) || s->chars[en] == '_'))
+                ++en;
+
+        str res = str_create();
+        str_append_n(&res, s->chars + st, en - st);
+
+        return res;
+}
+
+// floor(log2(x)) + 1, 0 for 0.
+static unsigned
+ac_bits(size_t x)
+{
+        unsigned n = 0;
+
+        while (x) {
+                ++n;
+                x >>= 1;
+        }
+
+        return n;
+}
+
+typedef struct {
+        const char *word;
+        int         score;
+        size_t      count;
+        size_t      dist;
+} ac_ranked;
+
+static int
+ac_ranked_cmp(const void *a_,
+              const void *b_)
+{
+        const ac_ranked *a = (const ac_ranked *)a_;
+        const ac_ranked *b = (const ac_ranked *)b_;
+
+        if (a->score != b->score)
+                return a->score > b->score ? -1 : 1;
+        if (a->count != b->count)
+                return a->count > b->count ? -1 : 1;
+        if (a->dist != b->dist)
+                return a->dist < b->dist ? -1 : 1;
+        return strcmp(a->word, b->word);
+}
+
+// Ranks the words starting with `prefix' into a new session. Words
+// frequent across all buffers and words last seen close to the cursor
+// come first, each doubling of the count is worth a doubling of the
+// distance twice over. Every match is looked at, only the best
+// BUFFER_AC_MAX are kept in order.
 static void
-display_autocomplete(buffer *b)
+ac_session_build(buffer    *b,
+                 const str *prefix)
 {
-        str      prev;
-        size_t   words_n;
-        char   **words;
+        buffer_ac_session *sess = &b->ac_sess;
+        trie_entry        *entries;
+        ac_ranked          ranked[BUFFER_AC_MAX];
+        size_t             total;
+        size_t             n;
+        size_t             m;
 
-        prev = get_word_behind_cursor(b);
+        ac_flush(b);
 
-        if (prev.len == 0)
-                goto done;
+        ac_session_reset(b);
+        str_overwrite(&sess->prefix, prefix->chars);
+        sess->row = b->v->al;
+        sess->col = b->v->cx;
 
-        words_n = 0;
-        words   = trie_get_completions(b->ac, str_cstr(&prev), MAX_AUTOCOMPLETE, &words_n);
+        if (!(total = wordindex_count(prefix->chars)))
+                return;
 
-        if (words_n > 0) {
-                for (size_t i = 0; i < strlen(words[(b->ac_cycle-1)%words_n]); ++i)
-                        putchar(' ');
+        entries = (trie_entry *)malloc(sizeof(*entries) * total);
+        n       = wordindex_completions(prefix->chars, entries, total);
 
-                gotoxy((unsigned)(b->cx - b->hoff), (unsigned)(b->cy - b->voff));
-                printf(GRAY "%s " RESET, words[(b->ac_cycle++)%words_n] + str_len(&prev));
-                gotoxy((unsigned)(b->cx - b->hoff), (unsigned)(b->cy - b->voff));
-                fflush(stdout);
+        m = 0;
+        for (size_t i = 0; i < n; ++i) {
+                const wordref *ref;
+                size_t         dist;
+                ac_ranked      r;
+                size_t         j;
+
+                // Only the word being typed, nothing to add.
+                if (strlen(entries[i].word) == prefix->len)
+                        continue;
+
+                if (!(ref = wordindex_find(&b->ac_refs, entries[i].word)))
+                        dist = AC_FOREIGN_DIST;
+                else
+                        dist = ref->line > b->v->al ? ref->line - b->v->al : b->v->al - ref->line;
+
+                r = (ac_ranked) {
+                        .word  = entries[i].word,
+                        .score = 2*(int)ac_bits(entries[i].count) - (int)ac_bits(dist),
+                        .count = entries[i].count,
+                        .dist  = dist,
+                };
+
+                if (m == BUFFER_AC_MAX && ac_ranked_cmp(&r, &ranked[m-1]) >= 0)
+                        continue;
+                if (m < BUFFER_AC_MAX)
+                        ++m;
 
-                b->state = BS_AUTO;
+                for (j = m-1; j > 0 && ac_ranked_cmp(&r, &ranked[j-1]) < 0; --j)
+                        ranked[j] = ranked[j-1];
+                ranked[j] = r;
         }
 
-        free(words);
-done:
+        for (size_t i = 0; i < m; ++i)
+                sess->words[sess->words_n++] = ranked[i].word;
+
+        free(entries);
+}
+
+// Is the session still about the word before the cursor?
+static int
+ac_session_valid(const buffer *b)
+{
+        const buffer_ac_session *sess = &b->ac_sess;
+        size_t                   plen = str_len(&sess->prefix);
+        const char              *txt;
+
+        if (sess->words_n == 0 || sess->row != b->v->al || sess->col != b->v->cx)
+                return 0;
+        if (plen > b->v->cx)
+                return 0;
+
+        txt = b->lines.data[b->v->al]->txt.chars;
+        if (b->v->cx > plen && (isalpha(txt[b->v->cx-plen-1]) || txt[b->v->cx-plen-1] == '_'))
+                return 0;
+
+        return !memcmp(txt + b->v->cx - plen, sess->prefix.chars, plen);
+}
+
+// The session for the word before the cursor, ranked again only when
+// it has changed since.
+static buffer_ac_session *
+ac_session(buffer *b)
+{
+        buffer_ac_session *sess = &b->ac_sess;
+        str                prev;
+
+        if (ac_session_valid(b))
+                return sess;
+
+        prev = get_word_behind_cursor(b);
+        if (prev.len > 0)
+                ac_session_build(b, &prev);
+        else
+                ac_session_reset(b);
         str_destroy(&prev);
+
+        return sess;
+}
+
+static void
+display_autocomplete(buffer *b)
+{
+        buffer_ac_session *sess;
+        const char        *word;
+        size_t             plen;
+
+        sess = ac_session(b);
+        if (sess->words_n == 0)
+                return;
+
+        plen = str_len(&sess->prefix);
+
+        // Blank out the previous candidate before drawing the next one.
+        if (sess->cycle > 0)
+                for (size_t i = plen; sess->words[(sess->cycle-1)%sess->words_n][i]; ++i)
+                        putchar(' ');
+
+        word = sess->words[(sess->cycle++)%sess->words_n];
+
+        gotoxy((unsigned)(b->v->cx - b->v->hoff), (unsigned)(b->v->cy - b->v->voff));
+        printf(GRAY "%s " RESET, word + plen);
+        gotoxy((unsigned)(b->v->cx - b->v->hoff), (unsigned)(b->v->cy - b->v->voff));
+        fflush(stdout);
+
+        b->v->state = BS_AUTO;
 }
 
 static buffer_action
@@ -1867,34 +2751,34 @@ accept_autocomplete(buffer *b)
         /*if (!glconf.runtime.enable_auto)
                 return;*/
 
-        /*if (b->state != BS_AUTO)
+        /*if (b->v->state != BS_AUTO)
                 return BA_NOP;*/
 
-        str      prev;
-        size_t   words_n;
-        char   **words;
+        const buffer_ac_session *sess;
+        const char              *s;
 
-        prev    = get_word_behind_cursor(b);
-        words_n = 0;
-        words   = trie_get_completions(b->ac, str_cstr(&prev), MAX_AUTOCOMPLETE, &words_n);
-
-       if (words_n == 0)
+        sess = ac_session(b);
+        if (sess->words_n == 0)
                 goto done;
 
-        char *s = words[(b->ac_cycle-1)%words_n];
-        size_t n = strlen(s);
-        if (isspace(s[n-1]))
-                s[n-1] = 0;
+        s = sess->words[(sess->cycle ? sess->cycle-1 : 0)%sess->words_n];
+
+        {
+                size_t st = str_len(&sess->prefix);
+                size_t en = st;
 
-        for (size_t i = str_len(&prev); s[i]; ++i)
-                str_insert(&b->lines.data[b->al]->txt, b->cx++, s[i]);
+                while (s[en] && !isspace(s[en]))
+                        ++en;
+
+                ac_forget(b, b->v->al, b->v->al);
+                str_insert_n(&b->lines.data[b->v->al]->txt, b->v->cx, s + st, en - st);
+                b->v->cx += (unsigned)(en - st);
+        }
 
 done:
-        str_destroy(&prev);
-        free(words);
-        b->state    = BS_NORMAL;
-        b->ac_cycle = 0;
-        b->wish_col = b->cx;
+        ac_session_reset(b);
+        b->v->state    = BS_NORMAL;
+        b->v->wish_col = b->v->cx;
 
         return buffer_adjust_scroll(b) == BA_REDRAW ? BA_REDRAW : BA_XY;
 }
@@ -1902,10 +2786,10 @@ done:
 static size_t
 find_indent_multiplier(buffer *b)
 {
-        if (b->al == 0)
+        if (b->v->al == 0)
                 return 1;
 
-        const str *s  = &b->lines.data[b->al-1]->txt;
+        const str *s  = &b->lines.data[b->v->al-1]->txt;
         size_t spaces = 0;
 
         for (size_t i = 0; i < s->len; ++i) {
@@ -1932,8 +2816,8 @@ tab(buffer *b, int add_multiplier)
 
         ba = BA_NOP;
 
-        if (b->cx > 0)
-                prevchar = b->lines.data[b->al]->txt.chars[b->cx-1];
+        if (b->v->cx > 0)
+                prevchar = b->lines.data[b->v->al]->txt.chars[b->v->cx-1];
         else
                 prevchar = 0;
 
@@ -1958,7 +2842,7 @@ tab(buffer *b, int add_multiplier)
 
         b->last_tab += (int)(end / (size_t)glconf.runtime.space_amt);
 
-        b->wish_col = b->cx;
+        b->v->wish_col = b->v->cx;
 
         return ba == BA_REDRAW ? BA_REDRAW : BA_XY;
 }
@@ -1966,7 +2850,7 @@ tab(buffer *b, int add_multiplier)
 static buffer_action
 jmp_and_highlight_forward(buffer *b)
 {
-        if (b->state != BS_SELECTION)
+        if (b->v->state != BS_SELECTION)
                 selection(b);
         jump_next_word(b, 0);
         return buffer_adjust_scroll(b) == BA_REDRAW ? BA_REDRAW : BA_XY;
@@ -1995,30 +2879,30 @@ expand_region(buffer *b)
         const line *ln;
         const str *s;
 
-        start = str_at(&b->lines.data[b->al]->txt, b->cx);
-        ln = b->lines.data[b->al];
+        start = str_at(&b->lines.data[b->v->al]->txt, b->v->cx);
+        ln = b->lines.data[b->v->al];
         s = &ln->txt;
 
         if (s->len <= 1)
                 return BA_NOP;
 
         if (start == '(' || start == '[' || start == '{') {
-                if (b->state != BS_SELECTION)
+                if (b->v->state != BS_SELECTION)
                         selection(b);
                 size_t x, y;
                 if (find_next_expand_region(b, &x, &y)) {
-                        b->cx = (unsigned)x;
-                        b->cy = (unsigned)y;
-                        b->al = y;
+                        b->v->cx = (unsigned)x;
+                        b->v->cy = (unsigned)y;
+                        b->v->al = y;
                 }
                 else
                         selection(b);
         } else if (start == '\'' || start == '"') {
-                if (b->state != BS_SELECTION)
+                if (b->v->state != BS_SELECTION)
                         selection(b);
                 right(b);
                 int found = -1;
-                for (size_t i = b->cx+1; i < str_len(s); ++i) {
+                for (size_t i = b->v->cx+1; i < str_len(s); ++i) {
                         if (str_at(s, i) == start) {
                                 found = (int)i;
                                 break;
@@ -2029,26 +2913,26 @@ expand_region(buffer *b)
                         left(b);
                 }
                 else
-                        b->cx = (unsigned)found + 1;
+                        b->v->cx = (unsigned)found + 1;
         } else {
-                if (b->state != BS_SELECTION)
+                if (b->v->state != BS_SELECTION)
                         selection(b);
-                if (isspace(str_at(s, b->cx)) || !isalnum(str_at(s, b->cx))) {
-                        while (b->cx < str_len(s)
-                                && str_at(s, b->cx) != '\n'
-                                && str_at(s, b->cx) != ')'
-                                && str_at(s, b->cx) != '('
-                                && str_at(s, b->cx) != ']'
-                                && str_at(s, b->cx) != '['
-                                && str_at(s, b->cx) != '}'
-                                && str_at(s, b->cx) != '{')
-                                ++b->cx;
+                if (isspace(str_at(s, b->v->cx)) || !isalnum(str_at(s, b->v->cx))) {
+                        while (b->v->cx < str_len(s)
+                                && str_at(s, b->v->cx) != '\n'
+                                && str_at(s, b->v->cx) != ')'
+                                && str_at(s, b->v->cx) != '('
+                                && str_at(s, b->v->cx) != ']'
+                                && str_at(s, b->v->cx) != '['
+                                && str_at(s, b->v->cx) != '}'
+                                && str_at(s, b->v->cx) != '{')
+                                ++b->v->cx;
                 } else {
-                        while (b->cx < str_len(s)
-                                && (isalnum(str_at(s, b->cx))
-                                || str_at(s, b->cx) == '_'
-                                || str_at(s, b->cx) == '.')) {
-                                ++b->cx;
+                        while (b->v->cx < str_len(s)
+                                && (isalnum(str_at(s, b->v->cx))
+                                || str_at(s, b->v->cx) == '_'
+                                || str_at(s, b->v->cx) == '.')) {
+                                ++b->v->cx;
                         }
                 }
         }
@@ -2058,31 +2942,78 @@ expand_region(buffer *b)
 }
 
 // entrypoint
-buffer_action
-buffer_process(buffer *b)
-{
-        (void)visual_width_up_to;
-
-        struct pollfd pfd = {
-                .fd = STDIN_FILENO,
-                .events = POLLIN,
-        };
-
-        int ret = poll(&pfd, 1, 20);
-
-        if (ret < 0)
-                return BA_NOP;
-
-        if (ret == 0)
-                return BA_NOP;
-
-        if (!(pfd.revents & POLLIN))
-                return BA_NOP;
+typedef enum {
+        GAP_NONE,
+        GAP_MOVE,
+        GAP_EDIT,
+} gap_use;
+
+// Keys that only type or move along the line keep the line's gap open
+// (see str_gap_at), so typing costs the same anywhere on a long line.
+// Everything else may read `chars' directly and closes it first.
+static gap_use
+gap_key(const buffer *b,
+        input_type    ty,
+        char          ch)
+{
+        if (b->builtin || b->lines.len == 0)
+                return GAP_NONE;
+
+        if (b->v->state != BS_NORMAL && b->v->state != BS_AUTO)
+                return GAP_NONE;
+
+        switch (ty) {
+        case INPUT_TYPE_ARROW:
+                return ch == LEFT_ARROW || ch == RIGHT_ARROW ? GAP_MOVE : GAP_NONE;
+        case INPUT_TYPE_NORMAL:
+                if (BACKSPACE(ch))
+                        return b->v->cx > 0 ? GAP_EDIT : GAP_NONE;
+                if (ch == '\n' || ch == '\t' || ch == 0)
+                        return GAP_NONE;
+                return b->paste || !strchr("{([\'\"", ch) ? GAP_EDIT : GAP_NONE;
+        case INPUT_TYPE_CTRL:
+                if (ch == CTRL_H)
+                        return b->v->cx > 0 ? GAP_EDIT : GAP_NONE;
+                if (ch == CTRL_D)
+                        return GAP_EDIT;
+                if (ch == CTRL_F || ch == CTRL_B || ch == CTRL_A || ch == CTRL_E)
+                        return GAP_MOVE;
+                return GAP_NONE;
+        default:
+                return GAP_NONE;
+        }
+}
 
-        input_type ty;
-        char ch;
+// Keys that never change the text, the kill ring can go on sharing the
+// buffer's lines through them. Anything else unshares them first.
+static int
+keeps_text(input_type ty,
+           char       ch)
+{
+        switch (ty) {
+        case INPUT_TYPE_ARROW:
+                return 1;
+        case INPUT_TYPE_NORMAL:
+                return ch == 0;
+        case INPUT_TYPE_CTRL:
+                return ch == CTRL_N || ch == CTRL_P || ch == CTRL_F || ch == CTRL_B
+                        || ch == CTRL_A || ch == CTRL_E || ch == CTRL_L || ch == CTRL_V
+                        || ch == CTRL_G || ch == CTRL_S || ch == CTRL_R;
+        case INPUT_TYPE_ALT:
+                return ch == 'f' || ch == 'b' || ch == '{' || ch == '}' || ch == '<'
+                        || ch == '>' || ch == 'm' || ch == 'v' || ch == 'w' || ch == '.'
+                        || ch == 0;
+        default:
+                return 0;
+        }
+}
 
-        switch (ty = get_input(&ch)) {
+static buffer_action
+process_input(buffer     *b,
+              input_type  ty,
+              char        ch)
+{
+        switch (ty) {
         case INPUT_TYPE_PASTE_BEGIN: {
                 b->paste = 1;
         } break;
@@ -2110,7 +3041,7 @@ buffer_process(buffer *b)
                 if (ch == '\t')                             assert(0);
                 else if (BACKSPACE(ch))                     return backspace(b);
                 else if (ch == 0)                           return selection(b);
-                else if (ch == '\n' && b->state == BS_AUTO) return accept_autocomplete(b);
+                else if (ch == '\n' && b->v->state == BS_AUTO) return accept_autocomplete(b);
                 else                                        return insert_char(b, ch, 1, (glconf.flags & FK_TABMODE) == 0, (glconf.flags & FK_NOAUTOBRACKET) == 0);
         } break;
         case INPUT_TYPE_CTRL: {
@@ -2127,7 +3058,7 @@ buffer_process(buffer *b)
                 else if (ch == CTRL_K) return delete_until_eol(b);
                 else if (ch == CTRL_O) {
                         if (insert_char(b, '\n', 0, 0, 0) != BA_NOP) {
-                                --b->cx;
+                                --b->v->cx;
                                 return BA_REDRAW;
                         }
                         return BA_NOP;
@@ -2167,6 +3098,7 @@ buffer_process(buffer *b)
                 else if (ch == 'l')     return lowercase_word(b);
                 else if (ch == 'c')     return uppercase_word(b);
                 else if (ch == 'w')     return copy_selection(b);
+                else if (ch == 'y')     return yank_pop(b);
                 else if (ch == 'x')     return BA_REQ_METAX;
                 else if (ch == '.')     return jmp_and_highlight_forward(b);
                 else if (ch == '\t')    return BA_REQ_SWITCHCOMPL;
@@ -2183,6 +3115,78 @@ buffer_process(buffer *b)
         return BA_NOP;
 }
 
+buffer_action
+buffer_process(buffer *b)
+{
+        (void)visual_width_up_to;
+
+        struct pollfd pfd = {
+                .fd = STDIN_FILENO,
+                .events = POLLIN,
+        };
+
+        int ret = poll(&pfd, 1, 20);
+
+        if (ret < 0)
+                return BA_NOP;
+
+        if (ret == 0)
+                return BA_NOP;
+
+        if (!(pfd.revents & POLLIN))
+                return BA_NOP;
+
+        buffer_action ba;
+        input_type    ty;
+        char          ch;
+        gap_use       gap;
+
+        ty  = get_input(&ch);
+        gap = gap_key(b, ty, ch);
+
+        if (!keeps_text(ty, ch))
+                killring_unshare(b);
+
+        if (!(ty == INPUT_TYPE_ALT && ch == 'y'))
+                b->yanked = 0;
+
+        if (gap == GAP_NONE)
+                str_gap_close();
+        else if (gap == GAP_EDIT)
+                str_gap_at(&b->lines.data[b->v->al]->txt, b->v->cx);
+
+        ba = process_input(b, ty, ch);
+
+        // The cursor left the line.
+        if (gap != GAP_NONE && !str_gapped(&b->lines.data[b->v->al]->txt))
+                str_gap_close();
+
+        // The other monitors showing this buffer are out of date as well.
+        if (b->views.len && !keeps_text(ty, ch) && (ba == BA_NOP || ba == BA_XY))
+                ba = BA_REDRAW;
+
+        // Every row move walks the dirty runs past it.
+        if (b->ac_dirty.len > AC_DIRTY_RUNS_MAX)
+                ac_flush(b);
+
+        return ba;
+}
+
+static struct {
+        const buffer *b;
+        const char   *msg;
+} g_notice;
+
+void
+buffer_notify(const buffer *b,
+              const char   *msg)
+{
+        g_notice.b   = b;
+        g_notice.msg = msg;
+        draw_status(b, msg);
+        fflush(stdout);
+}
+
 static void
 draw_status(const buffer *b,
             const char   *msg)
@@ -2192,14 +3196,19 @@ draw_status(const buffer *b,
 
         len = 0;
 
+        if (!msg && b == g_notice.b) {
+                msg        = g_notice.msg;
+                g_notice.b = NULL;
+        }
+
         gotoxy(0, (unsigned)glconf.term.h);
 
         printf(INVERT);
 
-        sprintf(buf, "[ww-v" VERSION "] %s:%d:%d%s%s %s Monitor:%d %s%d>",
-                str_cstr(&b->name),
-                b->cy+1,
-                b->cx+1,
+        sprintf(buf, "[ww-v" VERSION "] %s:%d:%d%s%s %s Monitor:%zu %s%d>",
+                b->name.chars,
+                b->v->cy+1,
+                b->v->cx+1,
                 !b->saved ? "*" : "",
                 b->writable ? "" : " READONLY",
                 state_to_cstr(b),
@@ -2209,10 +3218,35 @@ draw_status(const buffer *b,
         printf("%s", buf);
         len += strlen(buf);
 
+        if (b->markers.len > 0) {
+                size_t nerr = 0, nwarn = 0;
+
+                for (size_t i = 0; i < b->markers.len; ++i) {
+                        if (b->markers.data[i].sev == DIAG_ERROR)
+                                ++nerr;
+                        else if (b->markers.data[i].sev == DIAG_WARNING)
+                                ++nwarn;
+                }
+
+                sprintf(buf, " E:%zu W:%zu", nerr, nwarn);
+                printf("%s", buf);
+                len += strlen(buf);
+        }
+
         if (msg) {
                 sprintf(buf, " [%s" RESET INVERT "]", msg);
                 printf("%s", buf);
                 len += strlen(buf);
+        } else {
+                const buffer_marker *m = marker_at_row(b, b->v->al);
+
+                // Diagnostic messages can be arbitrarily long, clip to the line.
+                if (m && m->msg[0] && len + 4 < glconf.term.w) {
+                        snprintf(buf, sizeof(buf), " [%.*s]",
+                                 (int)(glconf.term.w - len - 3), m->msg);
+                        printf("%s", buf);
+                        len += strlen(buf);
+                }
         }
 
         for (size_t i = len; i < glconf.term.w; ++i)
@@ -2220,7 +3254,7 @@ draw_status(const buffer *b,
 
         printf(RESET);
 
-        gotoxy(b->cx - (unsigned)b->hoff, b->cy - (unsigned)b->voff);
+        gotoxy(b->v->cx - (unsigned)b->v->hoff, b->v->cy - (unsigned)b->v->voff);
 }
 
 static int
@@ -2233,22 +3267,22 @@ line_selection_range(const buffer *b,
         // Computes the selection range for a given line
         // Returns 1 if there is a selection on this line, 0 otherwise
 
-        if (b->state != BS_SELECTION)
+        if (b->v->state != BS_SELECTION)
                 return 0;
 
         size_t start_line, start_col, end_line, end_col;
 
         // absolute selection bounds
-        if (b->sy < b->al || (b->sy == b->al && b->sx <= b->cx)) {
-                start_line = b->sy;
-                start_col  = b->sx;
-                end_line   = b->al;
-                end_col    = b->cx;
+        if (b->v->sy < b->v->al || (b->v->sy == b->v->al && b->v->sx <= b->v->cx)) {
+                start_line = b->v->sy;
+                start_col  = b->v->sx;
+                end_line   = b->v->al;
+                end_col    = b->v->cx;
         } else {
-                start_line = b->al;
-                start_col  = b->cx;
-                end_line   = b->sy;
-                end_col    = b->sx;
+                start_line = b->v->al;
+                start_col  = b->v->cx;
+                end_line   = b->v->sy;
+                end_col    = b->v->sx;
         }
 
         if (idx < start_line || idx > end_line)
@@ -2276,10 +3310,10 @@ find_trailing_whitespace_start(const str *s)
 {
         if (s->len == 0)
                 return -1;
-        if (s->len <= 1 || !isspace(s->chars[s->len-2]))
+        if (s->len <= 1 || !isspace(str_at(s, s->len-2)))
                 return -1;
         for (int i = (int)s->len-1; i >= 0; --i) {
-                if (!isspace(s->chars[i]))
+                if (!isspace(str_at(s, (size_t)i)))
                         return (ssize_t)i;
         }
         return 0;
@@ -2288,55 +3322,67 @@ find_trailing_whitespace_start(const str *s)
 static void
 drawln(const buffer *b, size_t idx)
 {
-        if (idx < b->voff || idx >= b->voff + get_win_hight(b))
+        if (idx < b->v->voff || idx >= b->v->voff + get_win_hight(b))
                 return;
         const line *ln = b->lines.data[idx];
         const str *s = &ln->txt;
-        unsigned y = b->size.hs + (unsigned)(idx - b->voff);
+        unsigned y = b->v->size.hs + (unsigned)(idx - b->v->voff);
         unsigned win_w = get_win_width(b);
         unsigned tabw = TAB_WIDTH;
 
-        gotoxy(b->size.ws, y);
+        gotoxy(b->v->size.ws, y);
         for (unsigned x = 0; x < win_w; ++x)
                 putchar(' ');
 
-        if (b->hoff >= visual_column(s, s->len, tabw))
+        if (b->v->hoff >= visual_column(s, s->len, tabw))
                 return;
 
-        gotoxy(b->size.ws, y);
+        gotoxy(b->v->size.ws, y);
         unsigned screen_col = 0;
         size_t char_i = 0;
 
         // skip characters until horizontal scroll offset
-        while (char_i < s->len && visual_column(s, char_i, tabw) < b->hoff)
-                ++char_i;
+        char_i = char_index_at_visual_col(s, (unsigned)b->v->hoff, tabw);
 
         // determine selection range on this line
         size_t sel_start = 0, sel_end = 0;
-        int cursor_on_line = ((size_t)b->cy == idx);
+        int cursor_on_line = ((size_t)b->v->cy == idx);
         int line_has_selection = line_selection_range(b, idx, s->len, &sel_start, &sel_end);
         int_ar search_matches = {0};
         size_t qlen = str_len(&b->last_search);
         size_t match_idx = 0;
 
-        if (b->state == BS_SEARCH)
+        if (b->v->state == BS_SEARCH)
                 search_matches = find_line_matches(b, s);
 
         ssize_t whitespace_start = find_trailing_whitespace_start(s);
 
+        // underline diagnostics from the first non-blank character
+        const buffer_marker *mk = marker_at_row(b, idx);
+        const char *mk_style = NULL;
+        size_t mk_start = 0;
+
+        if (mk) {
+                mk_style = mk->sev == DIAG_ERROR ? UNDERLINE RED
+                        : mk->sev == DIAG_WARNING ? UNDERLINE YELLOW
+                        : UNDERLINE CYAN;
+                while (mk_start < s->len && isspace(str_at(s, mk_start)))
+                        ++mk_start;
+        }
+
         // draw visible part
         while (char_i < s->len && screen_col < win_w) {
-                char c = s->chars[char_i];
+                char c = str_at(s, char_i);
                 int in_search = 0;
                 int in_cursor_match = 0;
 
-                if (b->state == BS_SEARCH && search_matches.len > 0) {
+                if (b->v->state == BS_SEARCH && search_matches.len > 0) {
                         if (match_idx < search_matches.len) {
                                 int mstart = search_matches.data[match_idx];
                                 int mend = mstart + (int)qlen;
                                 if ((int)char_i >= mstart && (int)char_i < mend) {
                                         in_search = 1;
-                                        if (cursor_on_line && (int)b->cx >= mstart && (int)b->cx < mend)
+                                        if (cursor_on_line && (int)b->v->cx >= mstart && (int)b->v->cx < mend)
                                                 in_cursor_match = 1;
                                 }
                                 else if ((int)char_i >= mend)
@@ -2347,7 +3393,7 @@ drawln(const buffer *b, size_t idx)
                 int in_selection = line_has_selection && char_i >= sel_start && char_i < sel_end;
 
                 if (c == '\t') {
-                        unsigned next_stop = (unsigned)(tabw - ((b->hoff + screen_col) % tabw));
+                        unsigned next_stop = (unsigned)(tabw - ((b->v->hoff + screen_col) % tabw));
                         for (unsigned t = 0; t < next_stop && screen_col < win_w; ++t) {
                                 if (in_selection)
                                         printf(INVERT BOLD " " RESET);
@@ -2381,6 +3427,8 @@ drawln(const buffer *b, size_t idx)
                                         printf(INVERT ORANGE BOLD "%c" RESET, c);
                                 else if (in_search)
                                         printf(INVERT YELLOW BOLD "%c" RESET, c);
+                                else if (mk && char_i >= mk_start && c != '\n')
+                                        printf("%s%c" RESET, mk_style, c);
                                 else
                                         putchar(c);
                         }
@@ -2396,13 +3444,13 @@ drawln(const buffer *b, size_t idx)
 void
 buffer_drawxy(const buffer *b)
 {
-        drawln(b, b->cy);
+        drawln(b, b->v->cy);
 
-        const str *s = &b->lines.data[b->al]->txt;
-        unsigned visual_x = visual_column(s, b->cx, TAB_WIDTH);
+        const str *s = &b->lines.data[b->v->al]->txt;
+        unsigned visual_x = visual_column(s, b->v->cx, TAB_WIDTH);
 
-        unsigned screen_x = b->size.ws + (unsigned)(visual_x > b->hoff ? visual_x - b->hoff : 0);
-        unsigned screen_y = b->size.hs + (unsigned)(b->cy - b->voff);
+        unsigned screen_x = b->v->size.ws + (unsigned)(visual_x > b->v->hoff ? visual_x - b->v->hoff : 0);
+        unsigned screen_y = b->v->size.hs + (unsigned)(b->v->cy - b->v->voff);
 
         draw_status(b, NULL);
         gotoxy(screen_x, screen_y);
@@ -2416,31 +3464,26 @@ buffer_draw(const buffer *b)
 
         // Clear the entire buffer area
         for (unsigned y = 0; y < win_h+1; ++y) {
-                gotoxy(b->size.ws, b->size.hs + y);
+                gotoxy(b->v->size.ws, b->v->size.hs + y);
                 for (unsigned x = 0; x < win_w; ++x)
                         putchar(' ');
         }
 
         // Draw all visible lines once
         for (size_t i = 0; i < win_h; ++i) {
-                size_t idx = b->voff + i;
+                size_t idx = b->v->voff + i;
                 if (idx >= b->lines.len)
                         break;
                 drawln(b, idx);
         }
 
         // Place cursor
-        const str *s      = &b->lines.data[b->al]->txt;
-        unsigned visual_x = visual_column(s, b->cx, TAB_WIDTH);
-        unsigned screen_x = b->size.ws + (unsigned)(visual_x > b->hoff ? visual_x - b->hoff : 0);
-        unsigned screen_y = b->size.hs + (unsigned)(b->cy - b->voff);
+        const str *s      = &b->lines.data[b->v->al]->txt;
+        unsigned visual_x = visual_column(s, b->v->cx, TAB_WIDTH);
+        unsigned screen_x = b->v->size.ws + (unsigned)(visual_x > b->v->hoff ? visual_x - b->v->hoff : 0);
+        unsigned screen_y = b->v->size.hs + (unsigned)(b->v->cy - b->v->voff);
 
         draw_status(b, NULL);
         gotoxy(screen_x, screen_y);
 }
 
-void
-init_buffer_translation_unit(void)
-{
-        g_cpy_buf = array_empty(char_ar);
-}
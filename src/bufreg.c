@@ -0,0 +1,167 @@
+/*
+ * ww: a simple editor
+ * Copyright (C) 2026 malloc-nbytes
+ * Contact: zdhdev@yahoo.com
+
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "bufreg.h"
+#include "io.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+MAP_IMPL(const char *, buffer *, bufmap);
+
+static unsigned
+key_hash(const char **k)
+{
+        return hash_cstr(*k);
+}
+
+static int
+key_cmp(const char **a,
+        const char **b)
+{
+        return strcmp(*a, *b);
+}
+
+void
+bufreg_init(bufreg *r)
+{
+        r->mru      = NULL;
+        r->lru      = NULL;
+        r->len      = 0;
+        r->resident = 0;
+        r->by_name  = bufmap_create(key_hash, key_cmp);
+        r->by_path  = bufmap_create(key_hash, key_cmp);
+}
+
+static void
+unlink_buffer(bufreg *r,
+              buffer *b)
+{
+        if (b->mru_prev)
+                b->mru_prev->mru_next = b->mru_next;
+        else
+                r->mru = b->mru_next;
+
+        if (b->mru_next)
+                b->mru_next->mru_prev = b->mru_prev;
+        else
+                r->lru = b->mru_prev;
+
+        b->mru_prev = b->mru_next = NULL;
+}
+
+void
+bufreg_add(bufreg *r,
+           buffer *b)
+{
+        if (!(b->reg_path = get_realpath(b->path.chars)))
+                b->reg_path = strdup(b->path.chars);
+
+        b->mru_next = NULL;
+        b->mru_prev = r->lru;
+        if (r->lru)
+                r->lru->mru_next = b;
+        else
+                r->mru = b;
+        r->lru = b;
+        ++r->len;
+        slab_pool_count_into(b->pool, &r->resident);
+
+        if (!bufmap_contains(&r->by_name, b->name.chars))
+                bufmap_insert(&r->by_name, b->name.chars, b);
+        if (!bufmap_contains(&r->by_path, b->reg_path))
+                bufmap_insert(&r->by_path, b->reg_path, b);
+}
+
+void
+bufreg_remove(bufreg *r,
+              buffer *b)
+{
+        buffer **n;
+        buffer **p;
+
+        unlink_buffer(r, b);
+        --r->len;
+        slab_pool_count_into(b->pool, NULL);
+
+        n = bufmap_get(&r->by_name, b->name.chars);
+        p = bufmap_get(&r->by_path, b->reg_path);
+
+        if (n && *n == b) {
+                bufmap_remove(&r->by_name, b->name.chars);
+                for (buffer *it = r->lru; it; it = it->mru_prev)
+                        if (!strcmp(it->name.chars, b->name.chars)) {
+                                bufmap_insert(&r->by_name, it->name.chars, it);
+                                break;
+                        }
+        }
+
+        if (p && *p == b) {
+                bufmap_remove(&r->by_path, b->reg_path);
+                for (buffer *it = r->lru; it; it = it->mru_prev)
+                        if (!strcmp(it->reg_path, b->reg_path)) {
+                                bufmap_insert(&r->by_path, it->reg_path, it);
+                                break;
+                        }
+        }
+
+        free(b->reg_path);
+        b->reg_path = NULL;
+}
+
+void
+bufreg_touch(bufreg *r,
+             buffer *b)
+{
+        if (!b || r->mru == b)
+                return;
+
+        unlink_buffer(r, b);
+
+        b->mru_next = r->mru;
+        r->mru->mru_prev = b;
+        r->mru = b;
+}
+
+buffer *
+bufreg_by_name(bufreg     *r,
+               const char *name)
+{
+        buffer **b = bufmap_get(&r->by_name, name);
+        return b ? *b : NULL;
+}
+
+buffer *
+bufreg_by_path(bufreg     *r,
+               const char *path)
+{
+        buffer **b;
+        char    *real;
+
+        if ((b = bufmap_get(&r->by_path, path)))
+                return *b;
+
+        if (!(real = get_realpath(path)))
+                return NULL;
+
+        b = bufmap_get(&r->by_path, real);
+        free(real);
+
+        return b ? *b : NULL;
+}
@@ -0,0 +1,323 @@
+/*
+ * ww: a simple editor
+ * Copyright (C) 2026 malloc-nbytes
+ * Contact: zdhdev@yahoo.com
+
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, see <https://www.gnu.org/licenses/>.
+ */
+#include "clipboard.h"
+#include "buffer.h"
+#include "glconf.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdint.h>
+#include <spawn.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+extern char **environ;
+
+// Bytes written at a time, a newer export is checked for in between.
+#define CLIPBOARD_CHUNK (64*1024)
+
+// GNU screen only passes this much of a DCS string through.
+#define SCREEN_DCS_MAX 768
+
+static struct {
+        pthread_mutex_t  lock;
+        pthread_cond_t   wake;
+        pthread_t        thread;
+        int              started;
+        kill_text       *text;   // waiting to be exported, NULL if none
+        unsigned long    gen;    // bumped by every export
+} g_clip = {
+        .lock = PTHREAD_MUTEX_INITIALIZER,
+        .wake = PTHREAD_COND_INITIALIZER,
+};
+
+static int
+superseded(unsigned long gen)
+{
+        unsigned long now;
+
+        pthread_mutex_lock(&g_clip.lock);
+        now = g_clip.gen;
+        pthread_mutex_unlock(&g_clip.lock);
+
+        return now != gen;
+}
+
+// Returns 0 if the write failed or a newer export came in.
+static int
+write_all(int            fd,
+          const char    *p,
+          size_t         n,
+          unsigned long  gen)
+{
+        while (n > 0) {
+                ssize_t w;
+
+                if (gen && superseded(gen))
+                        return 0;
+
+                if ((w = write(fd, p, n < CLIPBOARD_CHUNK ? n : CLIPBOARD_CHUNK)) < 0) {
+                        if (errno == EINTR)
+                                continue;
+                        return 0;
+                }
+
+                p += w;
+                n -= (size_t)w;
+        }
+
+        return 1;
+}
+
+// Configs used to give a template like "echo -E '%s' | xclip", only
+// the part after the last pipe reads stdin.
+static const char *
+command_of(const char *conf)
+{
+        const char *bar;
+
+        if (!strstr(conf, "%s"))
+                return conf;
+
+        if (!(bar = strrchr(conf, '|')))
+                return NULL;
+
+        return bar + 1;
+}
+
+static void
+to_command(const char    *cmd,
+           const char    *text,
+           size_t         len,
+           unsigned long  gen)
+{
+        posix_spawn_file_actions_t fa;
+        posix_spawnattr_t          attr;
+        sigset_t                   none;
+        char                      *argv[] = {(char *)"sh", (char *)"-c", (char *)(uintptr_t)cmd, NULL};
+        int                        fds[2];
+        pid_t                      pid;
+        int                        err;
+
+        if (pipe(fds) != 0)
+                return;
+
+        (void)fcntl(fds[0], F_SETFD, FD_CLOEXEC);
+        (void)fcntl(fds[1], F_SETFD, FD_CLOEXEC);
+
+        posix_spawn_file_actions_init(&fa);
+        posix_spawn_file_actions_adddup2(&fa, fds[0], STDIN_FILENO);
+        posix_spawn_file_actions_addopen(&fa, STDOUT_FILENO, "/dev/null", O_WRONLY, 0);
+        posix_spawn_file_actions_addopen(&fa, STDERR_FILENO, "/dev/null", O_WRONLY, 0);
+
+        // Our thread blocks SIGPIPE, the command should not.
+        sigemptyset(&none);
+        posix_spawnattr_init(&attr);
+        posix_spawnattr_setsigmask(&attr, &none);
+        posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETSIGMASK);
+
+        err = posix_spawn(&pid, "/bin/sh", &fa, &attr, argv, environ);
+
+        posix_spawnattr_destroy(&attr);
+        posix_spawn_file_actions_destroy(&fa);
+        close(fds[0]);
+
+        if (err == 0)
+                (void)write_all(fds[1], text, len, gen);
+
+        close(fds[1]);
+
+        if (err == 0)
+                while (waitpid(pid, NULL, 0) < 0 && errno == EINTR)
+                        ;
+}
+
+static size_t
+base64(const char *src,
+       size_t      n,
+       char       *dst)
+{
+        static const char digits[] =
+                "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+        const unsigned char *s = (const unsigned char *)src;
+        char                *d = dst;
+        size_t               i;
+
+        for (i = 0; i + 2 < n; i += 3) {
+                *d++ = digits[s[i] >> 2];
+                *d++ = digits[(s[i] & 3) << 4 | s[i+1] >> 4];
+                *d++ = digits[(s[i+1] & 15) << 2 | s[i+2] >> 6];
+                *d++ = digits[s[i+2] & 63];
+        }
+
+        if (i < n) {
+                *d++ = digits[s[i] >> 2];
+                if (i + 1 < n) {
+                        *d++ = digits[(s[i] & 3) << 4 | s[i+1] >> 4];
+                        *d++ = digits[(s[i+1] & 15) << 2];
+                } else {
+                        *d++ = digits[(s[i] & 3) << 4];
+                        *d++ = '=';
+                }
+                *d++ = '=';
+        }
+
+        return (size_t)(d - dst);
+}
+
+// OSC 52 goes through tmux and screen wrapped in their passthrough DCS
+// strings, screen's cut into pieces it accepts.
+static void
+to_terminal(const char *text,
+            size_t      len)
+{
+        const char *mux    = getenv("TMUX");
+        const char *term   = getenv("TERM");
+        int         screen = !mux && term && !strncmp(term, "screen", 6);
+        size_t      n      = 4*((len + 2)/3);
+        char       *seq;
+        char       *out;
+        size_t      m;
+
+        seq = (char *)malloc(n + 8);
+
+        memcpy(seq, "\033]52;c;", 7);
+        m  = 7;
+        m += base64(text, len, seq + m);
+        seq[m++] = '\a';
+
+        if (mux) {
+                out = (char *)malloc(m + 16);
+                memcpy(out, "\033Ptmux;\033", 8);
+                memcpy(out + 8, seq, m);
+                memcpy(out + 8 + m, "\033\\", 2);
+                m += 10;
+        } else if (screen) {
+                size_t pieces = (m + SCREEN_DCS_MAX - 1)/SCREEN_DCS_MAX;
+                size_t k      = 0;
+
+                out = (char *)malloc(m + pieces*4);
+                for (size_t i = 0; i < m; i += SCREEN_DCS_MAX) {
+                        size_t c = m - i < SCREEN_DCS_MAX ? m - i : SCREEN_DCS_MAX;
+                        memcpy(out + k, "\033P", 2);
+                        memcpy(out + k + 2, seq + i, c);
+                        memcpy(out + k + 2 + c, "\033\\", 2);
+                        k += c + 4;
+                }
+                m = k;
+        } else {
+                out = seq;
+                seq = NULL;
+        }
+
+        free(seq);
+
+        // A sequence must not be split by a redraw. The main thread only
+        // prints through stdio, holding its lock keeps it out. Once
+        // started the sequence is always finished.
+        flockfile(stdout);
+        fflush(stdout);
+        (void)write_all(STDOUT_FILENO, out, m, 0);
+        funlockfile(stdout);
+
+        free(out);
+}
+
+static void *
+worker(void *arg)
+{
+        (void)arg;
+
+        sigset_t sigpipe;
+
+        // A command that exits without reading gives EPIPE instead.
+        sigemptyset(&sigpipe);
+        sigaddset(&sigpipe, SIGPIPE);
+        pthread_sigmask(SIG_BLOCK, &sigpipe, NULL);
+
+        while (1) {
+                const char    *conf;
+                const char    *cmd;
+                kill_text     *text;
+                unsigned long  gen;
+
+                pthread_mutex_lock(&g_clip.lock);
+                while (!g_clip.text)
+                        pthread_cond_wait(&g_clip.wake, &g_clip.lock);
+                text        = g_clip.text;
+                gen         = g_clip.gen;
+                g_clip.text = NULL;
+                pthread_mutex_unlock(&g_clip.lock);
+
+                conf = glconf.runtime.to_clipboard;
+
+                if (!strcmp(conf, CLIPBOARD_OSC52))
+                        to_terminal(text->chars, text->len);
+                else if ((cmd = command_of(conf)))
+                        to_command(cmd, text->chars, text->len, gen);
+
+                kill_text_drop(text);
+        }
+
+        return NULL;
+}
+
+void
+clipboard_export(const buffer     *b,
+                 const kill_entry *e)
+{
+        const char *conf = glconf.runtime.to_clipboard;
+        kill_text  *text;
+
+        if (!e || !conf || !conf[0])
+                return;
+
+        text = killring_hold(e);
+
+        if (!strcmp(conf, CLIPBOARD_OSC52) && text->len > CLIPBOARD_OSC52_MAX) {
+                kill_text_drop(text);
+                buffer_notify(b, "too big for the terminal clipboard, only in the kill ring");
+                return;
+        }
+
+        pthread_mutex_lock(&g_clip.lock);
+
+        if (!g_clip.started) {
+                if (pthread_create(&g_clip.thread, NULL, worker, NULL) != 0) {
+                        pthread_mutex_unlock(&g_clip.lock);
+                        kill_text_drop(text);
+                        return;
+                }
+                pthread_detach(g_clip.thread);
+                g_clip.started = 1;
+        }
+
+        kill_text_drop(g_clip.text);
+        g_clip.text = text;
+        ++g_clip.gen;
+
+        pthread_cond_signal(&g_clip.wake);
+        pthread_mutex_unlock(&g_clip.lock);
+}
@@ -0,0 +1,363 @@
+/*
+ * ww: a simple editor
+ * Copyright (C) 2026 malloc-nbytes
+ * Contact: zdhdev@yahoo.com
+
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, see <https://www.gnu.org/licenses/>.
+ */
+#include "colidx.h"
+#include "mem.h"
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+// How a run of text moves the column. Without a tab it just adds
+// `len'. With one, `k0' bytes lead up to the first tab, which jumps to
+// the next stop, and the remainder is `rest' columns wide measured
+// from that stop. Tab stops repeat, so this does not depend on where
+// the run starts and two runs can be joined into one.
+typedef struct {
+        size_t len;
+        size_t k0;
+        size_t rest;
+        int    tab;
+} colsum;
+
+typedef struct {
+        const str     *key;
+        size_t         len;
+        unsigned       tabw;
+        size_t         leaves; // a power of two, unused ones are empty
+        colsum        *tree;   // 2*leaves nodes, the root is at 1
+        unsigned long  used;
+} colidx;
+
+// Only a handful of very long lines are ever looked at together.
+#define COLIDX_SLOTS 8
+
+// An edit spanning more than COLIDX_SPAN chunks, or growing one past
+// COLIDX_CHUNK*COLIDX_GROW bytes, drops the index to be rebuilt.
+#define COLIDX_SPAN 64
+#define COLIDX_GROW 4
+
+static colidx          g_slots[COLIDX_SLOTS];
+static unsigned long   g_tick = 0;
+static pthread_mutex_t g_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static size_t
+tabstop(size_t col, unsigned tabw)
+{
+        return (col/tabw + 1)*tabw;
+}
+
+static size_t
+advance(colsum c, size_t col, unsigned tabw)
+{
+        if (!c.tab)
+                return col + c.len;
+        return tabstop(col + c.k0, tabw) + c.rest;
+}
+
+static colsum
+join(colsum a, colsum b, unsigned tabw)
+{
+        colsum r = { .len = a.len + b.len, .tab = a.tab || b.tab };
+
+        if (!a.tab) {
+                r.k0   = a.len + b.k0;
+                r.rest = b.rest;
+        } else if (!b.tab) {
+                r.k0   = a.k0;
+                r.rest = a.rest + b.len;
+        } else {
+                r.k0   = a.k0;
+                r.rest = tabstop(a.rest + b.k0, tabw) + b.rest;
+        }
+
+        return r;
+}
+
+// The `n' bytes of `s' from `st', read in runs as the str may have
+// its gap open.
+static colsum
+scan(const str *s,
+     size_t     st,
+     size_t     n,
+     unsigned   tabw)
+{
+        colsum c = { .len = n };
+
+        while (n > 0) {
+                const char *p;
+                size_t      k = str_run(s, st, &p);
+
+                if (k > n)
+                        k = n;
+
+                for (size_t i = 0; i < k; ++i) {
+                        if (c.tab)
+                                c.rest = p[i] == '\t' ? tabstop(c.rest, tabw) : c.rest + 1;
+                        else if (p[i] == '\t')
+                                c.tab = 1;
+                        else
+                                ++c.k0;
+                }
+
+                st += k;
+                n  -= k;
+        }
+
+        return c;
+}
+
+static void
+pull(colidx *ix, size_t leaf)
+{
+        for (size_t k = (ix->leaves + leaf)/2; k > 0; k /= 2)
+                ix->tree[k] = join(ix->tree[2*k], ix->tree[2*k+1], ix->tabw);
+}
+
+static void
+release(colidx *ix)
+{
+        free(ix->tree);
+        memset(ix, 0, sizeof(*ix));
+}
+
+static void
+build(colidx   *ix,
+      const str *s,
+      unsigned   tabw)
+{
+        size_t n      = (s->len + COLIDX_CHUNK - 1)/COLIDX_CHUNK;
+        size_t leaves = 1;
+
+        while (leaves < n)
+                leaves *= 2;
+
+        if (ix->leaves != leaves) {
+                free(ix->tree);
+                ix->tree = (colsum *)alloc(2*leaves*sizeof(colsum));
+        }
+
+        memset(ix->tree, 0, 2*leaves*sizeof(colsum));
+        ix->key    = s;
+        ix->len    = s->len;
+        ix->tabw   = tabw;
+        ix->leaves = leaves;
+
+        for (size_t i = 0; i < n; ++i) {
+                size_t st = i*COLIDX_CHUNK;
+                size_t en = st + COLIDX_CHUNK < s->len ? st + COLIDX_CHUNK : s->len;
+                ix->tree[leaves + i] = scan(s, st, en - st, tabw);
+        }
+
+        for (size_t k = leaves - 1; k > 0; --k)
+                ix->tree[k] = join(ix->tree[2*k], ix->tree[2*k+1], tabw);
+}
+
+static colidx *
+find(const str *s)
+{
+        for (size_t i = 0; i < COLIDX_SLOTS; ++i)
+                if (g_slots[i].key == s)
+                        return &g_slots[i];
+        return NULL;
+}
+
+// The up to date index of `s', made or rebuilt as needed.
+static colidx *
+get(const str *s,
+    unsigned   tabw)
+{
+        colidx *ix = find(s);
+
+        if (!ix) {
+                ix = &g_slots[0];
+                for (size_t i = 1; i < COLIDX_SLOTS && ix->key; ++i)
+                        if (!g_slots[i].key || g_slots[i].used < ix->used)
+                                ix = &g_slots[i];
+                build(ix, s, tabw);
+        } else if (ix->len != s->len || ix->tabw != tabw) {
+                build(ix, s, tabw);
+        }
+
+        ix->used = ++g_tick;
+        return ix;
+}
+
+// The chunk holding byte `p' (< the total length), where it starts and
+// the column it starts at.
+static size_t
+locate(const colidx *ix,
+       size_t        p,
+       size_t       *pos,
+       size_t       *col)
+{
+        size_t k = 1;
+
+        *pos = 0;
+        *col = 0;
+
+        while (k < ix->leaves) {
+                colsum l = ix->tree[2*k];
+                if (p < *pos + l.len) {
+                        k = 2*k;
+                } else {
+                        *pos += l.len;
+                        *col  = advance(l, *col, ix->tabw);
+                        k     = 2*k+1;
+                }
+        }
+
+        return k - ix->leaves;
+}
+
+// The column byte `i' of `s' is drawn at.
+size_t
+colidx_column(const str *s,
+              size_t     i,
+              unsigned   tabw)
+{
+        colidx *ix;
+        size_t  pos;
+        size_t  col;
+
+        if (s->len == 0)
+                return 0;
+
+        pthread_mutex_lock(&g_lock);
+        ix = get(s, tabw);
+
+        if (i >= s->len) {
+                col = advance(ix->tree[1], 0, tabw);
+        } else {
+                (void)locate(ix, i, &pos, &col);
+                for (; pos < i; ++pos)
+                        col = str_at(s, pos) == '\t' ? tabstop(col, tabw) : col + 1;
+        }
+
+        pthread_mutex_unlock(&g_lock);
+        return col;
+}
+
+// The first byte of `s' drawn at or past column `target', the length
+// of `s' if there is none.
+size_t
+colidx_index(const str *s,
+             size_t     target,
+             unsigned   tabw)
+{
+        colidx *ix;
+        size_t  k   = 1;
+        size_t  pos = 0;
+        size_t  col = 0;
+        size_t  end;
+
+        if (target == 0 || s->len == 0)
+                return 0;
+
+        pthread_mutex_lock(&g_lock);
+        ix = get(s, tabw);
+
+        if (advance(ix->tree[1], 0, tabw) < target) {
+                pthread_mutex_unlock(&g_lock);
+                return s->len;
+        }
+
+        while (k < ix->leaves) {
+                colsum l     = ix->tree[2*k];
+                size_t after = advance(l, col, tabw);
+                if (after >= target) {
+                        k = 2*k;
+                } else {
+                        pos += l.len;
+                        col  = after;
+                        k    = 2*k+1;
+                }
+        }
+
+        end = pos + ix->tree[k].len;
+        for (; pos < end && col < target; ++pos)
+                col = str_at(s, pos) == '\t' ? tabstop(col, tabw) : col + 1;
+
+        pthread_mutex_unlock(&g_lock);
+        return pos;
+}
+
+// `s' already holds the edit: `removed' bytes at `at' were replaced by
+// `inserted' new ones. Only the chunks touched are rescanned.
+void
+colidx_edit(const str *s,
+            size_t     at,
+            size_t     removed,
+            size_t     inserted)
+{
+        colidx *ix;
+        size_t  old;
+        size_t  l0, l1;
+        size_t  st, en, col;
+        size_t  n;
+
+        pthread_mutex_lock(&g_lock);
+
+        if (!(ix = find(s)))
+                goto done;
+
+        old = ix->tree[1].len;
+
+        if (s->len < COLIDX_MIN || old == 0
+            || at + removed > old || old - removed + inserted != s->len) {
+                release(ix);
+                goto done;
+        }
+
+        l0 = locate(ix, at < old ? at : old - 1, &st, &col);
+        l1 = removed ? locate(ix, at + removed - 1, &en, &col) : l0;
+
+        n = 0;
+        for (size_t i = l0; i <= l1; ++i)
+                n += ix->tree[ix->leaves + i].len;
+        n = n - removed + inserted;
+
+        // Rebuilt by the next lookup.
+        if (l1 - l0 > COLIDX_SPAN || n > COLIDX_CHUNK*COLIDX_GROW) {
+                release(ix);
+                goto done;
+        }
+
+        ix->tree[ix->leaves + l0] = scan(s, st, n, ix->tabw);
+        pull(ix, l0);
+        for (size_t i = l0 + 1; i <= l1; ++i) {
+                memset(&ix->tree[ix->leaves + i], 0, sizeof(colsum));
+                pull(ix, i);
+        }
+
+        ix->len = s->len;
+
+ done:
+        pthread_mutex_unlock(&g_lock);
+}
+
+void
+colidx_drop(const str *s)
+{
+        colidx *ix;
+
+        pthread_mutex_lock(&g_lock);
+        if ((ix = find(s)))
+                release(ix);
+        pthread_mutex_unlock(&g_lock);
+}
@@ -0,0 +1,482 @@
+/*
+ * ww: a simple editor
+ * Copyright (C) 2026 malloc-nbytes
+ * Contact: zdhdev@yahoo.com
+
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "compile.h"
+#include "buffer.h"
+#include "line.h"
+#include "str.h"
+#include "glconf.h"
+#include "io.h"
+#include "killring.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <regex.h>
+
+typedef struct {
+        regex_t re;
+        size_t  file;  // capture group of the filename
+        size_t  row;   // capture group of the line number
+        size_t  col;   // capture group of the column, 0 if none
+} diag_pattern;
+
+ARRAY_DEFINE(diag_pattern, diag_pattern_ar);
+
+diag_index g_compile_diags = {0};
+
+static diag_pattern_ar g_patterns = {0};
+static int             g_patterns_ready = 0;
+
+static void
+add_pattern(const char *re,
+            size_t      file,
+            size_t      row,
+            size_t      col)
+{
+        diag_pattern p;
+
+        if (regcomp(&p.re, re, REG_EXTENDED) != 0)
+                return;
+
+        p.file = file;
+        p.row  = row;
+        p.col  = col;
+
+        array_append(g_patterns, p);
+}
+
+static void
+init_patterns(void)
+{
+        if (g_patterns_ready)
+                return;
+
+        g_patterns_ready = 1;
+
+        // User patterns from `error-patterns' go first so they can
+        // shadow the builtins. Groups are (1) file (2) line (3) column.
+        if (glconf.runtime.error_patterns)
+                for (size_t i = 0; glconf.runtime.error_patterns[i]; ++i)
+                        add_pattern(glconf.runtime.error_patterns[i], 1, 2, 3);
+
+        // gcc, clang, rustc --error-format=short, go vet, ...
+        add_pattern("([^[:space:]:]+):([0-9]+):([0-9]+):", 1, 2, 3);
+
+        // python tracebacks
+        add_pattern("File \"([^\"]+)\", line ([0-9]+)", 1, 2, 0);
+}
+
+static diag_severity
+guess_severity(const char *rest)
+{
+        if (strstr(rest, "error"))
+                return DIAG_ERROR;
+        if (strstr(rest, "warning"))
+                return DIAG_WARNING;
+        if (strstr(rest, "note"))
+                return DIAG_NOTE;
+        return DIAG_ERROR;
+}
+
+int
+diag_parse_line(const char *s,
+                diag       *out)
+{
+        regmatch_t m[4];
+
+        if (!strpbrk(s, "0123456789"))
+                return 0;
+
+        init_patterns();
+
+        for (size_t i = 0; i < g_patterns.len; ++i) {
+                const diag_pattern *p = &g_patterns.data[i];
+
+                if (regexec(&p->re, s, 4, m, 0) != 0)
+                        continue;
+                if (p->row > p->re.re_nsub || m[p->row].rm_so == -1)
+                        continue;
+
+                size_t flen = (size_t)(m[p->file].rm_eo - m[p->file].rm_so);
+
+                out->file = strndup(s + m[p->file].rm_so, flen);
+                out->row  = atoi(s + m[p->row].rm_so);
+                out->col  = 0;
+                out->sev  = guess_severity(s + m[0].rm_eo);
+                out->ln   = 0;
+                out->real = NULL;
+                out->resolved = 0;
+
+                const char *msg = s + m[0].rm_eo;
+                size_t      mlen;
+
+                while (*msg == ' ' || *msg == '\t')
+                        ++msg;
+                mlen = strlen(msg);
+                while (mlen > 0 && (msg[mlen-1] == '\n' || msg[mlen-1] == '\r'))
+                        --mlen;
+                out->msg = strndup(msg, mlen);
+
+                if (p->col && p->col <= p->re.re_nsub && m[p->col].rm_so != -1)
+                        out->col = atoi(s + m[p->col].rm_so);
+
+                return 1;
+        }
+
+        return 0;
+}
+
+void
+diag_free(diag *d)
+{
+        free(d->file);
+        free(d->msg);
+        free(d->real);
+}
+
+void
+diag_index_clear(diag_index *idx)
+{
+        for (size_t i = idx->first; i < idx->diags.len; ++i)
+                diag_free(&idx->diags.data[i]);
+
+        array_clear(idx->diags);
+
+        idx->first   = 0;
+        idx->cursor  = 0;
+        idx->base    = 0;
+        idx->dropped = 0;
+}
+
+size_t
+diag_index_count(const diag_index *idx)
+{
+        return idx->diags.len - idx->first;
+}
+
+size_t
+diag_index_bufline(const diag_index *idx,
+                   const diag       *d)
+{
+        return d->ln - idx->dropped + idx->base;
+}
+
+// First diagnostic at or after output line `ln'.
+static size_t
+lower_bound(const diag_index *idx,
+            size_t            ln)
+{
+        size_t lo = idx->first;
+        size_t hi = idx->diags.len;
+
+        while (lo < hi) {
+                size_t mid = lo + (hi-lo)/2;
+                if (idx->diags.data[mid].ln < ln)
+                        lo = mid+1;
+                else
+                        hi = mid;
+        }
+
+        return lo;
+}
+
+const diag *
+diag_index_at_bufline(const diag_index *idx,
+                      size_t            bufline)
+{
+        size_t ln;
+        size_t i;
+
+        if (bufline < idx->base)
+                return NULL;
+
+        ln = bufline - idx->base + idx->dropped;
+        i  = lower_bound(idx, ln);
+
+        if (i < idx->diags.len && idx->diags.data[i].ln == ln)
+                return &idx->diags.data[i];
+
+        return NULL;
+}
+
+const diag *
+diag_index_step(diag_index *idx,
+                size_t      bufline,
+                int         prev)
+{
+        size_t n = idx->diags.len;
+        size_t i;
+
+        if (idx->first >= n)
+                return NULL;
+
+        if (idx->cursor >= idx->first && idx->cursor < n
+            && diag_index_bufline(idx, &idx->diags.data[idx->cursor]) == bufline) {
+                // Still sitting on the last visited diagnostic.
+                i = idx->cursor;
+                if (prev)
+                        i = i == idx->first ? n-1 : i-1;
+                else
+                        i = i+1 == n ? idx->first : i+1;
+        } else if (bufline < idx->base) {
+                i = prev ? n-1 : idx->first;
+        } else {
+                size_t ln = bufline - idx->base + idx->dropped;
+
+                if (prev) {
+                        i = lower_bound(idx, ln);
+                        i = i == idx->first ? n-1 : i-1;
+                } else {
+                        i = lower_bound(idx, ln+1);
+                        if (i == n)
+                                i = idx->first;
+                }
+        }
+
+        idx->cursor = i;
+
+        return &idx->diags.data[i];
+}
+
+void
+diag_index_attach(diag_index *idx,
+                  buffer     *b)
+{
+        const diag *prev = NULL;
+
+        buffer_clear_markers(b);
+
+        if (b->builtin)
+                return;
+
+        for (size_t i = idx->first; i < idx->diags.len; ++i) {
+                diag *d = &idx->diags.data[i];
+
+                if (!d->resolved) {
+                        // Diagnostics come in runs for the same file.
+                        if (prev && !strcmp(prev->file, d->file))
+                                d->real = prev->real ? strdup(prev->real) : NULL;
+                        else
+                                d->real = get_realpath(d->file);
+                        d->resolved = 1;
+                }
+
+                prev = d;
+
+                if (!d->real || d->row <= 0 || strcmp(d->real, str_cstr(&b->path)))
+                        continue;
+
+                buffer_add_marker(b, (size_t)d->row-1,
+                                  d->col > 0 ? (unsigned)d->col-1 : 0,
+                                  (int)d->sev, d->msg);
+        }
+}
+
+// Forget diagnostics whose output lines were dropped by the sink.
+static void
+diag_index_drop(diag_index *idx,
+                size_t      dropped)
+{
+        idx->dropped = dropped;
+
+        while (idx->first < idx->diags.len
+               && idx->diags.data[idx->first].ln < dropped)
+                diag_free(&idx->diags.data[idx->first++]);
+
+        if (idx->first > 1024 && idx->first > idx->diags.len/2) {
+                size_t live = idx->diags.len - idx->first;
+
+                memmove(idx->diags.data,
+                        idx->diags.data + idx->first,
+                        live*sizeof(*idx->diags.data));
+
+                idx->cursor  = idx->cursor > idx->first ? idx->cursor - idx->first : 0;
+                idx->diags.len = live;
+                idx->first   = 0;
+        }
+}
+
+static long long
+now_ms(void)
+{
+        struct timespec ts;
+
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+
+        return (long long)ts.tv_sec*1000 + ts.tv_nsec/1000000;
+}
+
+void
+compile_sink_init(compile_sink *sink,
+                  buffer       *b,
+                  size_t        keep,
+                  size_t        max_lines,
+                  diag_index   *diags)
+{
+        sink->b         = b;
+        sink->partial   = str_create();
+        sink->pending   = array_empty(linep_ar);
+        sink->keep      = keep;
+        sink->max_lines = max_lines;
+        sink->dropped   = 0;
+        sink->marker    = 0;
+        sink->last_draw = 0;
+        sink->stale     = 0;
+        sink->nout      = 0;
+        sink->diags     = diags;
+
+        if (diags)
+                diags->base = keep;
+}
+
+static void
+drop_oldest(compile_sink *sink)
+{
+        buffer *b    = sink->b;
+        size_t  keep = sink->keep + (sink->marker ? 1 : 0);
+        size_t  n;
+
+        if (!sink->max_lines || b->lines.len <= keep + sink->max_lines)
+                return;
+
+        n = b->lines.len - keep - sink->max_lines;
+
+        killring_release(b);
+        lines_splice(&b->lines, keep, n, NULL, 0);
+        sink->dropped += n;
+
+        str msg = str_from_fmt("[ %zu earlier lines dropped (compile-max-lines) ]\n",
+                               sink->dropped);
+
+        if (!sink->marker) {
+                array_insert_at(b->lines, sink->keep, line_from(b->pool, msg));
+                sink->marker = 1;
+        } else {
+                str_overwrite(&b->lines.data[sink->keep]->txt, str_cstr(&msg));
+                str_destroy(&msg);
+        }
+
+        if (sink->diags) {
+                sink->diags->base = sink->keep + 1;
+                diag_index_drop(sink->diags, sink->dropped);
+        }
+}
+
+static void
+flush_pending(compile_sink *sink)
+{
+        buffer *b = sink->b;
+
+        if (sink->pending.len == 0)
+                return;
+
+        array_reserve(b->lines, b->lines.len + sink->pending.len);
+        memcpy(b->lines.data + b->lines.len,
+               sink->pending.data,
+               sink->pending.len*sizeof(*sink->pending.data));
+
+        b->lines.len += sink->pending.len;
+        array_clear(sink->pending);
+
+        drop_oldest(sink);
+
+        b->v->cx = 0;
+        b->v->al = b->lines.len-1;
+        b->v->cy = (unsigned)b->v->al;
+
+        buffer_adjust_scroll(b);
+}
+
+static void
+push_partial(compile_sink *sink)
+{
+        diag d;
+
+        if (sink->diags && diag_parse_line(str_cstr(&sink->partial), &d)) {
+                d.ln = sink->nout;
+                array_append(sink->diags->diags, d);
+        }
+
+        ++sink->nout;
+        array_append(sink->pending, line_from(sink->b->pool, sink->partial));
+        sink->partial = str_create();
+}
+
+void
+compile_sink_feed(const char *chunk,
+                  size_t      len,
+                  void       *userdata)
+{
+        compile_sink *sink = (compile_sink *)userdata;
+        const char   *end  = chunk + len;
+        const char   *it   = chunk;
+        long long     now;
+
+        while (it < end) {
+                const char *nl   = memchr(it, '\n', (size_t)(end-it));
+                const char *stop = nl ? nl+1 : end;
+
+                // NUL bytes are dropped, the text between them is
+                // appended in one go.
+                while (it < stop) {
+                        const char *nul = memchr(it, 0, (size_t)(stop-it));
+                        const char *seg = nul ? nul : stop;
+
+                        str_append_n(&sink->partial, it, (size_t)(seg-it));
+                        it = nul ? nul+1 : stop;
+                }
+
+                if (nl)
+                        push_partial(sink);
+        }
+
+        if (len)
+                sink->stale = 1;
+
+        // Bound memory even when output arrives faster than we draw.
+        if (sink->max_lines && sink->pending.len >= sink->max_lines)
+                flush_pending(sink);
+
+        now = now_ms();
+
+        if (!sink->stale || now - sink->last_draw < COMPILE_SINK_FRAME_MS)
+                return;
+
+        flush_pending(sink);
+        buffer_draw(sink->b);
+        fflush(stdout);
+
+        sink->last_draw = now;
+        sink->stale     = 0;
+}
+
+void
+compile_sink_finish(compile_sink *sink)
+{
+        if (sink->partial.len > 0) {
+                str_append(&sink->partial, '\n');
+                push_partial(sink);
+        }
+
+        flush_pending(sink);
+
+        str_destroy(&sink->partial);
+        array_free(sink->pending);
+}
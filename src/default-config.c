@@ -43,11 +43,26 @@ const char *g_default_config_str = "# Basic configuration file for ww,\n"
 "# The default compilation command\n"
 "compile-command = 'make';\n"
 "\n"
-"# The way of copying the internal copy buffer\n"
-"# to the system clipboard. The `%%s' is the data\n"
-"# from the copy buffer.\n"
-"if !wayland: to-clipboard = \"echo -E '%%s' | xclip -selection clipboard\";\n"
-"else         to-clipboard = \"echo -E '%%s' | wl-copy\";\n"
+"# The maximum number of output lines kept in `ww-compile'.\n"
+"# The oldest output is dropped past this, use '0' for no limit.\n"
+"compile-max-lines = '100000';\n"
+"\n"
+"# Megabytes of file text kept in memory. Past this, unmodified buffers\n"
+"# that are not on screen are dropped and read back when shown again.\n"
+"# Use '0' for no limit.\n"
+"buffer-memory = '256';\n"
+"\n"
+"# Extra POSIX extended regexes for finding errors in `ww-compile'\n"
+"# (used by M-g n and M-g p). Capture groups are (1) the file,\n"
+"# (2) the line and optionally (3) the column.\n"
+"# error-patterns = ['^([^ (]+)[(]([0-9]+),([0-9]+)[)]'];\n"
+"\n"
+"# The shell command copies and cuts are sent to the system\n"
+"# clipboard with, it reads the text on its stdin. Use 'osc52'\n"
+"# to have the terminal set the clipboard instead, which also\n"
+"# works over ssh, or an empty string to not export at all.\n"
+"if !wayland: to-clipboard = \"xclip -selection clipboard\";\n"
+"else         to-clipboard = \"wl-copy\";\n"
 "\n"
 "# Show the tilde character `~' on EOF lines.\n"
 "empty-line-squiggles = true;\n"
@@ -0,0 +1,528 @@
+/*
+ * ww: a simple editor
+ * Copyright (C) 2026 malloc-nbytes
+ * Contact: zdhdev@yahoo.com
+
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "fileindex.h"
+#include "io.h"
+#include "set.h"
+#include "config.h"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#if HAVE_PATH_MAX
+#include <limits.h>
+#else
+#define PATH_MAX 4096
+#endif
+
+#define FILEINDEX_ARENA_CHUNK (256*1024)
+
+#define FILEINDEX_WATCH_MASK \
+        (IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_ONLYDIR)
+
+// Path strings are never freed individually. Once stale ones outweigh
+// the live ones, the live ones are copied to a fresh arena and the old
+// one is retired until the main thread takes its next snapshot, so the
+// pointers it was handed stay valid until then.
+typedef struct arena_chunk {
+        struct arena_chunk *next;
+        size_t              len;
+        size_t              cap;
+        char                data[];
+} arena_chunk;
+
+typedef struct {
+        char    *path;  // relative to the root, "" for the root itself
+        cstr_ar  files; // relative to the root
+        int      alive;
+} fdir;
+
+ARRAY_DEFINE(fdir, fdir_ar);
+
+SET_IMPL(char *, cstr_set);
+
+static struct {
+        char            *root;
+        arena_chunk     *arena;
+        arena_chunk     *retired; // replaced arenas, freed on the next snapshot
+        size_t           live;    // arena bytes still referenced
+        size_t           stale;   // arena bytes no longer referenced
+        cstr_set         files;   // every file in `dirs'
+        fdir_ar          dirs;
+        int_ar           wd_dir; // inotify watch -> index into `dirs', -1 if none
+        int              ifd;
+        unsigned long    gen;    // bumped on every change
+        pthread_mutex_t  lock;
+        pthread_t        thread;
+        int              started;
+
+        // owned by the main thread
+        cstr_ar          snap;
+        unsigned long    snap_gen;
+} g_idx = {
+        .lock     = PTHREAD_MUTEX_INITIALIZER,
+        .ifd      = -1,
+        .snap_gen = (unsigned long)-1,
+};
+
+static char *
+arena_strdup(const char *s)
+{
+        size_t       n = strlen(s) + 1;
+        arena_chunk *c = g_idx.arena;
+
+        if (!c || c->len + n > c->cap) {
+                size_t cap = n > FILEINDEX_ARENA_CHUNK ? n : FILEINDEX_ARENA_CHUNK;
+                c          = (arena_chunk *)malloc(sizeof(arena_chunk) + cap);
+                c->next    = g_idx.arena;
+                c->len     = 0;
+                c->cap     = cap;
+                g_idx.arena = c;
+        }
+
+        char *p = c->data + c->len;
+        memcpy(p, s, n);
+        c->len     += n;
+        g_idx.live += n;
+
+        return p;
+}
+
+static void
+arena_drop(const char *s)
+{
+        size_t n = strlen(s) + 1;
+
+        g_idx.live  -= n;
+        g_idx.stale += n;
+}
+
+// Hand the current arena over to `retired', everything in it must
+// have been copied or dropped.
+static void
+arena_retire(void)
+{
+        arena_chunk *c = g_idx.arena;
+
+        if (!c)
+                return;
+
+        while (c->next)
+                c = c->next;
+
+        c->next       = g_idx.retired;
+        g_idx.retired = g_idx.arena;
+        g_idx.arena   = NULL;
+        g_idx.live    = 0;
+        g_idx.stale   = 0;
+}
+
+static unsigned
+path_hash(char **s)
+{
+        return hash_cstr(*s);
+}
+
+static int
+path_cmp(char **a,
+         char **b)
+{
+        return strcmp(*a, *b);
+}
+
+static void
+full_path(char       *buf,
+          const char *rel)
+{
+        if (rel[0])
+                snprintf(buf, PATH_MAX, "%s/%s", g_idx.root, rel);
+        else
+                snprintf(buf, PATH_MAX, "%s", g_idx.root);
+}
+
+// Called with the lock held.
+static size_t
+add_dir(const char *rel)
+{
+        char buf[PATH_MAX];
+        int  wd = -1;
+
+        full_path(buf, rel);
+
+        // Running out of watches only means this directory goes stale.
+        if (g_idx.ifd != -1)
+                wd = inotify_add_watch(g_idx.ifd, buf, FILEINDEX_WATCH_MASK);
+
+        // A directory created while its parent is being crawled is seen
+        // by both the crawl and the watch, and the watch is shared.
+        if (wd >= 0 && (size_t)wd < g_idx.wd_dir.len && g_idx.wd_dir.data[wd] >= 0) {
+                const fdir *d = &g_idx.dirs.data[g_idx.wd_dir.data[wd]];
+                if (d->alive && !strcmp(d->path, rel))
+                        return (size_t)g_idx.wd_dir.data[wd];
+        }
+
+        fdir d = (fdir) {
+                .path  = arena_strdup(rel),
+                .files = array_empty(cstr_ar),
+                .alive = 1,
+        };
+
+        array_append(g_idx.dirs, d);
+
+        if (wd >= 0) {
+                while (g_idx.wd_dir.len <= (size_t)wd)
+                        array_append(g_idx.wd_dir, -1);
+                g_idx.wd_dir.data[wd] = (int)g_idx.dirs.len-1;
+        }
+
+        return g_idx.dirs.len-1;
+}
+
+static void
+add_file(size_t      di,
+         const char *rel)
+{
+        char *p;
+
+        if (cstr_set_contains(&g_idx.files, (char *)(uintptr_t)rel))
+                return;
+
+        p = arena_strdup(rel);
+        cstr_set_insert(&g_idx.files, p);
+        array_append(g_idx.dirs.data[di].files, p);
+}
+
+static void
+remove_file(size_t      di,
+            const char *rel)
+{
+        fdir *d = &g_idx.dirs.data[di];
+
+        if (!cstr_set_contains(&g_idx.files, (char *)(uintptr_t)rel))
+                return;
+
+        for (size_t i = 0; i < d->files.len; ++i) {
+                if (!strcmp(d->files.data[i], rel)) {
+                        cstr_set_remove(&g_idx.files, d->files.data[i]);
+                        arena_drop(d->files.data[i]);
+                        d->files.data[i] = d->files.data[--d->files.len];
+                        return;
+                }
+        }
+}
+
+// Forget `rel' and everything below it.
+static void
+remove_tree(const char *rel)
+{
+        size_t n = strlen(rel);
+
+        for (size_t i = 0; i < g_idx.dirs.len; ++i) {
+                fdir *d = &g_idx.dirs.data[i];
+
+                if (!d->alive || strncmp(d->path, rel, n) || (d->path[n] && d->path[n] != '/'))
+                        continue;
+
+                for (size_t j = 0; j < d->files.len; ++j) {
+                        cstr_set_remove(&g_idx.files, d->files.data[j]);
+                        arena_drop(d->files.data[j]);
+                }
+
+                d->alive = 0;
+                arena_drop(d->path);
+                array_free(d->files);
+                d->files = array_empty(cstr_ar);
+        }
+
+        for (size_t wd = 0; wd < g_idx.wd_dir.len; ++wd) {
+                int di = g_idx.wd_dir.data[wd];
+                if (di >= 0 && !g_idx.dirs.data[di].alive) {
+                        inotify_rm_watch(g_idx.ifd, (int)wd);
+                        g_idx.wd_dir.data[wd] = -1;
+                }
+        }
+}
+
+// Copy what is still referenced to a fresh arena and forget dead
+// directories. Called with the lock held, never during a crawl since
+// that keeps indices into `dirs'.
+static void
+compact(void)
+{
+        fdir_ar dirs  = array_empty(fdir_ar);
+        int_ar  remap = array_empty(int_ar);
+
+        arena_retire();
+        cstr_set_destroy(&g_idx.files);
+        g_idx.files = cstr_set_create(path_hash, path_cmp, NULL);
+
+        for (size_t i = 0; i < g_idx.dirs.len; ++i) {
+                fdir *d = &g_idx.dirs.data[i];
+
+                if (!d->alive) {
+                        array_append(remap, -1);
+                        continue;
+                }
+
+                d->path = arena_strdup(d->path);
+                for (size_t j = 0; j < d->files.len; ++j) {
+                        d->files.data[j] = arena_strdup(d->files.data[j]);
+                        cstr_set_insert(&g_idx.files, d->files.data[j]);
+                }
+
+                array_append(remap, (int)dirs.len);
+                array_append(dirs, *d);
+        }
+
+        for (size_t wd = 0; wd < g_idx.wd_dir.len; ++wd)
+                if (g_idx.wd_dir.data[wd] >= 0)
+                        g_idx.wd_dir.data[wd] = remap.data[g_idx.wd_dir.data[wd]];
+
+        array_free(g_idx.dirs);
+        array_free(remap);
+        g_idx.dirs = dirs;
+        ++g_idx.gen;
+}
+
+// Forget everything, for when the kernel dropped events and the tree
+// has to be crawled again. Called with the lock held.
+static void
+reset(void)
+{
+        for (size_t wd = 0; wd < g_idx.wd_dir.len; ++wd)
+                if (g_idx.wd_dir.data[wd] >= 0)
+                        inotify_rm_watch(g_idx.ifd, (int)wd);
+
+        for (size_t i = 0; i < g_idx.dirs.len; ++i)
+                array_free(g_idx.dirs.data[i].files);
+
+        g_idx.dirs.len   = 0;
+        g_idx.wd_dir.len = 0;
+        cstr_set_destroy(&g_idx.files);
+        g_idx.files = cstr_set_create(path_hash, path_cmp, NULL);
+        arena_retire();
+        ++g_idx.gen;
+}
+
+typedef struct {
+        const char *prefix; // relative path of the directory being crawled
+        size_t_ar   stack;  // open directories, innermost last
+} crawl_ctx;
+
+static int
+crawl_visit(const char *relpath,
+            int         is_dir,
+            void       *ctx)
+{
+        crawl_ctx *c = (crawl_ctx *)ctx;
+        char       rel[PATH_MAX];
+
+        if (c->prefix[0])
+                snprintf(rel, sizeof(rel), "%s/%s", c->prefix, relpath);
+        else
+                snprintf(rel, sizeof(rel), "%s", relpath);
+
+        pthread_mutex_lock(&g_idx.lock);
+
+        // The walk is depth first, so the parent is on the stack.
+        while (c->stack.len > 1) {
+                const char *top = g_idx.dirs.data[c->stack.data[c->stack.len-1]].path;
+                size_t      n   = strlen(top);
+                if (!strncmp(rel, top, n) && rel[n] == '/')
+                        break;
+                --c->stack.len;
+        }
+
+        if (is_dir)
+                array_append(c->stack, add_dir(rel));
+        else
+                add_file(c->stack.data[c->stack.len-1], rel);
+
+        ++g_idx.gen;
+        pthread_mutex_unlock(&g_idx.lock);
+
+        return 1;
+}
+
+static void
+crawl(const char *rel)
+{
+        char      buf[PATH_MAX];
+        crawl_ctx c;
+
+        c.prefix = rel;
+        c.stack  = array_empty(size_t_ar);
+
+        pthread_mutex_lock(&g_idx.lock);
+        array_append(c.stack, add_dir(rel));
+        pthread_mutex_unlock(&g_idx.lock);
+
+        full_path(buf, rel);
+        walkdir_each(buf, crawl_visit, &c);
+
+        array_free(c.stack);
+}
+
+static void
+handle_event(const struct inotify_event *ev)
+{
+        char rel[PATH_MAX];
+        int  di;
+
+        pthread_mutex_lock(&g_idx.lock);
+
+        if (ev->wd < 0 || (size_t)ev->wd >= g_idx.wd_dir.len
+            || (di = g_idx.wd_dir.data[ev->wd]) < 0)
+                goto done;
+
+        if (ev->mask & IN_IGNORED) {
+                g_idx.wd_dir.data[ev->wd] = -1;
+                goto done;
+        }
+
+        if (ev->len == 0 || !g_idx.dirs.data[di].alive)
+                goto done;
+
+        if (g_idx.dirs.data[di].path[0])
+                snprintf(rel, sizeof(rel), "%s/%s", g_idx.dirs.data[di].path, ev->name);
+        else
+                snprintf(rel, sizeof(rel), "%s", ev->name);
+
+        if (ev->mask & IN_ISDIR) {
+                if (ev->mask & (IN_DELETE | IN_MOVED_FROM))
+                        remove_tree(rel);
+                if (ev->mask & (IN_CREATE | IN_MOVED_TO)) {
+                        pthread_mutex_unlock(&g_idx.lock);
+                        crawl(rel);
+                        return;
+                }
+        } else {
+                if (ev->mask & (IN_DELETE | IN_MOVED_FROM))
+                        remove_file((size_t)di, rel);
+                if (ev->mask & (IN_CREATE | IN_MOVED_TO))
+                        add_file((size_t)di, rel);
+        }
+
+        ++g_idx.gen;
+
+        if (g_idx.stale > g_idx.live && g_idx.stale >= FILEINDEX_ARENA_CHUNK)
+                compact();
+
+ done:
+        pthread_mutex_unlock(&g_idx.lock);
+}
+
+static void *
+worker(void *arg)
+{
+        (void)arg;
+
+        char buf[64*1024] __attribute__((aligned(__alignof__(struct inotify_event))));
+
+        crawl("");
+
+        if (g_idx.ifd == -1)
+                return NULL;
+
+        while (1) {
+                ssize_t n = read(g_idx.ifd, buf, sizeof(buf));
+
+                if (n <= 0)
+                        break;
+
+                for (char *p = buf; p < buf + n; ) {
+                        const struct inotify_event *ev = (const struct inotify_event *)p;
+
+                        // Events were lost, nothing short of a new crawl
+                        // tells what changed.
+                        if (ev->mask & IN_Q_OVERFLOW) {
+                                pthread_mutex_lock(&g_idx.lock);
+                                reset();
+                                pthread_mutex_unlock(&g_idx.lock);
+                                crawl("");
+                                break;
+                        }
+
+                        handle_event(ev);
+                        p += sizeof(struct inotify_event) + ev->len;
+                }
+        }
+
+        return NULL;
+}
+
+void
+fileindex_start(const char *root)
+{
+        if (g_idx.started)
+                return;
+
+        g_idx.started = 1;
+        g_idx.root    = strdup(root);
+        g_idx.files   = cstr_set_create(path_hash, path_cmp, NULL);
+        g_idx.dirs    = array_empty(fdir_ar);
+        g_idx.wd_dir  = array_empty(int_ar);
+        g_idx.snap    = array_empty(cstr_ar);
+        g_idx.ifd     = inotify_init1(IN_CLOEXEC);
+
+        if (pthread_create(&g_idx.thread, NULL, worker, NULL) != 0)
+                crawl("");
+        else
+                pthread_detach(g_idx.thread);
+}
+
+int
+fileindex_started(void)
+{
+        return g_idx.started;
+}
+
+cstr_ar
+fileindex_files(void)
+{
+        pthread_mutex_lock(&g_idx.lock);
+
+        if (g_idx.gen != g_idx.snap_gen) {
+                g_idx.snap.len = 0;
+                for (size_t i = 0; i < g_idx.dirs.len; ++i) {
+                        const fdir *d = &g_idx.dirs.data[i];
+                        if (!d->files.len)
+                                continue;
+                        array_reserve(g_idx.snap, g_idx.snap.len + d->files.len);
+                        memcpy(g_idx.snap.data + g_idx.snap.len, d->files.data,
+                               d->files.len * sizeof(char *));
+                        g_idx.snap.len += d->files.len;
+                }
+                g_idx.snap_gen = g_idx.gen;
+        }
+
+        // The previous snapshot was the last user of retired arenas.
+        while (g_idx.retired) {
+                arena_chunk *next = g_idx.retired->next;
+                free(g_idx.retired);
+                g_idx.retired = next;
+        }
+
+        pthread_mutex_unlock(&g_idx.lock);
+
+        return g_idx.snap;
+}
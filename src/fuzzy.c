@@ -22,12 +22,32 @@
 #include <string.h>
 #include <stdlib.h>
 #include <ctype.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <unistd.h>
+
+// Below this many candidates threads cost more than they save.
+#define FUZZY_PARALLEL_MIN   32768
+#define FUZZY_CHUNK_MIN      4096
+#define FUZZY_MAX_THREADS    8
+// Candidates between checks for a cancelled job.
+#define FUZZY_CANCEL_STRIDE  1024
 
 typedef struct {
-        char *word;
-        int score;
+        size_t idx;
+        int    score;
 } match_t;
 
+static uint64_t
+char_bit(unsigned char c)
+{
+        if (c >= 'a' && c <= 'z')
+                return 1ULL << (c - 'a');
+        if (c >= '0' && c <= '9')
+                return 1ULL << (26 + c - '0');
+        return 1ULL << (36 + c % 28);
+}
+
 static int
 is_word_boundary(const char *s, size_t i)
 {
@@ -37,13 +57,13 @@ is_word_boundary(const char *s, size_t i)
         return prev == '_' || prev == '-' || prev == ' ' || prev == '/';
 }
 
+// Both `word' and `query' are lowercase.
 static int
 fuzzy_score(const char *word,
-            const char *query)
+            size_t      wlen,
+            const char *query,
+            size_t      qlen)
 {
-        size_t wlen = strlen(word);
-        size_t qlen = strlen(query);
-
         if (qlen == 0)
                 return 0;
 
@@ -52,11 +72,11 @@ fuzzy_score(const char *word,
         int consecutive = 0;
 
         for (size_t qi = 0; qi < qlen; ++qi) {
-                char qc = (char)tolower(query[qi]);
+                char qc = query[qi];
                 int found = 0;
 
                 while (wi < wlen) {
-                        char wc = (char)tolower(word[wi]);
+                        char wc = word[wi];
 
                         if (wc == qc) {
                                 found = 1;
@@ -86,42 +106,520 @@ fuzzy_score(const char *word,
         return score;
 }
 
+// `a' ranks below `b'. Ties go to the earlier candidate.
 static int
-cmp_match(const void *a,
-          const void *b)
+match_worse(const match_t *a,
+            const match_t *b)
+{
+        return a->score < b->score || (a->score == b->score && a->idx > b->idx);
+}
+
+// Min-heap on rank, the root is the worst match kept so far.
+static void
+heap_sift_down(match_t *h,
+               size_t   n,
+               size_t   i)
+{
+        while (1) {
+                size_t l = 2*i + 1, r = l + 1, m = i;
+
+                if (l < n && match_worse(&h[l], &h[m]))
+                        m = l;
+                if (r < n && match_worse(&h[r], &h[m]))
+                        m = r;
+                if (m == i)
+                        return;
+
+                match_t tmp = h[i];
+                h[i] = h[m];
+                h[m] = tmp;
+                i = m;
+        }
+}
+
+static void
+heap_push(match_t *h,
+          size_t  *n,
+          size_t   k,
+          match_t  m)
+{
+        if (*n < k) {
+                size_t i = (*n)++;
+                h[i] = m;
+                while (i > 0 && match_worse(&h[i], &h[(i-1)/2])) {
+                        match_t tmp = h[i];
+                        h[i] = h[(i-1)/2];
+                        h[(i-1)/2] = tmp;
+                        i = (i-1)/2;
+                }
+        } else if (k > 0 && match_worse(&h[0], &m)) {
+                h[0] = m;
+                heap_sift_down(h, *n, 0);
+        }
+}
+
+// A slice of the candidates a job starts from. Chunks are handed out
+// to workers one at a time and merged in order once all are done.
+typedef struct {
+        size_t      lo, hi;
+        size_t_ar  *levels; // survivors for each new query character
+        match_t    *heap;   // local top-k
+        size_t      n;
+        atomic_int  done;   // released once the fields above are final
+} fuzzy_chunk;
+
+struct fuzzy_job {
+        fuzzy_ctx     *f;
+        char          *q;      // lowercased query
+        size_t         qlen;
+        size_t         keep;   // levels already known for q[0..keep)
+        uint64_t      *qmask;  // qmask[i]: characters in q[0..i]
+        const size_t  *start;  // candidates matching q[0..keep), NULL for all
+        fuzzy_chunk   *chunks;
+        size_t         nchunks;
+        atomic_size_t  next;   // next chunk to hand out
+        atomic_int     cancel;
+        size_t         ndone;  // under g_pool.lock
+};
+
+static struct {
+        pthread_mutex_t   lock;
+        pthread_cond_t    wake;   // a job was posted
+        pthread_cond_t    idle;   // a worker left a job or finished a chunk
+        size_t            n;      // 0 until started, (size_t)-1 if unavailable
+        struct fuzzy_job *job;
+        unsigned long     gen;
+        size_t            active; // workers inside `job'
+} g_pool = {
+        .lock = PTHREAD_MUTEX_INITIALIZER,
+        .wake = PTHREAD_COND_INITIALIZER,
+        .idle = PTHREAD_COND_INITIALIZER,
+};
+
+static void
+run_chunk(struct fuzzy_job *job,
+          fuzzy_chunk      *c)
+{
+        const fuzzy_ctx *f = job->f;
+
+        for (size_t j = c->lo; j < c->hi; ++j) {
+                if ((j - c->lo) % FUZZY_CANCEL_STRIDE == 0 && atomic_load(&job->cancel))
+                        return;
+
+                size_t      i   = job->start ? job->start[j] : j;
+                const char *w   = f->lower + f->off[i];
+                const char *pos = w;
+                size_t      l;
+
+                // Candidates already match q[0..keep), find where that
+                // match ends, then extend it one character at a time.
+                for (l = 0; l < job->keep; ++l)
+                        pos = strchr(pos, job->q[l]) + 1;
+
+                for (l = job->keep; l < job->qlen; ++l) {
+                        if ((f->masks[i] & job->qmask[l]) != job->qmask[l])
+                                break;
+                        if (!(pos = strchr(pos, job->q[l])))
+                                break;
+                        ++pos;
+                        array_append(c->levels[l - job->keep], i);
+                }
+
+                if (l < job->qlen)
+                        continue;
+
+                int s = fuzzy_score(w, f->off[i+1] - f->off[i] - 1, job->q, job->qlen);
+                heap_push(c->heap, &c->n, f->k, (match_t){ .idx = i, .score = s });
+        }
+
+        atomic_store_explicit(&c->done, 1, memory_order_release);
+}
+
+static void
+run_chunks(struct fuzzy_job *job)
+{
+        size_t ci;
+
+        while ((ci = atomic_fetch_add(&job->next, 1)) < job->nchunks) {
+                run_chunk(job, &job->chunks[ci]);
+
+                pthread_mutex_lock(&g_pool.lock);
+                if (atomic_load_explicit(&job->chunks[ci].done, memory_order_relaxed))
+                        ++job->ndone;
+                pthread_cond_broadcast(&g_pool.idle);
+                pthread_mutex_unlock(&g_pool.lock);
+        }
+}
+
+static void *
+worker(void *arg)
+{
+        (void)arg;
+
+        unsigned long seen = 0;
+
+        while (1) {
+                struct fuzzy_job *job;
+
+                pthread_mutex_lock(&g_pool.lock);
+                while (g_pool.gen == seen)
+                        pthread_cond_wait(&g_pool.wake, &g_pool.lock);
+                seen = g_pool.gen;
+                if (!(job = g_pool.job)) {
+                        pthread_mutex_unlock(&g_pool.lock);
+                        continue;
+                }
+                ++g_pool.active;
+                pthread_mutex_unlock(&g_pool.lock);
+
+                run_chunks(job);
+
+                pthread_mutex_lock(&g_pool.lock);
+                --g_pool.active;
+                pthread_cond_broadcast(&g_pool.idle);
+                pthread_mutex_unlock(&g_pool.lock);
+        }
+
+        return NULL;
+}
+
+static size_t
+pool_size(void)
+{
+        if (g_pool.n == 0) {
+                long   ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+                size_t n    = ncpu > 1 ? (size_t)ncpu : 1;
+
+                if (n > FUZZY_MAX_THREADS)
+                        n = FUZZY_MAX_THREADS;
+
+                g_pool.n = (size_t)-1;
+
+                for (size_t i = 0; i < n; ++i) {
+                        pthread_t th;
+                        if (pthread_create(&th, NULL, worker, NULL) != 0)
+                                break;
+                        pthread_detach(th);
+                        g_pool.n = i + 1;
+                }
+        }
+
+        return g_pool.n == (size_t)-1 ? 0 : g_pool.n;
+}
+
+static struct fuzzy_job *
+job_create(fuzzy_ctx  *f,
+           const char *q,
+           size_t      keep,
+           size_t      nchunks)
+{
+        struct fuzzy_job *job = (struct fuzzy_job *)malloc(sizeof(struct fuzzy_job));
+        size_t            nstart;
+
+        job->f     = f;
+        job->q     = strdup(q);
+        job->qlen  = strlen(q);
+        job->keep  = keep;
+        job->qmask = (uint64_t *)malloc(sizeof(uint64_t) * (job->qlen + 1));
+        job->start = keep > 0 ? f->levels[keep-1].data : NULL;
+        job->ndone = 0;
+        atomic_init(&job->next, 0);
+        atomic_init(&job->cancel, 0);
+
+        for (size_t i = 0, m = 0; i < job->qlen; ++i) {
+                m |= char_bit((unsigned char)q[i]);
+                job->qmask[i] = m;
+        }
+
+        nstart = keep > 0 ? f->levels[keep-1].len : f->words.len;
+        if (nchunks > nstart)
+                nchunks = nstart ? nstart : 1;
+
+        job->nchunks = nchunks;
+        job->chunks  = (fuzzy_chunk *)calloc(nchunks, sizeof(fuzzy_chunk));
+
+        for (size_t ci = 0; ci < nchunks; ++ci) {
+                fuzzy_chunk *c = &job->chunks[ci];
+
+                c->lo     = nstart * ci / nchunks;
+                c->hi     = nstart * (ci + 1) / nchunks;
+                c->levels = (size_t_ar *)calloc(job->qlen - keep + 1, sizeof(size_t_ar));
+                c->heap   = (match_t *)malloc(sizeof(match_t) * (f->k ? f->k : 1));
+                atomic_init(&c->done, 0);
+        }
+
+        return job;
+}
+
+static void
+job_free(struct fuzzy_job *job)
+{
+        for (size_t ci = 0; ci < job->nchunks; ++ci) {
+                fuzzy_chunk *c = &job->chunks[ci];
+                for (size_t l = 0; l < job->qlen - job->keep; ++l)
+                        array_free(c->levels[l]);
+                free(c->levels);
+                free(c->heap);
+        }
+        free(job->chunks);
+        free(job->qmask);
+        free(job->q);
+        free(job);
+}
+
+// Take the job off the pool and wait for the workers to let go of it.
+static void
+job_retire(fuzzy_ctx *f)
+{
+        struct fuzzy_job *job = f->job;
+
+        if (!job)
+                return;
+
+        atomic_store(&job->cancel, 1);
+
+        pthread_mutex_lock(&g_pool.lock);
+        if (g_pool.job == job)
+                g_pool.job = NULL;
+        while (g_pool.active > 0)
+                pthread_cond_wait(&g_pool.idle, &g_pool.lock);
+        pthread_mutex_unlock(&g_pool.lock);
+
+        job_free(job);
+        f->job = NULL;
+}
+
+// Rank the local top-k of the finished chunks into `top'. Workers may
+// still be running, a chunk is only read once its `done' is seen.
+static void
+merge_top(fuzzy_ctx        *f,
+          struct fuzzy_job *job)
+{
+        match_t *heap = (match_t *)malloc(sizeof(match_t) * (f->k ? f->k : 1));
+        size_t   n    = 0;
+
+        f->total = 0;
+
+        for (size_t ci = 0; ci < job->nchunks; ++ci) {
+                const fuzzy_chunk *c = &job->chunks[ci];
+
+                if (!atomic_load_explicit(&c->done, memory_order_acquire))
+                        continue;
+
+                for (size_t i = 0; i < c->n; ++i)
+                        heap_push(heap, &n, f->k, c->heap[i]);
+
+                f->total += job->qlen > job->keep
+                        ? c->levels[job->qlen - job->keep - 1].len
+                        : c->hi - c->lo;
+        }
+
+        // Popping the min-heap yields worst first.
+        array_clear(f->top);
+        array_reserve(f->top, n);
+        f->top.len = n;
+        while (n > 0) {
+                f->top.data[n-1] = f->words.data[heap[0].idx];
+                heap[0] = heap[--n];
+                heap_sift_down(heap, n, 0);
+        }
+
+        free(heap);
+}
+
+// All chunks are done: keep their survivors as the new levels.
+static void
+job_finish(fuzzy_ctx *f)
 {
-        const match_t *ma = a;
-        const match_t *mb = b;
-        return mb->score - ma->score; // descending
+        struct fuzzy_job *job = f->job;
+
+        merge_top(f, job);
+
+        for (size_t l = job->keep; l < job->qlen; ++l) {
+                size_t_ar lvl   = array_empty(size_t_ar);
+                size_t    total = 0;
+
+                for (size_t ci = 0; ci < job->nchunks; ++ci)
+                        total += job->chunks[ci].levels[l - job->keep].len;
+
+                array_reserve(lvl, total);
+                for (size_t ci = 0; ci < job->nchunks; ++ci) {
+                        const size_t_ar *cl = &job->chunks[ci].levels[l - job->keep];
+                        memcpy(lvl.data + lvl.len, cl->data, cl->len * sizeof(size_t));
+                        lvl.len += cl->len;
+                }
+
+                f->levels = (size_t_ar *)realloc(f->levels, sizeof(size_t_ar) * (l + 1));
+                f->levels[l] = lvl;
+        }
+
+        f->nlevels = job->qlen;
+        str_clear(&f->lq);
+        str_concat(&f->lq, job->q);
+        f->valid = 1;
+
+        job_retire(f);
 }
 
-cstr_ar
-fuzzy_find(cstr_ar     words,
-           const char *query)
+void
+fuzzy_init(fuzzy_ctx *f,
+           cstr_ar    words,
+           size_t     k)
 {
-        cstr_ar result = array_empty(cstr_ar);
+        size_t total = 0;
 
-        if (words.len == 0)
-                return result;
+        for (size_t i = 0; i < words.len; ++i)
+                total += strlen(words.data[i]) + 1;
 
-        match_t *matches = malloc(sizeof(match_t) * words.len);
-        size_t match_count = 0;
+        f->words   = words;
+        f->lower   = (char *)malloc(total ? total : 1);
+        f->off     = (size_t *)malloc(sizeof(size_t) * (words.len + 1));
+        f->masks   = (uint64_t *)malloc(sizeof(uint64_t) * (words.len ? words.len : 1));
+        f->levels  = NULL;
+        f->nlevels = 0;
+        f->lq      = str_create();
+        f->query   = str_create();
+        f->top     = array_empty(cstr_ar);
+        f->total   = 0;
+        f->k       = k;
+        f->valid   = 0;
+        f->job     = NULL;
 
+        size_t pos = 0;
         for (size_t i = 0; i < words.len; ++i) {
-                int score = fuzzy_score(words.data[i], query);
-                if (score >= 0) {
-                        matches[match_count++] = (match_t){
-                                .word = words.data[i],
-                                .score = score
-                        };
+                const char *w    = words.data[i];
+                uint64_t    mask = 0;
+
+                f->off[i] = pos;
+                for (; *w; ++w) {
+                        unsigned char c = (unsigned char)tolower((unsigned char)*w);
+                        f->lower[pos++] = (char)c;
+                        mask |= char_bit(c);
                 }
+                f->lower[pos++] = 0;
+                f->masks[i]     = mask;
+        }
+        f->off[words.len] = pos;
+}
+
+void
+fuzzy_free(fuzzy_ctx *f)
+{
+        job_retire(f);
+
+        for (size_t i = 0; i < f->nlevels; ++i)
+                array_free(f->levels[i]);
+        free(f->levels);
+        free(f->lower);
+        free(f->off);
+        free(f->masks);
+        str_destroy(&f->lq);
+        str_destroy(&f->query);
+        array_free(f->top);
+}
+
+int
+fuzzy_begin(fuzzy_ctx  *f,
+            const char *query)
+{
+        size_t qlen = strlen(query);
+        size_t keep = 0;
+        size_t nstart;
+        size_t nthreads;
+        char  *q;
+
+        // Nothing changed, e.g. only the selection moved.
+        if ((f->valid || f->job) && !strcmp(str_cstr(&f->query), query))
+                return f->valid;
+
+        job_retire(f);
+
+        str_clear(&f->query);
+        str_concat(&f->query, query);
+        f->valid = 0;
+
+        if (qlen == 0) {
+                array_clear(f->top);
+                f->total = f->words.len;
+                for (size_t i = 0; i < f->words.len && i < f->k; ++i)
+                        array_append(f->top, f->words.data[i]);
+                f->valid = 1;
+                return 1;
         }
 
-        qsort(matches, match_count, sizeof(match_t), cmp_match);
+        q = (char *)malloc(qlen + 1);
+        for (size_t i = 0; i <= qlen; ++i)
+                q[i] = (char)tolower((unsigned char)query[i]);
 
-        for (size_t i = 0; i < match_count; ++i)
-                array_append(result, matches[i].word);
+        // Reuse the levels of the common prefix with the previous query,
+        // but always rescore from the level below the full query.
+        while (keep < f->nlevels && keep < qlen - 1 && str_cstr(&f->lq)[keep] == q[keep])
+                ++keep;
+        for (size_t i = keep; i < f->nlevels; ++i)
+                array_free(f->levels[i]);
+        f->nlevels = keep;
+        str_cut(&f->lq, keep);
+
+        nstart   = keep > 0 ? f->levels[keep-1].len : f->words.len;
+        nthreads = nstart >= FUZZY_PARALLEL_MIN ? pool_size() : 0;
+
+        if (nthreads == 0) {
+                f->job = job_create(f, q, keep, 1);
+                run_chunk(f->job, &f->job->chunks[0]);
+                f->job->ndone = 1;
+                job_finish(f);
+        } else {
+                size_t nchunks = nstart / FUZZY_CHUNK_MIN;
+
+                if (nchunks > nthreads * 8)
+                        nchunks = nthreads * 8;
+                if (nchunks < nthreads)
+                        nchunks = nthreads;
+
+                f->job = job_create(f, q, keep, nchunks);
+
+                pthread_mutex_lock(&g_pool.lock);
+                g_pool.job = f->job;
+                ++g_pool.gen;
+                pthread_cond_broadcast(&g_pool.wake);
+                pthread_mutex_unlock(&g_pool.lock);
+        }
+
+        free(q);
+        return f->valid;
+}
+
+int
+fuzzy_collect(fuzzy_ctx *f)
+{
+        size_t ndone;
+
+        if (f->valid || !f->job)
+                return f->valid;
+
+        pthread_mutex_lock(&g_pool.lock);
+        ndone = f->job->ndone;
+        pthread_mutex_unlock(&g_pool.lock);
+
+        if (ndone < f->job->nchunks)
+                merge_top(f, f->job);
+        else
+                job_finish(f);
+
+        return f->valid;
+}
+
+const cstr_ar *
+fuzzy_update(fuzzy_ctx  *f,
+             const char *query)
+{
+        if (!fuzzy_begin(f, query)) {
+                pthread_mutex_lock(&g_pool.lock);
+                while (f->job->ndone < f->job->nchunks)
+                        pthread_cond_wait(&g_pool.idle, &g_pool.lock);
+                pthread_mutex_unlock(&g_pool.lock);
+                fuzzy_collect(f);
+        }
 
-        free(matches);
-        return result;
+        return &f->top;
 }
@@ -31,12 +31,16 @@ struct {
         } term;
         struct {
                 size_t start_row;
+                int    restore;   // reopen the session of the directory
         } prelude;
         struct {
                 char *compile;
                 int   space_amt;
                 char *artwork;
                 const char *to_clipboard;
+                size_t      compile_max_lines;
+                size_t      buffer_memory; // bytes, 0 for no limit
+                char      **error_patterns;
 #ifdef WITH_LLM
                 const char *llm_model;
                 int         llm_think;
@@ -51,12 +55,16 @@ struct {
         },
         .prelude = {
                 .start_row = 1,
+                .restore   = 0,
         },
         .runtime = {
                 .compile   = NULL,
                 .space_amt = 8,
                 .artwork   = "ww1",
-                .to_clipboard = "echo -E '%%s' | xclip -selection clipboard",
+                .to_clipboard = "xclip -selection clipboard",
+                .compile_max_lines = 100000,
+                .buffer_memory     = 256UL*1024*1024,
+                .error_patterns    = NULL,
 #ifdef WITH_LLM
                 .llm_model = "qwen3:8b",
                 .llm_think = 0,
@@ -20,7 +20,9 @@
 #ifndef ARRAY_H_INCLUDED
 #define ARRAY_H_INCLUDED
 
+#include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 #define ARRAY_DEFINE(ty, name) \
     typedef struct name {        \
@@ -46,6 +48,16 @@
         (da).data[(da).len++] = (value);                                \
     } while (0)
 
+#define array_reserve(da, n)                                        \
+    do {                                                                \
+        if ((da).cap < (n)) {                                           \
+            (da).cap = (da).cap*2 > (n) ? (da).cap*2 : (n);             \
+            (da).data = (typeof(*((da).data)) *)                        \
+                realloc((da).data,                                      \
+                        (da).cap * sizeof(*((da).data)));               \
+        }                                                               \
+    } while (0)
+
 #define array_free(da)       \
     do {                         \
         if ((da).data != NULL) { \
@@ -94,6 +106,28 @@
         (da).len++; \
     } while (0)
 
+// Replace the `nrm' elements at `idx' with the `nins' elements at `src',
+// growing at most once and moving the tail once.
+#define array_splice(da, idx, nrm, src, nins) \
+    do { \
+        size_t __at_ = (idx), __rm_ = (nrm), __in_ = (nins); \
+        size_t __tl_ = (da).len - __at_ - __rm_; \
+        if (__at_ + __rm_ > (da).len) { \
+            fprintf(stderr, \
+                "[array error]: splice range %zu+%zu is out of bounds (len = %zu)\n", \
+                __at_, __rm_, (size_t)(da).len); \
+            exit(1); \
+        } \
+        array_reserve((da), (da).len - __rm_ + __in_); \
+        if (__tl_ && __rm_ != __in_) \
+            memmove((da).data + __at_ + __in_, \
+                    (da).data + __at_ + __rm_, \
+                    __tl_ * sizeof(*((da).data))); \
+        if (__in_) \
+            memcpy((da).data + __at_, (src), __in_ * sizeof(*((da).data))); \
+        (da).len = (da).len - __rm_ + __in_; \
+    } while (0)
+
 // Common types for arrays.
 
 ARRAY_DEFINE(int,      int_ar);
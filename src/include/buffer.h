@@ -21,17 +21,16 @@
 #define BUFFER_H_INCLUDED
 
 #include "array.h"
+#include "io.h"
 #include "line.h"
 #include "str.h"
-#include "set.h"
+#include "wordindex.h"
 #include "config.h"
 
 #define BUFFER_BUILTIN_COMPILE "ww-compile"
 #define BUFFER_BUILTIN_HELP    "ww-help"
 #define BUFFER_BUILTIN_MAN     "ww-man"
 
-extern char_ar g_cpy_buf;
-
 typedef struct ww ww;
 
 typedef enum {
@@ -55,6 +54,7 @@ typedef enum {
         BA_REQ_ERRJMP,
         BA_REQ_NEXTERROR,
         BA_REQ_PREVERROR,
+        BA_REQ_GOTODEF,
 #ifdef WITH_LLM
         BA_REQ_CONVO,
 #endif
@@ -67,18 +67,41 @@ typedef enum {
         BS_AUTO,
 } buffer_state;
 
+// A compiler diagnostic attached to a line of a buffer.
 typedef struct {
-        str name; // name of buffer, can be same as path
-                  // if buffer by the same name exists
-        str path; // path to the file we are editing
-        int builtin; // is this a builtin buffer
+        size_t    row; // line in the buffer, shifted by edits
+        unsigned  col;
+        int       sev; // diag_severity
+        char     *msg;
+} buffer_marker;
+
+ARRAY_DEFINE(buffer_marker, buffer_marker_ar);
+
+#define BUFFER_AC_MAX 32
+
+// Ranked completions for the word before the cursor. Cycling and
+// accepting reuse them for as long as the cursor stays where they were
+// ranked, the words belong to the shared word index.
+typedef struct {
+        str          prefix;
+        size_t       row;
+        unsigned     col;
+        const char  *words[BUFFER_AC_MAX]; // best first
+        size_t       words_n;
+        size_t       cycle;                // candidates shown so far
+} buffer_ac_session;
+
+// Where a buffer is seen from: the cursor, scroll and selection and the
+// part of the screen it is drawn in. Each monitor showing a buffer has
+// a view of its own, the lines are shared (see buffer_view_open).
+typedef struct buffer_view {
+        struct buffer *buf;
         struct {
                 unsigned w;  // width
                 unsigned h;  // height
                 unsigned ws; // width start
                 unsigned hs; // height start
         } size;
-        linep_ar     lines;    // lines in the buffer
         unsigned     cx;       // cursor x (logical & visual)
         unsigned     cy;       // cursor y (visual)
         unsigned     wish_col; // wished column to jump to
@@ -86,22 +109,45 @@ typedef struct {
         size_t       voff;     // vertical scroll offset
         size_t       hoff;     // horizontal scroll offset
         buffer_state state;    // current state
-        int          saved;    // is the buffer saved
         unsigned     sx;       // buffer selection x
         unsigned     sy;       // buffer selection y
+} buffer_view;
+
+ARRAY_DEFINE(buffer_view *, buffer_viewp_ar);
+
+typedef struct buffer {
+        str name; // name of buffer, can be same as path
+                  // if buffer by the same name exists
+        str path; // path to the file we are editing
+        int builtin; // is this a builtin buffer
+        linep_ar     lines;    // lines in the buffer
+        slab_pool   *pool;     // where its lines are allocated
+        buffer_view  home;     // the first monitor's view, kept while off screen
+        buffer_view *v;        // the view being drawn or edited through
+        buffer_viewp_ar views; // views of further monitors showing it
+        int          saved;    // is the buffer saved
         int          writable; // is buffer writable
         str          last_search; // last search query
         ww          *parent;      // parent editor
         int          last_tab;    // was the last character a tab
-        void        *ac;          // autocomplete
-        size_t       ac_cycle;    // current autocomplete cycle
-        cstr_set     found_words; // found words for autocomplete
+        wordref_ar   ac_refs;     // this buffer's words in the word index
+        row_run_ar   ac_dirty;    // rows whose words are out of ac_refs, sorted runs
+        buffer_ac_session ac_sess; // current autocomplete session
         int          paste;       // are we in a bracketed paste
+        int          yanked;      // was the last key a yank, for yank-pop
+        size_t       yank_y;      // where that yank started
+        unsigned     yank_x;
+        buffer_marker_ar markers; // diagnostics from ww-compile, sorted by row
+        struct buffer   *mru_prev; // bufreg links, more recently used
+        struct buffer   *mru_next; // less recently used
+        char            *reg_path; // canonical path bufreg knows it by
+        int              evicted;  // text dropped, read back from `path' when shown
+        int              stamped;  // `stamp' is the file as it was loaded or saved
+        file_stamp       stamp;
 } buffer;
 
 ARRAY_DEFINE(buffer *, bufferp_ar);
 
-void    init_buffer_translation_unit(void);
 buffer *buffer_from(str       name,
                     str       path,
                     unsigned  w,
@@ -110,8 +156,26 @@ buffer *buffer_from(str       name,
                     unsigned  hs,
                     linep_ar  lns,
                     ww       *parent);
+buffer *buffer_load(str       name,
+                    str       path,
+                    unsigned  w,
+                    unsigned  h,
+                    unsigned  ws,
+                    unsigned  hs,
+                    ww       *parent);
+buffer *buffer_load_deferred(str       name,
+                             str       path,
+                             unsigned  w,
+                             unsigned  h,
+                             unsigned  ws,
+                             unsigned  hs,
+                             ww       *parent);
 
 void           buffer_draw(const buffer *b);
+// Show `msg' on the status line now and at the next redraw of `b', so
+// it survives a command redrawing the screen when it returns. `msg' has
+// to live that long, normally it is a literal.
+void           buffer_notify(const buffer *b, const char *msg);
 void           buffer_drawxy(const buffer *b);
 buffer_action  buffer_process(buffer *b);
 void           buffer_make_readonly(buffer *b);
@@ -121,10 +185,19 @@ buffer_action  buffer_adjust_scroll(buffer *b);
 void           buffer_make_builtin(buffer *b);
 buffer        *ww_helpbuf_alloc(unsigned w, unsigned h, unsigned ws, unsigned hs, ww *parent);
 void           buffer_free(buffer *b);
+void           buffer_clear_lines(buffer *b);
 void           buffer_jump_to_verts(buffer *b, size_t x, size_t y);
 buffer_action  buffer_center_view(buffer *b);
 char          *buffer_to_cstr(const buffer *b);
 void           buffer_append_cstr(buffer *b, char *s);
 void           buffer_search(buffer *b, int reverse);
+void           buffer_add_marker(buffer *b, size_t row, unsigned col, int sev, const char *msg);
+void           buffer_clear_markers(buffer *b);
+str            buffer_word_at_cursor(const buffer *b);
+int            buffer_evict(buffer *b);
+void           buffer_ensure_loaded(buffer *b);
+buffer_view   *buffer_view_open(buffer *b);
+void           buffer_view_close(buffer_view *v);
+buffer        *buffer_view_use(buffer_view *v);
 
 #endif // BUFFER_H_INCLUDED
@@ -0,0 +1,54 @@
+/*
+ * ww: a simple editor
+ * Copyright (C) 2026 malloc-nbytes
+ * Contact: zdhdev@yahoo.com
+
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef BUFREG_H_INCLUDED
+#define BUFREG_H_INCLUDED
+
+#include "buffer.h"
+#include "map.h"
+
+MAP_DEFINE(const char *, buffer *, bufmap);
+
+// Every open buffer, indexed by name and by canonical path, and linked
+// in most recently used order through the buffers themselves. When two
+// buffers share a name or path, lookups find one of them.
+typedef struct {
+        buffer *mru;
+        buffer *lru;
+        size_t  len;
+        size_t  resident; // slab bytes holding the lines of all of them
+        bufmap  by_name;
+        bufmap  by_path;
+} bufreg;
+
+void    bufreg_init(bufreg *r);
+
+// New buffers go in as the least recently used.
+void    bufreg_add(bufreg *r, buffer *b);
+void    bufreg_remove(bufreg *r, buffer *b);
+
+// Make `b' the most recently used.
+void    bufreg_touch(bufreg *r, buffer *b);
+
+buffer *bufreg_by_name(bufreg *r, const char *name);
+
+// `path' does not need to be canonical.
+buffer *bufreg_by_path(bufreg *r, const char *path);
+
+#endif // BUFREG_H_INCLUDED
@@ -0,0 +1,40 @@
+/*
+ * ww: a simple editor
+ * Copyright (C) 2026 malloc-nbytes
+ * Contact: zdhdev@yahoo.com
+
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, see <https://www.gnu.org/licenses/>.
+ */
+#ifndef CLIPBOARD_H_INCLUDED
+#define CLIPBOARD_H_INCLUDED
+
+#include "killring.h"
+
+// Send kill ring entries to the system clipboard as `to-clipboard' says.
+// CLIPBOARD_OSC52 writes an OSC 52 sequence to the terminal, which also
+// reaches the clipboard over ssh. Anything else is a shell command that
+// reads the text on its stdin, such as `xclip -selection clipboard'.
+//
+// The entry's text is handed to a background thread by reference, so
+// editing never waits on the command or the terminal. A newer export
+// cuts one still being written short.
+#define CLIPBOARD_OSC52 "osc52"
+
+// Terminals drop OSC 52 payloads much larger than this, so bigger
+// entries are not sent that way and `b' says so.
+#define CLIPBOARD_OSC52_MAX (1024*1024)
+
+void clipboard_export(const struct buffer *b, const kill_entry *e);
+
+#endif // CLIPBOARD_H_INCLUDED
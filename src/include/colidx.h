@@ -0,0 +1,43 @@
+/*
+ * ww: a simple editor
+ * Copyright (C) 2026 malloc-nbytes
+ * Contact: zdhdev@yahoo.com
+
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, see <https://www.gnu.org/licenses/>.
+ */
+#ifndef COLIDX_H_INCLUDED
+#define COLIDX_H_INCLUDED
+
+#include "str.h"
+
+#include <stddef.h>
+
+// Strings at least COLIDX_MIN bytes long get an index of their
+// tab-expanded columns the first time a column is asked for, so
+// minified files and one-line dumps do not rescan megabytes per key.
+// The text is cut into chunks of about COLIDX_CHUNK bytes whose widths
+// are kept in a segment tree. Shorter strings are simply scanned.
+//
+// The index is keyed by the address of the str. The str_* functions
+// report their edits with colidx_edit, anything writing a tab into
+// `chars' directly must do the same.
+#define COLIDX_MIN   (64*1024)
+#define COLIDX_CHUNK 4096
+
+size_t colidx_column(const str *s, size_t i, unsigned tabw);
+size_t colidx_index(const str *s, size_t col, unsigned tabw);
+void   colidx_edit(const str *s, size_t at, size_t removed, size_t inserted);
+void   colidx_drop(const str *s);
+
+#endif // COLIDX_H_INCLUDED
@@ -0,0 +1,99 @@
+/*
+ * ww: a simple editor
+ * Copyright (C) 2026 malloc-nbytes
+ * Contact: zdhdev@yahoo.com
+
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef COMPILE_H_INCLUDED
+#define COMPILE_H_INCLUDED
+
+#include "buffer.h"
+#include "str.h"
+#include "line.h"
+#include "array.h"
+
+#include <stddef.h>
+
+// Redraw the sink's buffer at most this often while output streams in.
+#define COMPILE_SINK_FRAME_MS 33
+
+typedef enum {
+        DIAG_ERROR = 0,
+        DIAG_WARNING,
+        DIAG_NOTE,
+} diag_severity;
+
+typedef struct {
+        size_t        ln;   // output line, counted from the first line of output
+        char         *file;
+        int           row;
+        int           col;  // 0 if the tool did not report one
+        diag_severity sev;
+        char         *msg;  // rest of the line after the location
+        char         *real; // resolved `file', NULL until needed or if missing
+        int           resolved;
+} diag;
+
+ARRAY_DEFINE(diag, diag_ar);
+
+// Diagnostics found in `ww-compile', in output order. Output lines
+// map to buffer lines through `base' (buffer line of the first output
+// line still present) and `dropped' (output lines discarded so far).
+typedef struct {
+        diag_ar diags;
+        size_t  first;   // first diagnostic whose line is still in the buffer
+        size_t  cursor;  // diagnostic last visited by next/prev-error
+        size_t  base;
+        size_t  dropped;
+} diag_index;
+
+extern diag_index g_compile_diags;
+
+int         diag_parse_line(const char *s, diag *out);
+void        diag_free(diag *d);
+void        diag_index_clear(diag_index *idx);
+size_t      diag_index_count(const diag_index *idx);
+size_t      diag_index_bufline(const diag_index *idx, const diag *d);
+const diag *diag_index_at_bufline(const diag_index *idx, size_t bufline);
+const diag *diag_index_step(diag_index *idx, size_t bufline, int prev);
+void        diag_index_attach(diag_index *idx, buffer *b);
+
+// Collects the output of a child process into a buffer. Lines that
+// cross a read boundary are carried over to the next chunk, complete
+// lines are appended in bulk and the oldest output is dropped once
+// `max_lines' is exceeded.
+typedef struct {
+        buffer    *b;
+        str        partial;   // incomplete line carried across chunks
+        linep_ar   pending;   // complete lines not yet in the buffer
+        size_t     keep;      // leading lines that are never dropped
+        size_t     max_lines; // cap on output lines, 0 = unlimited
+        size_t     dropped;   // lines dropped so far
+        int        marker;    // has the "dropped" marker line been inserted
+        long long  last_draw; // time of last redraw (ms)
+        int        stale;     // output came in since the last redraw
+        size_t     nout;      // output lines produced so far
+        diag_index *diags;    // where to index diagnostics, can be NULL
+} compile_sink;
+
+void compile_sink_init(compile_sink *sink, buffer *b, size_t keep,
+                       size_t max_lines, diag_index *diags);
+// Feeding no bytes draws what came in since the last redraw, for when
+// the child goes quiet right after writing.
+void compile_sink_feed(const char *chunk, size_t len, void *sink);
+void compile_sink_finish(compile_sink *sink);
+
+#endif // COMPILE_H_INCLUDED
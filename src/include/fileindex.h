@@ -0,0 +1,34 @@
+/*
+ * ww: a simple editor
+ * Copyright (C) 2026 malloc-nbytes
+ * Contact: zdhdev@yahoo.com
+
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef FILEINDEX_H_INCLUDED
+#define FILEINDEX_H_INCLUDED
+
+#include "array.h"
+
+// Crawl `root' in the background and keep the result up to date with
+// inotify. Later calls are ignored.
+void    fileindex_start(const char *root);
+int     fileindex_started(void);
+
+// Every file found so far, relative to the root. The array and its
+// strings are owned by the index and valid until the next call.
+cstr_ar fileindex_files(void);
+
+#endif // FILEINDEX_H_INCLUDED
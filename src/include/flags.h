@@ -34,6 +34,8 @@ typedef enum {
 
 #define FLAG_2HY_CREATECONFIG "create-config"
 
+#define FLAG_2HY_RESTORE "restore"
+
 #define FLAG_1HY_VERSION 'v'
 #define FLAG_2HY_VERSION "version"
 
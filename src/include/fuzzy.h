@@ -21,7 +21,43 @@
 #define FUZZY_H_INCLUDED
 
 #include "array.h"
+#include "str.h"
 
-cstr_ar fuzzy_find(cstr_ar words, const char *query);
+#include <stdint.h>
+
+struct fuzzy_job;
+
+// Incremental matcher over a fixed candidate list. Each typed character
+// only re-checks the candidates that matched the shorter query, and only
+// the best `k' are ranked. Large lists are matched on a worker pool.
+typedef struct {
+        cstr_ar           words;   // candidates, borrowed
+        char             *lower;   // lowercased candidates, NUL separated
+        size_t           *off;     // start of each candidate in `lower'
+        uint64_t         *masks;   // characters present in each candidate
+        size_t_ar        *levels;  // levels[i]: candidates matching lq[0..i]
+        size_t            nlevels;
+        str               lq;      // lowercased query `levels' belong to
+        str               query;   // query `top' is for
+        cstr_ar           top;     // best matches, best first
+        size_t            total;   // number of candidates matching `query'
+        size_t            k;
+        int               valid;   // `top' is final for `query'
+        struct fuzzy_job *job;     // matching still running on the pool
+} fuzzy_ctx;
+
+void           fuzzy_init(fuzzy_ctx *f, cstr_ar words, size_t k);
+void           fuzzy_free(fuzzy_ctx *f);
+
+// Start matching `query', dropping work for any other query. Returns 1
+// if the result is already final.
+int            fuzzy_begin(fuzzy_ctx *f, const char *query);
+
+// Refresh `top' and `total' with what the workers finished so far.
+// Returns 1 once they are final.
+int            fuzzy_collect(fuzzy_ctx *f);
+
+// Blocking begin + collect.
+const cstr_ar *fuzzy_update(fuzzy_ctx *f, const char *query);
 
 #endif
@@ -35,12 +35,16 @@ extern struct {
         } term;
         struct {
                 size_t start_row;
+                int    restore;   // reopen and keep the session of the directory
         } prelude;
         struct {
                 char *compile;
                 int   space_amt;
                 char *artwork;
                 const char *to_clipboard;
+                size_t      compile_max_lines;
+                size_t      buffer_memory; // bytes, 0 for no limit
+                char      **error_patterns;
 #ifdef WITH_LLM
                 const char *llm_model;
                 int         llm_think;
@@ -0,0 +1,71 @@
+/*
+ * ww: a simple editor
+ * Copyright (C) 2026 malloc-nbytes
+ * Contact: zdhdev@yahoo.com
+
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef HASH_H_INCLUDED
+#define HASH_H_INCLUDED
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Tables grow past this load, in eighths.
+#define HASH_MAX_LOAD_8THS 7
+
+// FNV-1a with a murmur3 finalizer, the tables index by the low bits.
+static inline unsigned
+hash_bytes(const void *p,
+           size_t      n)
+{
+        const unsigned char *s = (const unsigned char *)p;
+        uint32_t             h = 2166136261u;
+
+        for (size_t i = 0; i < n; ++i) {
+                h ^= s[i];
+                h *= 16777619u;
+        }
+
+        h ^= h >> 16;
+        h *= 0x85ebca6bu;
+        h ^= h >> 13;
+        h *= 0xc2b2ae35u;
+        h ^= h >> 16;
+
+        return h;
+}
+
+static inline unsigned
+hash_cstr(const char *s)
+{
+        const unsigned char *p = (const unsigned char *)s;
+        uint32_t             h = 2166136261u;
+
+        while (*p) {
+                h ^= *p++;
+                h *= 16777619u;
+        }
+
+        h ^= h >> 16;
+        h *= 0x85ebca6bu;
+        h ^= h >> 13;
+        h *= 0xc2b2ae35u;
+        h ^= h >> 16;
+
+        return h;
+}
+
+#endif // HASH_H_INCLUDED
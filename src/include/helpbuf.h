@@ -74,6 +74,9 @@
 "M-m         = go to first non-space char on line\n" \
 "M-g n       = go to next error\n" \
 "M-g p       = go to previous error\n" \
+"M-g ]       = go to next diagnostic in this buffer\n" \
+"M-g [       = go to previous diagnostic in this buffer\n" \
+"M-g .       = go to the definition of the word under the cursor\n" \
 "C-u         = pop to last (x, y) location (UNIMPLEMENTED)\n" \
 "\n" \
 "Text Manipulation:\n" \
@@ -91,7 +94,8 @@
 "M-.           = highlight word\n" \
 "M-w           = copy selection *\n" \
 "C-w           = cut selection\n" \
-"C-y           = paste *\n" \
+"C-y           = paste the last copy or cut *\n" \
+"M-y           = replace what was just pasted with the copy or cut before it\n" \
 "C-k           = cut until end of line\n" \
 "M-j           = combine lines\n" \
 "M-g M-g       = jump to line number\n" \
@@ -22,17 +22,43 @@
 
 #include "array.h"
 
+#include <stddef.h>
+
 int   file_exists(const char *fp);
 int   create_file(const char *fp, int force_overwrite);
 int   is_dir(const char *path);
 int   write_file(const char *fp, const char *content);
 char *load_file(const char *path);
 
+// Identifies one version of a file on disk.
+typedef struct {
+        unsigned long long dev;
+        unsigned long long ino;
+        unsigned long long size;
+        long long          mtime_ns;
+} file_stamp;
+
+int         file_stamp_get(const char *path, file_stamp *out);
+int         file_stamp_eq(const file_stamp *a, const file_stamp *b);
+
+// Read-only view of a whole file, NULL if it can't be read. Must be
+// released with unmap_file.
+const char *map_file(const char *path, size_t *len);
+void        unmap_file(const char *data, size_t len);
+
+// Called for every entry below the walked directory with its path
+// relative to it. Returning 0 for a directory skips its contents.
+typedef int (*walkdir_visit)(const char *relpath, int is_dir, void *ctx);
+
 cstr_ar lsdir(const char *path);
 cstr_ar walkdir(const char *path);
+void    walkdir_each(const char *path, walkdir_visit visit, void *ctx);
 
 const char *gethome(void);
 char       *get_realpath(const char *fp);
+// Crawling all of / or $HOME is wasteful, the background indexes
+// only run on other directories.
+int         worth_indexing(const char *path);
 const char *get_basename(const char *name);
 
 #endif // IO_H_INCLUDED
@@ -0,0 +1,74 @@
+/*
+ * ww: a simple editor
+ * Copyright (C) 2026 malloc-nbytes
+ * Contact: zdhdev@yahoo.com
+
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, see <https://www.gnu.org/licenses/>.
+ */
+#ifndef KILLRING_H_INCLUDED
+#define KILLRING_H_INCLUDED
+
+#include "array.h"
+#include "line.h"
+#include "sv.h"
+
+#include <stdatomic.h>
+#include <stddef.h>
+
+// The last KILLRING_MAX copies and kills, newest first. Yanking inserts
+// the current one and yank-pop steps back through the older ones.
+//
+// A copy spanning several lines does not copy their text, it keeps
+// pointers to the lines of the buffer it came from. The buffer must call
+// killring_unshare before it changes any text, which gives those entries
+// their own copy, and killring_release before its lines are freed. Cut
+// lines are handed to the ring as they are and stay in their buffer's
+// pool, so only killring_release affects them.
+#define KILLRING_MAX 8
+
+struct buffer;
+
+// Text out of the lines it came from is never changed again, so
+// another thread may read it while it holds a reference.
+typedef struct {
+        atomic_size_t refs;
+        size_t        len;
+        char          chars[];
+} kill_text;
+
+typedef struct {
+        const struct buffer *src;   // whose lines are used, NULL once `text' holds it all
+        linep_ar             lines; // the text is cut from these
+        size_t               head;  // bytes of the first line left out
+        size_t               tail;  // bytes of the last line taken
+        int                  owned; // `lines' were cut out of `src' and go with the entry
+        kill_text           *text;
+} kill_entry;
+
+void              killring_push(const char *chars, size_t n);
+void              killring_share_lines(const struct buffer *src, line *const *lines, size_t n, size_t head, size_t tail);
+void              killring_take_lines(const struct buffer *src, linep_ar lines, size_t tail);
+const kill_entry *killring_current(void);
+const kill_entry *killring_rotate(void);
+size_t            killring_runs(const kill_entry *e);
+sv                killring_run(const kill_entry *e, size_t i);
+void              killring_unshare(const struct buffer *b);
+void              killring_release(const struct buffer *b);
+
+// The text of `e' in one block, copied out of its lines first if need
+// be. Let go of it with kill_text_drop, from any thread.
+kill_text        *killring_hold(const kill_entry *e);
+void              kill_text_drop(kill_text *t);
+
+#endif // KILLRING_H_INCLUDED
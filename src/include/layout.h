@@ -0,0 +1,80 @@
+/*
+ * ww: a simple editor
+ * Copyright (C) 2026 malloc-nbytes
+ * Contact: zdhdev@yahoo.com
+
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, see <https://www.gnu.org/licenses/>.
+ */
+#ifndef LAYOUT_H_INCLUDED
+#define LAYOUT_H_INCLUDED
+
+#include "array.h"
+#include "buffer.h"
+
+#include <stdio.h>
+
+// Panes smaller than this are not split any further.
+#define LAYOUT_MIN_W 8
+#define LAYOUT_MIN_H 3
+
+typedef enum {
+        LAYOUT_PANE,
+        LAYOUT_COLS, // two children side by side
+        LAYOUT_ROWS, // two children stacked
+} layout_kind;
+
+// How the screen is tiled: a tree of splits with panes at the leaves.
+// Each pane keeps where it is on screen, set by layout_place when the
+// terminal or the splits change, and whether it has to be redrawn.
+typedef struct layout {
+        layout_kind    kind;
+        struct layout *parent;
+        struct layout *kids[2];
+        buffer_view   *view;    // what the pane shows, or NULL
+        unsigned       x;       // column of the left edge
+        unsigned       y;       // row of the top edge
+        unsigned       w;       // width
+        unsigned       h;       // height
+        int            damaged; // the pane has to be drawn in full
+} layout;
+
+ARRAY_DEFINE(layout *, layoutp_ar);
+
+layout *layout_pane(void);
+
+// Split `pane' in two, it becomes the first half and the returned,
+// empty pane the second. Returns NULL if `pane' is too small.
+layout *layout_split(layout *pane, layout_kind kind);
+
+// Free `l' and everything below it, the views are left alone.
+void    layout_free(layout *l);
+
+// Lay `l' out over the given area. Panes that moved or were resized
+// are damaged and their views sized to match.
+void    layout_place(layout *l, unsigned x, unsigned y, unsigned w, unsigned h);
+
+// Size `pane's view to the pane.
+void    layout_fit(layout *pane);
+
+// The panes of `l' from left to right and top to bottom.
+void    layout_panes(layout *l, layoutp_ar *out);
+
+// Write the shape of `l' in preorder, one character a node: `p' for a
+// pane, `c' and `r' for a split into columns or rows.
+void    layout_spec(const layout *l, FILE *fp);
+
+// Read back what layout_spec wrote, NULL if `spec' is malformed.
+layout *layout_from_spec(const char *spec);
+
+#endif // LAYOUT_H_INCLUDED
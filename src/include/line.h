@@ -22,19 +22,39 @@
 
 #include "str.h"
 #include "array.h"
+#include "slab.h"
+
+#include <stddef.h>
+
+// The text lives right behind the header, so a line is one allocation
+// sized to fit it. str moves the text to the heap once it outgrows that
+// room, see str_is_inline. Lines made while editing get LINE_ROOM bytes
+// to grow into.
+//
+// Lines come from the slab pool passed to their constructor, normally
+// that of the buffer they are for. NULL means a pool shared by lines
+// that have no buffer yet.
+#define LINE_ROOM 48
 
 typedef struct {
-        str txt;
+        str  txt;
+        char inl[];
 } line;
 
+_Static_assert(offsetof(line, inl) == sizeof(str), "inline text must follow the header");
+
 ARRAY_DEFINE(line *, linep_ar);
 
-line     *line_alloc(void);
-line     *line_from(str s);
-line     *line_create_nothing(void);
-line     *line_from_cstr(const char *s);
+line     *line_alloc(slab_pool *pool);
+line     *line_from(slab_pool *pool, str s);
+line     *line_create_nothing(slab_pool *pool);
+line     *line_from_cstr(slab_pool *pool, const char *s);
+line     *line_from_n(slab_pool *pool, const char *chars, size_t n);
 void      line_append(line *ln, char ch);
-linep_ar  lines_from(char *chars);
+linep_ar  lines_from(slab_pool *pool, const char *chars);
+linep_ar  lines_from_n(slab_pool *pool, const char *chars, size_t n);
 void      line_free(line *ln);
+void      lines_splice(linep_ar *ar, size_t at, size_t n, line *const *ins, size_t nins);
+void      lines_take(linep_ar *ar, size_t at, size_t n, linep_ar *out);
 
 #endif // LINE_H_INCLUDED
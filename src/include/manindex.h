@@ -0,0 +1,34 @@
+/*
+ * ww: a simple editor
+ * Copyright (C) 2026 malloc-nbytes
+ * Contact: zdhdev@yahoo.com
+
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef MANINDEX_H_INCLUDED
+#define MANINDEX_H_INCLUDED
+
+#include "array.h"
+
+// Start loading the apropos (`man -k .') page list in the background.
+// The list is read from the cache in ~/.cache/ww when it is newer than
+// the man database, otherwise rebuilt and written back.
+void    manindex_start(void);
+
+// Wait for the page list and return it. Entries point into the index
+// and must not be freed or modified.
+cstr_ar manindex_get(void);
+
+#endif // MANINDEX_H_INCLUDED
@@ -20,26 +20,29 @@
 #ifndef MAP_H_INCLUDED
 #define MAP_H_INCLUDED
 
+#include "hash.h"
+
 #include <stddef.h>
 #include <stdlib.h>
 
-#define MAP_DEFAULT_CAPACITY 2048
+// Open addressing with Robin Hood probing, grows by doubling.
+#define MAP_DEFAULT_CAPACITY 16
 
 #define MAP_DEFINE(ktype, vtype, mapname) \
         typedef unsigned (*mapname##_hash_sig)(ktype *); \
         typedef int      (*mapname##_cmp_sig)(ktype *, ktype *); \
         \
-        typedef struct __mapname##_node { \
-                ktype k; \
-                vtype v; \
-                struct __mapname##_node *n; \
-        } __##mapname##_node; \
+        typedef struct { \
+                ktype    k; \
+                vtype    v; \
+                unsigned h; \
+                unsigned d; /* distance from home slot + 1, 0 when empty */ \
+        } __##mapname##_slot; \
         \
         typedef struct { \
                 struct { \
-                        __##mapname##_node **data; \
-                        size_t len; \
-                        size_t cap; \
+                        __##mapname##_slot *data; \
+                        size_t cap; /* power of two */ \
                         size_t sz; \
                 } tbl; \
                 mapname##_hash_sig hash; \
@@ -49,20 +52,21 @@
         mapname mapname##_create(mapname##_hash_sig hash, mapname##_cmp_sig cmp); \
         void mapname##_destroy(mapname *map); \
         void mapname##_insert(mapname *map, ktype k, vtype v); \
+        void mapname##_remove(mapname *map, ktype k); \
         int mapname##_contains(mapname *map, ktype k); \
-        vtype *mapname##_get(mapname *map, ktype k)
+        vtype *mapname##_get(mapname *map, ktype k); \
+        size_t mapname##_size(const mapname *map)
 
 #define MAP_IMPL(ktype, vtype, mapname) \
         mapname \
         mapname##_create(mapname##_hash_sig hash, \
                          mapname##_cmp_sig cmp) \
         { \
-                __##mapname##_node **data \
-                        = (__##mapname##_node **)calloc(MAP_DEFAULT_CAPACITY, sizeof(__##mapname##_node *)); \
+                __##mapname##_slot *data \
+                        = (__##mapname##_slot *)calloc(MAP_DEFAULT_CAPACITY, sizeof(__##mapname##_slot)); \
                 return (mapname) { \
                         .tbl = { \
                                 .data = data, \
-                                .len = 0, \
                                 .cap = MAP_DEFAULT_CAPACITY, \
                                 .sz = 0, \
                         }, \
@@ -70,33 +74,92 @@
                         .cmp = cmp, \
                 }; \
         } \
-        void \
-        mapname##_insert(mapname *map, ktype k, vtype v) \
+        \
+        /* Robin Hood: the slot goes to whichever entry is further from home. */ \
+        static void \
+        __##mapname##_place(__##mapname##_slot *data, size_t cap, __##mapname##_slot it) \
         { \
-                unsigned idx = map->hash(&k) % (unsigned)map->tbl.cap;  \
-                __##mapname##_node *it = map->tbl.data[idx]; \
-                __##mapname##_node *prev = NULL; \
-                while (it) { \
-                        if (!map->cmp(&it->k, &k)) {   \
-                                it->v = v; \
-                                return; \
+                size_t i = it.h & (cap-1); \
+                it.d = 1; \
+                while (data[i].d) { \
+                        if (data[i].d < it.d) { \
+                                __##mapname##_slot tmp = data[i]; \
+                                data[i] = it; \
+                                it = tmp; \
                         } \
-                        prev = it; \
-                        it = it->n; \
+                        i = (i+1) & (cap-1); \
+                        ++it.d; \
                 } \
-                it = (__##mapname##_node *)malloc(sizeof(__##mapname##_node)); \
-                it->k = k; \
-                it->v = v; \
-                it->n = NULL; \
-                if (prev) { \
-                        prev->n = it; \
-                } else { \
-                        map->tbl.data[idx] = it; \
-                        ++map->tbl.len; \
+                data[i] = it; \
+        } \
+        \
+        static void \
+        __##mapname##_grow(mapname *map) \
+        { \
+                size_t cap = map->tbl.cap * 2; \
+                __##mapname##_slot *data = (__##mapname##_slot *)calloc(cap, sizeof(__##mapname##_slot)); \
+                for (size_t i = 0; i < map->tbl.cap; ++i) \
+                        if (map->tbl.data[i].d) \
+                                __##mapname##_place(data, cap, map->tbl.data[i]); \
+                free(map->tbl.data); \
+                map->tbl.data = data; \
+                map->tbl.cap = cap; \
+        } \
+        \
+        /* Slot holding `k', or cap. Probing stops at the first entry that \
+           is closer to home than `k' would be. */ \
+        static size_t \
+        __##mapname##_find(mapname *map, ktype *k, unsigned h) \
+        { \
+                size_t i = h & (map->tbl.cap-1); \
+                for (unsigned d = 1; map->tbl.data[i].d >= d; ++d) { \
+                        if (map->tbl.data[i].h == h && !map->cmp(&map->tbl.data[i].k, k)) \
+                                return i; \
+                        i = (i+1) & (map->tbl.cap-1); \
                 } \
+                return map->tbl.cap; \
+        } \
+        \
+        void \
+        mapname##_destroy(mapname *map) \
+        { \
+                free(map->tbl.data); \
+                map->tbl.data = NULL; \
+                map->tbl.cap = map->tbl.sz = 0; \
+        } \
+        \
+        void \
+        mapname##_insert(mapname *map, ktype k, vtype v) \
+        { \
+                unsigned h = map->hash(&k); \
+                size_t i = __##mapname##_find(map, &k, h); \
+                if (i != map->tbl.cap) { \
+                        map->tbl.data[i].v = v; \
+                        return; \
+                } \
+                if ((map->tbl.sz+1) * 8 > map->tbl.cap * HASH_MAX_LOAD_8THS) \
+                        __##mapname##_grow(map); \
+                __##mapname##_place(map->tbl.data, map->tbl.cap, (__##mapname##_slot) { .k = k, .v = v, .h = h, .d = 0 }); \
                 ++map->tbl.sz; \
         } \
         \
+        /* Entries after the hole shift back a slot, no tombstones. */ \
+        void \
+        mapname##_remove(mapname *map, ktype k) \
+        { \
+                size_t i = __##mapname##_find(map, &k, map->hash(&k)); \
+                if (i == map->tbl.cap) return; \
+                size_t j = (i+1) & (map->tbl.cap-1); \
+                while (map->tbl.data[j].d > 1) { \
+                        map->tbl.data[i] = map->tbl.data[j]; \
+                        --map->tbl.data[i].d; \
+                        i = j; \
+                        j = (j+1) & (map->tbl.cap-1); \
+                } \
+                map->tbl.data[i].d = 0; \
+                --map->tbl.sz; \
+        } \
+        \
         int \
         mapname##_contains(mapname *map, ktype k) \
         { \
@@ -106,15 +169,14 @@
         vtype * \
         mapname##_get(mapname *map, ktype k) \
         { \
-                unsigned idx = map->hash(&k) % (unsigned)map->tbl.cap; \
-                __##mapname##_node *it = map->tbl.data[idx]; \
-                while (it) { \
-                        if (!map->cmp(&it->k, &k)) {  \
-                                return &it->v; \
-                        } \
-                        it = it->n; \
-                } \
-                return NULL; \
+                size_t i = __##mapname##_find(map, &k, map->hash(&k)); \
+                return i == map->tbl.cap ? NULL : &map->tbl.data[i].v; \
+        } \
+        \
+        size_t \
+        mapname##_size(const mapname *map) \
+        { \
+                return map->tbl.sz; \
         }
 
 #endif // MAP_H_INCLUDED
@@ -20,31 +20,34 @@
 #ifndef SET_H_INCLUDED
 #define SET_H_INCLUDED
 
+#include "hash.h"
+
 #include <assert.h>
 #include <stddef.h>
 #include <stdlib.h>
 
-#define SET_DEFAULT_CAPACITY 256
+// Open addressing with Robin Hood probing, grows by doubling.
+#define SET_DEFAULT_CAPACITY 16
 
 #define SET_DEFINE(type, setname) \
         typedef unsigned (*setname##_hash_sig)(type *); \
         typedef int      (*setname##_cmp_sig)(type *, type *); \
         typedef void     (*setname##_vfree_sig)(type *); \
         \
-        typedef struct __##setname##_node { \
-                type v; \
-                struct __##setname##_node *n; \
-        } __##setname##_node; \
+        typedef struct { \
+                type     v; \
+                unsigned h; \
+                unsigned d; /* distance from home slot + 1, 0 when empty */ \
+        } __##setname##_slot; \
         \
         typedef struct { \
                 struct { \
-                        __##setname##_node **data; \
-                        size_t len; \
-                        size_t cap; \
+                        __##setname##_slot *data; \
+                        size_t cap; /* power of two */ \
                         size_t sz; \
                 } tbl; \
                 setname##_hash_sig hash; \
-                setname##_cmp_sig cmp; /*returns 0 on equal*/   \
+                setname##_cmp_sig cmp; /*returns 0 on equal*/ \
                 setname##_vfree_sig vfree; \
         } setname; \
         \
@@ -67,12 +70,11 @@
         { \
                 assert(hash); \
                 assert(cmp); \
-                __##setname##_node **data \
-                        = (__##setname##_node **)calloc(SET_DEFAULT_CAPACITY, sizeof(__##setname##_node *)); \
+                __##setname##_slot *data \
+                        = (__##setname##_slot *)calloc(SET_DEFAULT_CAPACITY, sizeof(__##setname##_slot)); \
                 return (setname) { \
                         .tbl = { \
                                 .data = data, \
-                                .len  = 0, \
                                 .cap  = SET_DEFAULT_CAPACITY, \
                                 .sz   = 0, \
                         }, \
@@ -81,89 +83,105 @@
                         .vfree = vfree, \
                 }; \
         } \
-        void \
-        setname##_insert(setname *s, type v) \
+        \
+        /* Robin Hood: the slot goes to whichever entry is further from home. */ \
+        static void \
+        __##setname##_place(__##setname##_slot *data, size_t cap, __##setname##_slot it) \
         { \
-                unsigned idx = s->hash(&v) % (unsigned)s->tbl.cap; \
-                __##setname##_node *it = s->tbl.data[idx]; \
-                __##setname##_node *prev = NULL; \
-                while (it) { \
-                        if (s->cmp(&it->v, &v) == 0) return; \
-                        prev = it; \
-                        it = it->n; \
+                size_t i = it.h & (cap-1); \
+                it.d = 1; \
+                while (data[i].d) { \
+                        if (data[i].d < it.d) { \
+                                __##setname##_slot tmp = data[i]; \
+                                data[i] = it; \
+                                it = tmp; \
+                        } \
+                        i = (i+1) & (cap-1); \
+                        ++it.d; \
                 } \
-                __##setname##_node *n = (__##setname##_node *)malloc(sizeof(__##setname##_node)); \
-                n->v = v; \
-                n->n = NULL; \
-                if (prev) { \
-                        prev->n = n; \
-                } else { \
-                        s->tbl.data[idx] = n; \
-                        ++s->tbl.len; \
+                data[i] = it; \
+        } \
+        \
+        static void \
+        __##setname##_grow(setname *s) \
+        { \
+                size_t cap = s->tbl.cap * 2; \
+                __##setname##_slot *data = (__##setname##_slot *)calloc(cap, sizeof(__##setname##_slot)); \
+                for (size_t i = 0; i < s->tbl.cap; ++i) \
+                        if (s->tbl.data[i].d) \
+                                __##setname##_place(data, cap, s->tbl.data[i]); \
+                free(s->tbl.data); \
+                s->tbl.data = data; \
+                s->tbl.cap = cap; \
+        } \
+        \
+        /* Slot holding `v', or cap. Probing stops at the first entry that \
+           is closer to home than `v' would be. */ \
+        static size_t \
+        __##setname##_find(const setname *s, type *v, unsigned h) \
+        { \
+                size_t i = h & (s->tbl.cap-1); \
+                for (unsigned d = 1; s->tbl.data[i].d >= d; ++d) { \
+                        if (s->tbl.data[i].h == h && s->cmp(&s->tbl.data[i].v, v) == 0) \
+                                return i; \
+                        i = (i+1) & (s->tbl.cap-1); \
                 } \
+                return s->tbl.cap; \
+        } \
+        \
+        void \
+        setname##_insert(setname *s, type v) \
+        { \
+                unsigned h = s->hash(&v); \
+                if (__##setname##_find(s, &v, h) != s->tbl.cap) return; \
+                if ((s->tbl.sz+1) * 8 > s->tbl.cap * HASH_MAX_LOAD_8THS) \
+                        __##setname##_grow(s); \
+                __##setname##_place(s->tbl.data, s->tbl.cap, (__##setname##_slot) { .v = v, .h = h, .d = 0 }); \
                 ++s->tbl.sz; \
         } \
         \
+        /* Entries after the hole shift back a slot, no tombstones. */ \
         void \
         setname##_remove(setname *s, type v) \
         { \
-                unsigned idx = s->hash(&v) % (unsigned)s->tbl.cap; \
-                __##setname##_node *it = s->tbl.data[idx]; \
-                __##setname##_node *prev = NULL; \
-                while (it) { \
-                        if (s->cmp(&it->v, &v) == 0) { \
-                                if (prev) { \
-                                        prev->n = it->n; \
-                                        /* TODO: free 'it' */ \
-                                } else { \
-                                        prev = it->n; \
-                                        s->tbl.data[idx] = prev; \
-                                        /* TODO: free 'it' */ \
-                                } \
-                                --s->tbl.sz; \
-                        } \
-                        prev = it; \
-                        it = it->n; \
+                size_t i = __##setname##_find(s, &v, s->hash(&v)); \
+                if (i == s->tbl.cap) return; \
+                if (s->vfree) s->vfree(&s->tbl.data[i].v); \
+                size_t j = (i+1) & (s->tbl.cap-1); \
+                while (s->tbl.data[j].d > 1) { \
+                        s->tbl.data[i] = s->tbl.data[j]; \
+                        --s->tbl.data[i].d; \
+                        i = j; \
+                        j = (j+1) & (s->tbl.cap-1); \
                 } \
+                s->tbl.data[i].d = 0; \
+                --s->tbl.sz; \
         } \
         \
         int \
         setname##_contains(const setname *s, type v) \
         { \
-                unsigned idx = s->hash(&v) % (unsigned)s->tbl.cap; \
-                __##setname##_node *it = s->tbl.data[idx]; \
-                while (it) { \
-                        if (s->cmp(&it->v, &v) == 0) return 1; \
-                        it = it->n; \
-                } \
-                return 0; \
+                return __##setname##_find(s, &v, s->hash(&v)) != s->tbl.cap; \
         } \
         \
         void \
         setname##_destroy(setname *s) \
         { \
-                for (size_t i = 0; i < s->tbl.cap; ++i) { \
-                        __##setname##_node *it = s->tbl.data[i]; \
-                        while (it) { \
-                                if (s->vfree) s->vfree(&it->v); \
-                                __##setname##_node *tmp = it; \
-                                it = it->n; \
-                                free(tmp); \
-                        } \
-                } \
+                for (size_t i = 0; i < s->tbl.cap; ++i) \
+                        if (s->tbl.data[i].d && s->vfree) \
+                                s->vfree(&s->tbl.data[i].v); \
+                free(s->tbl.data); \
+                s->tbl.data = NULL; \
+                s->tbl.cap = s->tbl.sz = 0; \
         } \
         \
         void \
         setname##_print(const setname *s, \
                         void (*show)(type *t)) \
         { \
-                for (size_t i = 0; i < s->tbl.cap; ++i) { \
-                        __##setname##_node *it = s->tbl.data[i]; \
-                        while (it) { \
-                                show(&it->v); \
-                                it = it->n; \
-                        } \
-                } \
+                for (size_t i = 0; i < s->tbl.cap; ++i) \
+                        if (s->tbl.data[i].d) \
+                                show(&s->tbl.data[i].v); \
         } \
         \
         size_t \
@@ -175,18 +193,14 @@
         type ** \
         setname##_iter(const setname *s) \
         { \
-                type **ar = (type **)malloc(sizeof(type *) * s->tbl.sz + 1); \
+                type **ar = (type **)malloc(sizeof(type *) * (s->tbl.sz + 1)); \
                 size_t ar_n = 0; \
-                for (size_t i = 0; i < s->tbl.cap; ++i) { \
-                        __##setname##_node *it = s->tbl.data[i]; \
-                        while (it) { \
-                                ar[ar_n++] = &it->v; \
-                                it = it->n; \
-                        } \
-                } \
+                for (size_t i = 0; i < s->tbl.cap; ++i) \
+                        if (s->tbl.data[i].d) \
+                                ar[ar_n++] = &s->tbl.data[i].v; \
                 ar[ar_n] = NULL; \
                 return ar; \
-        } \
+        }
 
 SET_DEFINE(char *, cstr_set);
 
@@ -0,0 +1,49 @@
+/*
+ * ww: a simple editor
+ * Copyright (C) 2026 malloc-nbytes
+ * Contact: zdhdev@yahoo.com
+
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef SLAB_H_INCLUDED
+#define SLAB_H_INCLUDED
+
+#include <stddef.h>
+
+// Size classed pools for many small objects with the same lifetime,
+// such as the lines of a buffer. Objects carry no header: every object
+// sits in a SLAB_SIZE aligned block whose start says which pool and
+// class it belongs to, so it can be freed on its own from anywhere.
+// Objects past SLAB_MAX get a block to themselves.
+
+#define SLAB_SIZE  (16*1024)
+#define SLAB_ALIGN 16
+#define SLAB_MAX   512
+
+typedef struct slab_pool slab_pool;
+
+slab_pool *slab_pool_create(void);
+void       slab_pool_destroy(slab_pool *p);
+void       slab_pool_reset(slab_pool *p);
+void      *slab_alloc(slab_pool *p, size_t n);
+void       slab_free(void *obj);
+slab_pool *slab_owner(const void *obj);
+
+// Bytes of slabs and big blocks the pool holds, freed objects included.
+// A pool can also keep a total shared with other pools up to date.
+size_t     slab_pool_bytes(const slab_pool *p);
+void       slab_pool_count_into(slab_pool *p, size_t *total);
+
+#endif // SLAB_H_INCLUDED
@@ -35,7 +35,7 @@ ARRAY_DEFINE(const str *, conststrp_ar);
 
 str         str_create(void);
 str         str_from(const char *chars);
-const char *str_cstr(const str *s);
+const char *str_cstr(str *s);
 void        str_append(str *s, char c);
 void        str_concat(str *s, const char *chars);
 void        str_overwrite(str *s, const char *repl);
@@ -43,13 +43,25 @@ void        str_clear(str *s);
 size_t      str_len(const str *s);
 void        str_destroy(str *s);
 void        str_insert(str *s, size_t i, char ch);
+void        str_insert_n(str *s, size_t i, const char *chars, size_t n);
+void        str_erase_range(str *s, size_t i, size_t n);
+void        str_append_n(str *s, const char *chars, size_t n);
+void        str_assign(str *s, const char *chars, size_t n);
 void        str_cut(str *s, size_t i);
 void        str_rm(str *s, size_t i);
 char        str_pop(str *s);
 char        str_at(const str *s, size_t i);
 void        str_trim_before(str *s);
 str         str_from_fmt(const char *fmt, ...);
-void        str_remove_range(str *s, size_t start, size_t count);
 str         str_dup(str s);
+int         str_is_inline(const str *s);
+
+// A gap lets repeated edits at one spot skip moving the rest of the
+// text (see str.c). While it is open `chars' is not one piece: read a
+// gapped str with str_at or str_run, or close the gap first.
+void        str_gap_at(str *s, size_t at);
+void        str_gap_close(void);
+int         str_gapped(const str *s);
+size_t      str_run(const str *s, size_t i, const char **p);
 
 #endif // STR_H_INCLUDED
@@ -0,0 +1,70 @@
+/*
+ * ww: a simple editor
+ * Copyright (C) 2026 malloc-nbytes
+ * Contact: zdhdev@yahoo.com
+
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef SYMINDEX_H_INCLUDED
+#define SYMINDEX_H_INCLUDED
+
+#include "array.h"
+
+#include <stddef.h>
+
+typedef enum {
+        SYM_FUNC = 0,
+        SYM_TYPE,
+        SYM_MACRO,
+} sym_kind;
+
+typedef struct {
+        const char *name;
+        const char *path; // relative to the root
+        unsigned    line; // 1-based
+        sym_kind    kind;
+} symbol;
+
+ARRAY_DEFINE(symbol, symbol_ar);
+
+// Index the definitions in the C, C++ and Python sources under `root'
+// in the background. The previous run is read back from ~/.cache/ww
+// and only files whose size, mtime and contents changed are scanned
+// again. Later calls are ignored.
+void          symindex_start(const char *root);
+
+// Look for changed files again, e.g. after a save.
+void          symindex_refresh(void);
+
+// Whether the first scan is done. Until then the lookups below never
+// wait, they see the previous run's table or nothing.
+int           symindex_ready(void);
+
+// Definitions of `name', `*n' is set to how many there are. What this
+// and symindex_labels() return is owned by the index and valid until
+// the next call into it.
+const symbol *symindex_lookup(const char *name, size_t *n);
+
+// "name [kind] path:line" for every definition, sorted by name.
+cstr_ar       symindex_labels(void);
+
+// The label of one definition as symindex_labels() has it, newly
+// allocated.
+char         *symindex_label(const symbol *s);
+
+// The definition a label from symindex_labels() stands for.
+const symbol *symindex_from_label(const char *label);
+
+#endif // SYMINDEX_H_INCLUDED
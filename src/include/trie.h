@@ -30,14 +30,32 @@
 #  define WARN_UNUSED_RESULT
 #endif
 
-void *trie_alloc(void) WARN_UNUSED_RESULT;
-int trie_insert(void *t, const char *word);
-char **trie_get_completions(void       *t,
-                            const char *prefix,
-                            size_t      max_results,
-                            size_t     *out_count);
-int trie_empty(void *t);
-void trie_destroy(void *t);
+typedef struct {
+        const char *word;  // owned by the trie, valid until it is destroyed
+        size_t      count; // occurrences currently in the trie
+} trie_entry;
+
+void  *trie_alloc(void) WARN_UNUSED_RESULT;
+
+// Add `n' occurrences of `word' and return the trie's copy of it, which
+// stays at the same address even after the word is removed.
+const char *trie_insert(void *t, const char *word, size_t n);
+
+// Drop up to `n' occurrences of `word', 1 if that removed the word.
+int    trie_remove(void *t, const char *word, size_t n);
+int    trie_contains(void *t, const char *word);
+// The trie's copy of `word' while it is in the trie, NULL otherwise.
+const char *trie_find(void *t, const char *word);
+
+// Fill `out' with up to `max_results' words starting with `prefix', in
+// lexicographic order, and return how many were written.
+size_t trie_get_completions(void        *t,
+                            const char  *prefix,
+                            trie_entry  *out,
+                            size_t       max_results);
+// Number of words starting with `prefix'.
+size_t trie_count(void *t, const char *prefix);
+int    trie_empty(void *t);
+void   trie_destroy(void *t);
 
 #endif // TRIE_H_INCLUDED
-
@@ -0,0 +1,71 @@
+/*
+ * ww: a simple editor
+ * Copyright (C) 2026 malloc-nbytes
+ * Contact: zdhdev@yahoo.com
+
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef WORDINDEX_H_INCLUDED
+#define WORDINDEX_H_INCLUDED
+
+#include "array.h"
+#include "line.h"
+#include "trie.h"
+
+// One buffer's share of the word index.
+typedef struct {
+        const char *word;  // interned in the index, never freed
+        size_t      count; // occurrences in the buffer
+        size_t      line;  // line it was last counted on
+} wordref;
+
+ARRAY_DEFINE(wordref, wordref_ar);
+
+// Replace the words `refs' holds in the index with the ones in `lines'.
+// Only the difference reaches the shared counts, `refs' ends up sorted
+// by word address.
+void           wordindex_update(wordref_ar *refs, const linep_ar *lines);
+
+// Rows [from, to) of a buffer.
+typedef struct {
+        size_t from;
+        size_t to;
+} row_run;
+
+ARRAY_DEFINE(row_run, row_run_ar);
+
+// Count the words of the rows in `runs' into `refs' and the index, or
+// back out before the rows change. Rows edited since the last update go
+// through these instead of a whole new update, `refs' is merged or
+// compacted once per call.
+void           wordindex_add_rows(wordref_ar *refs, const linep_ar *lines,
+                                  const row_run *runs, size_t n);
+void           wordindex_remove_rows(wordref_ar *refs, const linep_ar *lines,
+                                     const row_run *runs, size_t n);
+
+// Take all of the words in `refs' out of the index and free it.
+void           wordindex_release(wordref_ar *refs);
+
+// `word' must come from the index.
+const wordref *wordindex_find(const wordref_ar *refs, const char *word);
+
+// Words of every buffer starting with `prefix', counted across buffers.
+// Returns how many were written to `out'.
+size_t         wordindex_completions(const char *prefix,
+                                     trie_entry *out,
+                                     size_t      max_results);
+size_t         wordindex_count(const char *prefix);
+
+#endif // WORDINDEX_H_INCLUDED
@@ -21,6 +21,8 @@
 #define WW_H_INCLUDED
 
 #include "buffer.h"
+#include "bufreg.h"
+#include "layout.h"
 #include "config.h"
 
 #include <stddef.h>
@@ -38,6 +40,7 @@
 #define WW_CMD_MAN                "man"
 #define WW_CMD_TOGGLE_DUMBINDENT  "toggle-dumb-indent"
 #define WW_CMD_TOGGLE_AUTOBRACKET "toggle-autobracket"
+#define WW_CMD_SYMBOLS            "symbols"
 
 #ifdef WITH_LLM
 #define WW_CMD_PROMPT             "prompt"
@@ -58,27 +61,40 @@
         WW_CMD_MAN, \
         WW_CMD_TOGGLE_DUMBINDENT, \
         WW_CMD_TOGGLE_AUTOBRACKET, \
+        WW_CMD_SYMBOLS, \
         WW_CMD_PROMPT, \
         NULL, \
 }
 // NOTE: WW_CMD_PROMPT MUST BE LAST BEFORE NULL
 
 typedef struct ww {
-        bufferp_ar  buffers;
-        buffer     *monitors[4];
-        uint8_t     am;
+        bufreg      bufs;
+        layout     *root;  // how the screen is tiled between monitors
+        layoutp_ar  panes; // the monitors in order, see layout_panes
+        size_t      am;    // the active one
 } ww;
 
 ww   ww_create(void);
 void ww_run(ww *ed);
-int  ww_buffer_exists_by_name(const ww *ed, const char *name);
-int  ww_buffer_exists_by_path(const ww *ed, const char *path);
+int  ww_buffer_exists_by_name(ww *ed, const char *name);
+int  ww_buffer_exists_by_path(ww *ed, const char *path);
 void ww_add_buffer(ww *ed, buffer *b);
-void ww_make_buffer_primary(ww *ed, size_t idx);
+void ww_make_buffer_primary(ww *ed, buffer *b);
 void ww_make_buffer_primary_by_path(ww *ed, const char *path);
 void ww_clear_monitors(ww *ed);
 void ww_display_monitors(ww *ed, buffer_action ba);
 void ww_switch_buffer(ww *ed);
 void ww_make_buffer_primary_by_name(ww *ed, const char *name);
 
+// The buffer on monitor `i', NULL if there is none.
+buffer *ww_monitor(const ww *ed, size_t i);
+
+// Show `b' on monitor `i' and edit it through that monitor's view. The
+// first monitor to show a buffer sees it through the buffer's own view,
+// the others get one of their own.
+buffer *ww_show(ww *ed, size_t i, buffer *b);
+
+// Tile the screen with `root' instead, its monitors start out empty.
+void    ww_set_layout(ww *ed, layout *root);
+
 #endif // WW_H_INCLUDED
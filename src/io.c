@@ -19,16 +19,25 @@
 
 #include "io.h"
 #include "array.h"
+#include "config.h"
 
 #include <assert.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
+#include <sys/mman.h>
 #include <sys/stat.h>
+#include <fcntl.h>
 #include <dirent.h>
 #include <errno.h>
 #include <pwd.h>
 #include <unistd.h>
+#if HAVE_PATH_MAX
+#include <limits.h>
+#else
+#define PATH_MAX 4096
+#endif
 
 int
 file_exists(const char *fp)
@@ -109,6 +118,76 @@ load_file(const char *path)
         return buf;
 }
 
+int
+file_stamp_get(const char *path,
+               file_stamp *out)
+{
+        struct stat st;
+
+        if (stat(path, &st) != 0 || !S_ISREG(st.st_mode))
+                return 0;
+
+        out->dev      = (unsigned long long)st.st_dev;
+        out->ino      = (unsigned long long)st.st_ino;
+        out->size     = (unsigned long long)st.st_size;
+        out->mtime_ns = (long long)st.st_mtim.tv_sec*1000000000LL + st.st_mtim.tv_nsec;
+
+        return 1;
+}
+
+int
+file_stamp_eq(const file_stamp *a,
+              const file_stamp *b)
+{
+        return a->dev == b->dev
+                && a->ino == b->ino
+                && a->size == b->size
+                && a->mtime_ns == b->mtime_ns;
+}
+
+const char *
+map_file(const char *path,
+         size_t     *len)
+{
+        struct stat  st;
+        void        *p;
+        int          fd;
+
+        if ((fd = open(path, O_RDONLY | O_CLOEXEC)) == -1)
+                return NULL;
+
+        if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+                close(fd);
+                return NULL;
+        }
+
+        // mmap refuses empty mappings.
+        if (st.st_size == 0) {
+                close(fd);
+                *len = 0;
+                return "";
+        }
+
+        p = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+
+        if (p == MAP_FAILED)
+                return NULL;
+
+        (void)madvise(p, (size_t)st.st_size, MADV_SEQUENTIAL);
+
+        *len = (size_t)st.st_size;
+        return (const char *)p;
+}
+
+void
+unmap_file(const char *data,
+           size_t      len)
+{
+        if (len)
+                (void)munmap((void *)(uintptr_t)data, len);
+}
+
 cstr_ar
 lsdir(const char *dir)
 {
@@ -128,6 +207,96 @@ lsdir(const char *dir)
         return files;
 }
 
+static int
+walkdir_skip(const char *name)
+{
+        return !strcmp(name, ".git") || !strcmp(name, ".hg") || !strcmp(name, ".svn");
+}
+
+// `buf' holds the directory being read, `len' its length and `root_len'
+// the length of the prefix that is not reported.
+static void
+walkdir_rec(char          *buf,
+            size_t         root_len,
+            size_t         len,
+            walkdir_visit  visit,
+            void          *ctx)
+{
+        DIR           *dp;
+        struct dirent *entry;
+
+        if (!(dp = opendir(buf)))
+                return;
+
+        while ((entry = readdir(dp))) {
+                const char *name = entry->d_name;
+                size_t      n    = strlen(name);
+                int         dir;
+
+                if (!strcmp(name, ".") || !strcmp(name, ".."))
+                        continue;
+                if (len + 1 + n + 1 > PATH_MAX)
+                        continue;
+
+                buf[len] = '/';
+                memcpy(buf + len + 1, name, n + 1);
+
+                // Symlinks are reported but never followed.
+                if (entry->d_type == DT_UNKNOWN) {
+                        struct stat st;
+                        if (lstat(buf, &st) != 0)
+                                goto next;
+                        dir = S_ISDIR(st.st_mode);
+                } else {
+                        dir = entry->d_type == DT_DIR;
+                }
+
+                if (dir && walkdir_skip(name))
+                        goto next;
+
+                if (visit(buf + root_len + 1, dir, ctx) && dir)
+                        walkdir_rec(buf, root_len, len + 1 + n, visit, ctx);
+
+        next:
+                buf[len] = 0;
+        }
+
+        closedir(dp);
+}
+
+void
+walkdir_each(const char    *path,
+             walkdir_visit  visit,
+             void          *ctx)
+{
+        char   buf[PATH_MAX];
+        size_t len = strlen(path);
+
+        if (len + 1 > PATH_MAX)
+                return;
+
+        memcpy(buf, path, len + 1);
+        walkdir_rec(buf, len, len, visit, ctx);
+}
+
+static int
+walkdir_collect(const char *relpath,
+                int         is_dir,
+                void       *ctx)
+{
+        if (!is_dir)
+                array_append(*(cstr_ar *)ctx, strdup(relpath));
+        return 1;
+}
+
+cstr_ar
+walkdir(const char *path)
+{
+        cstr_ar files = array_empty(cstr_ar);
+        walkdir_each(path, walkdir_collect, &files);
+        return files;
+}
+
 const char *
 gethome(void)
 {
@@ -196,6 +365,19 @@ get_realpath(const char *fp)
         return absolute;
 }
 
+int
+worth_indexing(const char *path)
+{
+        char       *real = get_realpath(path);
+        const char *home = gethome();
+        int         ok;
+
+        ok = real && strcmp(real, "/") && (!home || strcmp(real, home));
+        free(real);
+
+        return ok;
+}
+
 const char *
 get_basename(const char *name)
 {
@@ -0,0 +1,244 @@
+/*
+ * ww: a simple editor
+ * Copyright (C) 2026 malloc-nbytes
+ * Contact: zdhdev@yahoo.com
+
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, see <https://www.gnu.org/licenses/>.
+ */
+#include "killring.h"
+#include "str.h"
+#include "mem.h"
+
+#include <string.h>
+
+// Entries 0 to g_len-1 are in use, `g_newest' is the last one pushed and
+// `g_yank' how far back from it the current one is.
+static kill_entry g_ring[KILLRING_MAX];
+static size_t     g_len    = 0;
+static size_t     g_newest = 0;
+static size_t     g_yank   = 0;
+
+static kill_text *
+text_new(size_t n)
+{
+        kill_text *t = (kill_text *)alloc(sizeof(kill_text) + n);
+
+        atomic_init(&t->refs, 1);
+        t->len = n;
+
+        return t;
+}
+
+void
+kill_text_drop(kill_text *t)
+{
+        if (t && atomic_fetch_sub_explicit(&t->refs, 1, memory_order_acq_rel) == 1)
+                free(t);
+}
+
+static void
+entry_clear(kill_entry *e)
+{
+        if (e->owned)
+                for (size_t i = 0; i < e->lines.len; ++i)
+                        line_free(e->lines.data[i]);
+
+        array_free(e->lines);
+        kill_text_drop(e->text);
+
+        e->src   = NULL;
+        e->lines = array_empty(linep_ar);
+        e->head  = 0;
+        e->tail  = 0;
+        e->owned = 0;
+        e->text  = NULL;
+}
+
+// Copy the text out of the lines it was sliced from.
+static void
+entry_own(kill_entry *e)
+{
+        kill_text *t;
+        size_t     n = 0;
+
+        for (size_t i = 0; i < killring_runs(e); ++i)
+                n += killring_run(e, i).len;
+
+        t = text_new(n);
+        n = 0;
+
+        for (size_t i = 0; i < killring_runs(e); ++i) {
+                sv run = killring_run(e, i);
+                memcpy(t->chars + n, run.s, run.len);
+                n += run.len;
+        }
+
+        entry_clear(e);
+        e->text = t;
+}
+
+static kill_entry *
+next_slot(void)
+{
+        g_newest = g_len ? (g_newest + 1) % KILLRING_MAX : 0;
+        g_yank   = 0;
+
+        if (g_len < KILLRING_MAX)
+                ++g_len;
+
+        entry_clear(&g_ring[g_newest]);
+
+        return &g_ring[g_newest];
+}
+
+void
+killring_push(const char *chars,
+              size_t      n)
+{
+        kill_entry *e;
+
+        if (n == 0)
+                return;
+
+        e = next_slot();
+
+        e->text = text_new(n);
+        memcpy(e->text->chars, chars, n);
+}
+
+// The `n' lines at `lines' from `head' bytes into the first one up to
+// `tail' bytes into the last, without copying any text.
+void
+killring_share_lines(const struct buffer *src,
+                     line *const         *lines,
+                     size_t               n,
+                     size_t               head,
+                     size_t               tail)
+{
+        kill_entry *e = next_slot();
+
+        array_reserve(e->lines, n);
+        memcpy(e->lines.data, lines, n*sizeof(line *));
+        e->lines.len = n;
+
+        e->src  = src;
+        e->head = head;
+        e->tail = tail;
+}
+
+// Like killring_share_lines with no head, but the ring becomes the owner
+// of `lines', which must no longer be in `src'.
+void
+killring_take_lines(const struct buffer *src,
+                    linep_ar             lines,
+                    size_t               tail)
+{
+        kill_entry *e = next_slot();
+
+        e->src   = src;
+        e->lines = lines;
+        e->tail  = tail;
+        e->owned = 1;
+}
+
+const kill_entry *
+killring_current(void)
+{
+        if (g_len == 0)
+                return NULL;
+
+        return &g_ring[(g_newest + KILLRING_MAX - g_yank) % KILLRING_MAX];
+}
+
+const kill_entry *
+killring_rotate(void)
+{
+        if (g_len == 0)
+                return NULL;
+
+        g_yank = (g_yank + 1) % g_len;
+
+        return killring_current();
+}
+
+// The text of an entry comes in runs, one per line it was sliced from.
+size_t
+killring_runs(const kill_entry *e)
+{
+        return e->src ? e->lines.len : 1;
+}
+
+sv
+killring_run(const kill_entry *e,
+             size_t            i)
+{
+        const str *s;
+        size_t     from;
+        size_t     to;
+
+        if (!e->src && !e->text)
+                return (sv) { .s = NULL, .len = 0 };
+        if (!e->src)
+                return (sv) { .s = e->text->chars, .len = e->text->len };
+
+        s    = &e->lines.data[i]->txt;
+        from = i == 0 ? e->head : 0;
+        to   = i == e->lines.len-1 ? e->tail : s->len;
+
+        return (sv) { .s = s->chars + from, .len = to - from };
+}
+
+static void
+own_from(const struct buffer *b,
+         int                  cut_too)
+{
+        for (size_t i = 0; i < g_len; ++i) {
+                kill_entry *e = &g_ring[i];
+
+                if (e->src != b || (e->owned && !cut_too))
+                        continue;
+
+                // The lines are read through `chars'.
+                str_gap_close();
+                entry_own(e);
+        }
+}
+
+void
+killring_unshare(const struct buffer *b)
+{
+        own_from(b, 0);
+}
+
+void
+killring_release(const struct buffer *b)
+{
+        own_from(b, 1);
+}
+
+kill_text *
+killring_hold(const kill_entry *e)
+{
+        kill_entry *slot = &g_ring[e - g_ring];
+
+        if (slot->src) {
+                // The lines are read through `chars'.
+                str_gap_close();
+                entry_own(slot);
+        }
+
+        atomic_fetch_add_explicit(&slot->text->refs, 1, memory_order_relaxed);
+
+        return slot->text;
+}
@@ -0,0 +1,193 @@
+/*
+ * ww: a simple editor
+ * Copyright (C) 2026 malloc-nbytes
+ * Contact: zdhdev@yahoo.com
+
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, see <https://www.gnu.org/licenses/>.
+ */
+#include "layout.h"
+#include "mem.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+// Deeper trees than this are not read back.
+#define SPEC_DEPTH 32
+
+layout *
+layout_pane(void)
+{
+        layout *l = (layout *)alloc(sizeof(layout));
+
+        *l = (layout) {
+                .kind    = LAYOUT_PANE,
+                .damaged = 1,
+        };
+
+        return l;
+}
+
+layout *
+layout_split(layout      *pane,
+             layout_kind  kind)
+{
+        layout *first;
+        layout *second;
+
+        if (kind == LAYOUT_COLS ? pane->w/2 < LAYOUT_MIN_W : pane->h/2 < LAYOUT_MIN_H)
+                return NULL;
+
+        // `pane' turns into the split so its parent needs no update.
+        first  = layout_pane();
+        second = layout_pane();
+
+        first->view    = pane->view;
+        first->parent  = pane;
+        second->parent = pane;
+
+        pane->kind    = kind;
+        pane->view    = NULL;
+        pane->kids[0] = first;
+        pane->kids[1] = second;
+
+        layout_place(pane, pane->x, pane->y, pane->w, pane->h);
+
+        return second;
+}
+
+void
+layout_free(layout *l)
+{
+        if (!l)
+                return;
+        if (l->kind != LAYOUT_PANE) {
+                layout_free(l->kids[0]);
+                layout_free(l->kids[1]);
+        }
+        free(l);
+}
+
+// Buffers keep the bottom edge of their area in `h', not its height.
+void
+layout_fit(layout *pane)
+{
+        if (!pane->view)
+                return;
+
+        pane->view->size.w  = pane->w;
+        pane->view->size.h  = pane->y + pane->h;
+        pane->view->size.ws = pane->x;
+        pane->view->size.hs = pane->y;
+}
+
+void
+layout_place(layout   *l,
+             unsigned  x,
+             unsigned  y,
+             unsigned  w,
+             unsigned  h)
+{
+        if (l->kind == LAYOUT_PANE) {
+                if (l->x != x || l->y != y || l->w != w || l->h != h)
+                        l->damaged = 1;
+                l->x = x;
+                l->y = y;
+                l->w = w;
+                l->h = h;
+                layout_fit(l);
+                return;
+        }
+
+        l->x = x;
+        l->y = y;
+        l->w = w;
+        l->h = h;
+
+        if (l->kind == LAYOUT_COLS) {
+                layout_place(l->kids[0], x, y, w/2, h);
+                layout_place(l->kids[1], x + w/2, y, w - w/2, h);
+        } else {
+                layout_place(l->kids[0], x, y, w, h/2);
+                layout_place(l->kids[1], x, y + h/2, w, h - h/2);
+        }
+}
+
+void
+layout_panes(layout     *l,
+             layoutp_ar *out)
+{
+        if (l->kind == LAYOUT_PANE) {
+                array_append(*out, l);
+                return;
+        }
+
+        layout_panes(l->kids[0], out);
+        layout_panes(l->kids[1], out);
+}
+
+void
+layout_spec(const layout *l,
+            FILE         *fp)
+{
+        fputc(l->kind == LAYOUT_PANE ? 'p' : l->kind == LAYOUT_COLS ? 'c' : 'r', fp);
+
+        if (l->kind != LAYOUT_PANE) {
+                layout_spec(l->kids[0], fp);
+                layout_spec(l->kids[1], fp);
+        }
+}
+
+static layout *
+from_spec(const char **spec,
+          int          depth)
+{
+        layout *l;
+        char    ch = **spec;
+
+        if (depth > SPEC_DEPTH || (ch != 'p' && ch != 'c' && ch != 'r'))
+                return NULL;
+
+        ++*spec;
+        l = layout_pane();
+
+        if (ch == 'p')
+                return l;
+
+        l->kind    = ch == 'c' ? LAYOUT_COLS : LAYOUT_ROWS;
+        l->kids[0] = from_spec(spec, depth+1);
+        l->kids[1] = l->kids[0] ? from_spec(spec, depth+1) : NULL;
+
+        if (!l->kids[1]) {
+                layout_free(l);
+                return NULL;
+        }
+
+        l->kids[0]->parent = l;
+        l->kids[1]->parent = l;
+
+        return l;
+}
+
+layout *
+layout_from_spec(const char *spec)
+{
+        layout *l = from_spec(&spec, 0);
+
+        if (l && *spec) {
+                layout_free(l);
+                return NULL;
+        }
+
+        return l;
+}
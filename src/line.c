@@ -21,49 +21,73 @@
 #include "str.h"
 #include "mem.h"
 
-line *
-line_alloc(void)
+#include <string.h>
+
+static slab_pool *g_shared_pool = NULL;
+
+// A line holding the `n' bytes at `chars' with room for at least
+// `room' bytes of text, rounded up to fill the slab object.
+static line *
+line_new(slab_pool  *pool,
+         const char *chars,
+         size_t      n,
+         size_t      room)
 {
-        line *l;
+        size_t  cap = n + 1 > room ? n + 1 : room;
+        size_t  sz  = (sizeof(line) + cap + SLAB_ALIGN - 1) & ~(size_t)(SLAB_ALIGN - 1);
+        line   *l;
+
+        if (!pool && !(pool = g_shared_pool))
+                pool = g_shared_pool = slab_pool_create();
+
+        l = (line *)slab_alloc(pool, sz);
 
-        l = (line *)alloc(sizeof(line));
+        l->txt.chars = l->inl;
+        l->txt.cap   = sz - sizeof(line);
+        l->txt.len   = n;
 
-        l->txt = str_from("\n");
+        memcpy(l->inl, chars, n);
+        l->inl[n] = 0;
 
         return l;
 }
 
 line *
-line_create_nothing(void)
+line_alloc(slab_pool *pool)
 {
-        line *l;
-
-        l      = (line *)alloc(sizeof(line));
-        l->txt = str_create();
+        return line_new(pool, "\n", 1, LINE_ROOM);
+}
 
-        return l;
+line *
+line_create_nothing(slab_pool *pool)
+{
+        return line_new(pool, "", 0, LINE_ROOM);
 }
 
 line *
-line_from(str s)
+line_from(slab_pool *pool,
+          str        s)
 {
-        line *l;
+        line *l = line_new(pool, s.chars ? s.chars : "", s.len, LINE_ROOM);
 
-        l      = (line *)alloc(sizeof(line));
-        l->txt = s;
+        str_destroy(&s);
 
         return l;
 }
 
 line *
-line_from_cstr(const char *s)
+line_from_cstr(slab_pool  *pool,
+               const char *s)
 {
-        line *l;
-
-        l      = (line *)alloc(sizeof(line));
-        l->txt = str_from(s);
+        return line_new(pool, s, strlen(s), LINE_ROOM);
+}
 
-        return l;
+line *
+line_from_n(slab_pool  *pool,
+            const char *chars,
+            size_t      n)
+{
+        return line_new(pool, chars, n, LINE_ROOM);
 }
 
 void
@@ -73,28 +97,36 @@ line_append(line *ln, char ch)
 }
 
 linep_ar
-lines_from(char *chars)
+lines_from(slab_pool  *pool,
+           const char *chars)
 {
-        linep_ar ar;
-        str      buf;
-
-        ar  = array_empty(linep_ar);
-        buf = str_create();
-
-        for (size_t i = 0; chars[i]; ++i) {
-                str_append(&buf, chars[i]);
-                if (chars[i] == '\n') {
-                        array_append(ar, line_from(str_from(buf.chars)));
-                        str_clear(&buf);
-                }
-        }
+        return lines_from_n(pool, chars, strlen(chars));
+}
 
-        if (buf.len > 0) {
-                str_append(&buf, '\n');
-                array_append(ar, line_from(str_dup(buf)));
-        }
+// Like lines_from but takes a length, so `chars' may be a mapped file
+// without a terminator. Lines are cut with memchr instead of being
+// built one character at a time.
+linep_ar
+lines_from_n(slab_pool  *pool,
+             const char *chars,
+             size_t      n)
+{
+        linep_ar    ar  = array_empty(linep_ar);
+        const char *p   = chars;
+        const char *end = chars + n;
+
+        while (p < end) {
+                const char *nl  = (const char *)memchr(p, '\n', (size_t)(end - p));
+                size_t      len = nl ? (size_t)(nl - p) + 1 : (size_t)(end - p);
+                line       *l   = line_new(pool, p, len, 0);
 
-        str_destroy(&buf);
+                // The last line may be missing its newline.
+                if (!nl)
+                        line_append(l, '\n');
+
+                array_append(ar, l);
+                p += len;
+        }
 
         return ar;
 }
@@ -103,5 +135,35 @@ void
 line_free(line *ln)
 {
         str_destroy(&ln->txt);
-        free(ln);
+        slab_free(ln);
+}
+
+// Free the `n' lines at `at' and put the `nins' lines of `ins' in their
+// place. The rest of the array is moved once, whatever the sizes.
+void
+lines_splice(linep_ar    *ar,
+             size_t       at,
+             size_t       n,
+             line *const *ins,
+             size_t       nins)
+{
+        for (size_t i = 0; i < n; ++i)
+                line_free(ar->data[at+i]);
+
+        array_splice(*ar, at, n, ins, nins);
+}
+
+// Move the `n' lines at `at' to the end of `out' without freeing them.
+void
+lines_take(linep_ar *ar,
+           size_t    at,
+           size_t    n,
+           linep_ar *out)
+{
+        array_reserve(*out, out->len + n);
+        memcpy(out->data + out->len, ar->data + at, n*sizeof(line *));
+        out->len += n;
+
+        memmove(ar->data + at, ar->data + at + n, (ar->len - at - n)*sizeof(line *));
+        ar->len -= n;
 }
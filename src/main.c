@@ -26,9 +26,15 @@
 #include "ww.h"
 #include "rc.h"
 #include "glconf.h"
+#include "manindex.h"
+#include "fileindex.h"
+#include "symindex.h"
+#include "session.h"
+#include "bufreg.h"
 
 #include <assert.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #define _GNU_SOURCE
 #include <unistd.h>
@@ -49,11 +55,19 @@ run(const char *path)
         }
 
         if (path && !is_dir(path)) {
-                ww_add_buffer(&ed, buffer_from(str_from(get_basename(path)),
-                                               str_from(path),
-                                               (unsigned)glconf.term.w, (unsigned)glconf.term.h,
-                                               0, 0,
-                                               lines_from(load_file(path)), &ed));
+                int     restored = glconf.prelude.restore && session_restore(&ed);
+                buffer *b        = restored ? bufreg_by_path(&ed.bufs, path) : NULL;
+
+                if (!b) {
+                        b = buffer_load(str_from(get_basename(path)),
+                                        str_from(path),
+                                        (unsigned)glconf.term.w, (unsigned)glconf.term.h,
+                                        0, 0, &ed);
+                        ww_add_buffer(&ed, b);
+                }
+                // The file goes on the active monitor of the session.
+                if (restored)
+                        buffer_ensure_loaded(ww_show(&ed, ed.am, b));
         } else {
                 if (path) {
                         if (chdir(path) != 0) {
@@ -61,11 +75,22 @@ run(const char *path)
                                 fatal("aborting");
                         }
                 }
-                ww_add_buffer(&ed, ww_helpbuf_alloc((unsigned)glconf.term.w,
-                                                    (unsigned)glconf.term.h, 0, 0, &ed));
+                // A session takes the place of the help screen and
+                // keeps its own cursors.
+                if (glconf.prelude.restore && session_restore(&ed))
+                        glconf.prelude.start_row = 0;
+                else
+                        ww_add_buffer(&ed, ww_helpbuf_alloc((unsigned)glconf.term.w,
+                                                            (unsigned)glconf.term.h, 0, 0, &ed));
         }
 
-        ww_make_buffer_primary(&ed, 0);
+        if (!ww_monitor(&ed, 0))
+                ww_make_buffer_primary(&ed, ed.bufs.mru);
+
+        if (worth_indexing(".")) {
+                fileindex_start(".");
+                symindex_start(".");
+        }
 
         ww_run(&ed);
 }
@@ -78,6 +103,8 @@ init(void)
         if (!glconf.runtime.compile)
                 glconf.runtime.compile = strdup("make");
 
+        manindex_start();
+
         struct sigaction sa;
         sa.sa_handler = sigint_handler;
         sa.sa_flags = 0;
@@ -121,8 +148,6 @@ main(int argc, char *argv[])
                 fatal("init");
         atexit(cleanup);
 
-        init_buffer_translation_unit();
-
         run(path);
 
         return 0;
@@ -0,0 +1,260 @@
+/*
+ * ww: a simple editor
+ * Copyright (C) 2026 malloc-nbytes
+ * Contact: zdhdev@yahoo.com
+
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "manindex.h"
+#include "io.h"
+#include "config.h"
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+#if HAVE_PATH_MAX
+#include <limits.h>
+#else
+#define PATH_MAX 4096
+#endif
+
+#define MANINDEX_MAGIC "ww-apropos 1"
+
+// Page names live back to back in one allocation, NUL separated,
+// `names' are views into it.
+typedef struct {
+        char    *blob;
+        size_t   len;
+        size_t   cap;
+        cstr_ar  names;
+} man_table;
+
+static man_table  g_table    = {0};
+static pthread_t  g_thread;
+static int        g_started  = 0;
+static int        g_joined   = 0;
+static char       g_cache_path[PATH_MAX] = {0};
+
+// Anything that mandb touches when it updates, newest one wins.
+static long long
+mandb_stamp(void)
+{
+        static const char *paths[] = {
+                "/var/cache/man/index.db",
+                "/var/cache/man",
+                "/usr/share/man",
+                "/usr/local/share/man",
+        };
+
+        long long stamp = 0;
+
+        for (size_t i = 0; i < sizeof(paths)/sizeof(*paths); ++i) {
+                struct stat st;
+                long long   t;
+
+                if (stat(paths[i], &st) != 0)
+                        continue;
+
+                t = (long long)st.st_mtim.tv_sec * 1000000000LL + st.st_mtim.tv_nsec;
+                if (t > stamp)
+                        stamp = t;
+        }
+
+        return stamp;
+}
+
+static void
+table_push(man_table  *t,
+           const char *s,
+           size_t      n)
+{
+        if (t->len + n + 1 > t->cap) {
+                t->cap = t->cap ? t->cap*2 : 64*1024;
+                while (t->cap < t->len + n + 1)
+                        t->cap *= 2;
+                t->blob = realloc(t->blob, t->cap);
+        }
+
+        memcpy(t->blob + t->len, s, n);
+        t->blob[t->len + n] = 0;
+        t->len += n + 1;
+}
+
+// Only done once the blob stops moving.
+static void
+table_index(man_table *t)
+{
+        t->names = array_empty(cstr_ar);
+
+        for (size_t i = 0; i < t->len; i += strlen(t->blob + i) + 1)
+                array_append(t->names, t->blob + i);
+}
+
+static int
+cache_load(man_table *t,
+           long long  stamp)
+{
+        FILE      *fp;
+        long long  cached_stamp;
+        size_t     len;
+        int        ok;
+
+        if (!(fp = fopen(g_cache_path, "rb")))
+                return 0;
+
+        ok = 0;
+
+        if (fscanf(fp, MANINDEX_MAGIC " %lld %zu", &cached_stamp, &len) != 2
+            || fgetc(fp) != '\n'
+            || cached_stamp != stamp
+            || len == 0)
+                goto done;
+
+        t->blob = malloc(len);
+        t->len  = len;
+        t->cap  = len;
+
+        if (fread(t->blob, 1, len, fp) != len || t->blob[len-1] != 0) {
+                free(t->blob);
+                memset(t, 0, sizeof(*t));
+                goto done;
+        }
+
+        ok = 1;
+
+ done:
+        fclose(fp);
+        return ok;
+}
+
+static void
+cache_store(const man_table *t,
+            long long        stamp)
+{
+        char  tmp[PATH_MAX + 16];
+        char *slash;
+        FILE *fp;
+
+        if (!g_cache_path[0])
+                return;
+
+        // mkdir -p, the cache path is always absolute
+        strcpy(tmp, g_cache_path);
+        for (slash = strchr(tmp+1, '/'); slash; slash = strchr(slash+1, '/')) {
+                *slash = 0;
+                if (mkdir(tmp, 0755) != 0 && errno != EEXIST)
+                        return;
+                *slash = '/';
+        }
+
+        snprintf(tmp, sizeof(tmp), "%s.%d", g_cache_path, (int)getpid());
+
+        if (!(fp = fopen(tmp, "wb")))
+                return;
+
+        fprintf(fp, MANINDEX_MAGIC " %lld %zu\n", stamp, t->len);
+        if (fwrite(t->blob, 1, t->len, fp) != t->len) {
+                fclose(fp);
+                unlink(tmp);
+                return;
+        }
+
+        if (fclose(fp) != 0 || rename(tmp, g_cache_path) != 0)
+                unlink(tmp);
+}
+
+static void
+build(man_table *t)
+{
+        FILE    *fp;
+        char    *ln;
+        size_t   cap;
+        ssize_t  n;
+
+        if (!(fp = popen("man -k . 2>/dev/null", "r")))
+                return;
+
+        ln  = NULL;
+        cap = 0;
+
+        while ((n = getline(&ln, &cap, fp)) != -1) {
+                size_t len = strcspn(ln, " \n");
+                if (len > 0)
+                        table_push(t, ln, len);
+        }
+
+        free(ln);
+        pclose(fp);
+}
+
+static void *
+worker(void *arg)
+{
+        (void)arg;
+
+        long long stamp = mandb_stamp();
+
+        if (!cache_load(&g_table, stamp)) {
+                build(&g_table);
+                if (g_table.len > 0)
+                        cache_store(&g_table, stamp);
+        }
+
+        table_index(&g_table);
+
+        return NULL;
+}
+
+void
+manindex_start(void)
+{
+        const char *xdg;
+        const char *home;
+
+        if (g_started)
+                return;
+
+        // resolved here, gethome() is not safe to call from the worker
+        if ((xdg = getenv("XDG_CACHE_HOME")) && xdg[0] == '/')
+                snprintf(g_cache_path, sizeof(g_cache_path), "%s/ww/apropos", xdg);
+        else if ((home = gethome()))
+                snprintf(g_cache_path, sizeof(g_cache_path), "%s/.cache/ww/apropos", home);
+
+        if (pthread_create(&g_thread, NULL, worker, NULL) != 0) {
+                // no thread, do it inline
+                worker(NULL);
+                g_joined = 1;
+        }
+
+        g_started = 1;
+}
+
+cstr_ar
+manindex_get(void)
+{
+        manindex_start();
+
+        if (!g_joined) {
+                pthread_join(g_thread, NULL);
+                g_joined = 1;
+        }
+
+        return g_table.names;
+}
@@ -24,17 +24,21 @@
 #include "colors.h"
 #include "fuzzy.h"
 #include "glconf.h"
+#include "killring.h"
 
 #include <assert.h>
 #include <stdio.h>
 #include <string.h>
 #include <ctype.h>
+#include <poll.h>
+#include <unistd.h>
 
 #define MAX_COMPLETIONS           200
 #define DISPLAY_COUNT             6
 #define MAX_COMPLETIONS_REQUEST   200
 #define MAX_VERTICAL_LINES        8
 #define FILE_SELECTION_PADDING    10
+#define MINIBUFFER_FRAME_MS       16
 
 typedef struct {
         str    input;
@@ -42,6 +46,17 @@ typedef struct {
         size_t offset;
 } completion_state;
 
+static int
+input_pending(int timeout_ms)
+{
+        struct pollfd pfd = {
+                .fd = STDIN_FILENO,
+                .events = POLLIN,
+        };
+
+        return poll(&pfd, 1, timeout_ms) > 0 && (pfd.revents & POLLIN);
+}
+
 static void
 completion_draw(ww                *ed,
                 const char        *label,
@@ -174,6 +189,7 @@ minibuffer_input(ww         *ed,
 {
         completion_state st;
         size_t           cx;
+        fuzzy_ctx        fz;
 
         st.selected_idx = 0;
         st.offset       = 0;
@@ -187,26 +203,37 @@ minibuffer_input(ww         *ed,
         }
 
 
+        fuzzy_init(&fz, items, MAX_COMPLETIONS_REQUEST);
+
         while (1) {
                 char ch;
                 input_type ty;
+                cstr_ar matches;
+                size_t total_matches;
+                int done;
+
+                fuzzy_begin(&fz, str_cstr(&st.input));
 
-                cstr_ar matches =
-                        fuzzy_find(items, str_cstr(&st.input));
+                // Draw partial matches while the workers run, a key press
+                // stops waiting for them.
+                do {
+                        done    = fuzzy_collect(&fz);
+                        matches = fz.top;
 
-                size_t total_matches = matches.len;
-                if (total_matches > MAX_COMPLETIONS_REQUEST)
-                        total_matches = MAX_COMPLETIONS_REQUEST;
+                        total_matches = matches.len;
+                        if (total_matches > MAX_COMPLETIONS_REQUEST)
+                                total_matches = MAX_COMPLETIONS_REQUEST;
 
-                completion_draw(ed,
-                                label,
-                                &st,
-                                matches.data,
-                                total_matches);
+                        completion_draw(ed,
+                                        label,
+                                        &st,
+                                        matches.data,
+                                        total_matches);
 
-                gotoxy((unsigned)(cx + (label?strlen(label):0) + strlen(" [ ")),
-                       (unsigned)glconf.term.h);
-                fflush(stdout);
+                        gotoxy((unsigned)(cx + (label?strlen(label):0) + strlen(" [ ")),
+                               (unsigned)glconf.term.h);
+                        fflush(stdout);
+                } while (!done && !input_pending(MINIBUFFER_FRAME_MS));
 
                 ty = get_input(&ch);
 
@@ -220,7 +247,7 @@ minibuffer_input(ww         *ed,
                                 else
                                         res = strdup(str_cstr(&st.input));
 
-                                array_free(matches);
+                                fuzzy_free(&fz);
                                 str_destroy(&st.input);
                                 return res;
                         }
@@ -270,7 +297,7 @@ minibuffer_input(ww         *ed,
                                     st.selected_idx > 0)
                                         st.selected_idx--;
                         } else if (ch == CTRL_G) {
-                                array_free(matches);
+                                fuzzy_free(&fz);
                                 str_destroy(&st.input);
                                 return NULL;
                         } else if (ch == CTRL_B && cx > 0) {
@@ -286,12 +313,14 @@ minibuffer_input(ww         *ed,
                         } else if (ch == CTRL_K) {
                                 str_cut(&st.input, cx);
                         } else if (ch == CTRL_Y) {
-                                if (g_cpy_buf.len > 0) {
-                                        char cpy[1024] = {0};
-                                        memcpy(cpy, g_cpy_buf.data, g_cpy_buf.len);
-                                        str_concat(&st.input, g_cpy_buf.data);
+                                const kill_entry *e = killring_current();
 
-                                        cx += g_cpy_buf.len;
+                                if (e) {
+                                        for (size_t i = 0; i < killring_runs(e); ++i) {
+                                                sv run = killring_run(e, i);
+                                                str_insert_n(&st.input, cx, run.s, run.len);
+                                                cx += run.len;
+                                        }
 
                                         st.selected_idx = 0;
                                         st.offset       = 0;
@@ -301,7 +330,5 @@ minibuffer_input(ww         *ed,
                 default:
                         break;
                 }
-
-                array_free(matches);
         }
 }
@@ -86,6 +86,9 @@ parse_rc(void)
         qcl_value *dumb_indent      = qcl_value_get(&config, "dumb-indent");
         qcl_value *artwork          = qcl_value_get(&config, "artwork");
         qcl_value *no_auto_bracket  = qcl_value_get(&config, "no-auto-bracket");
+        qcl_value *compile_max      = qcl_value_get(&config, "compile-max-lines");
+        qcl_value *buffer_memory    = qcl_value_get(&config, "buffer-memory");
+        qcl_value *error_patterns   = qcl_value_get(&config, "error-patterns");
 #ifdef WITH_LLM
         qcl_value *llm_model        = qcl_value_get(&config, "llm-model");
         qcl_value *llm_think        = qcl_value_get(&config, "llm-think");
@@ -158,6 +161,36 @@ parse_rc(void)
                 else if (((qcl_value_bool *)no_auto_bracket)->b)
                         glconf.flags |= FK_NOAUTOBRACKET;
         }
+        if (compile_max) {
+                if (compile_max->kind != QCL_VALUE_KIND_STRING) {
+                        printf("wwrc error: compile-max-lines is expected to be a string\n");
+                        ok = 0;
+                } else if (!cstr_isdigit(((qcl_value_string *)compile_max)->s)) {
+                        ok = 0;
+                        printf("wwrc error: compile-max-lines must be a valid stringified integer\n");
+                }
+                else
+                        glconf.runtime.compile_max_lines = (size_t)atol(((qcl_value_string *)compile_max)->s);
+        }
+        if (buffer_memory) {
+                if (buffer_memory->kind != QCL_VALUE_KIND_STRING) {
+                        printf("wwrc error: buffer-memory is expected to be a string\n");
+                        ok = 0;
+                } else if (!cstr_isdigit(((qcl_value_string *)buffer_memory)->s)) {
+                        ok = 0;
+                        printf("wwrc error: buffer-memory must be a valid stringified integer\n");
+                }
+                else
+                        glconf.runtime.buffer_memory = (size_t)atol(((qcl_value_string *)buffer_memory)->s)*1024*1024;
+        }
+        if (error_patterns) {
+                if (error_patterns->kind == QCL_VALUE_KIND_BOOL) {
+                        printf("wwrc error: error-patterns is expected to be a string or a list of strings\n");
+                        ok = 0;
+                }
+                else
+                        glconf.runtime.error_patterns = qcl_value_flatten(&config, "error-patterns");
+        }
 #ifdef WITH_LLM
         if (llm_model) {
                 if (llm_model->kind != QCL_VALUE_KIND_STRING) {
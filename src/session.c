@@ -0,0 +1,256 @@
+/*
+ * ww: a simple editor
+ * Copyright (C) 2026 malloc-nbytes
+ * Contact: zdhdev@yahoo.com
+
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "session.h"
+#include "buffer.h"
+#include "glconf.h"
+#include "hash.h"
+#include "io.h"
+#include "config.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#if HAVE_PATH_MAX
+#include <limits.h>
+#else
+#define PATH_MAX 4096
+#endif
+
+#define SESSION_MAGIC "ww-session 1"
+
+// Monitors past this are not restored.
+#define SESSION_MONITORS 64
+
+// One session per directory, named after its path.
+static int
+session_path(char *buf)
+{
+        const char *xdg;
+        const char *home;
+        char       *cwd;
+
+        if (!(cwd = get_realpath(".")))
+                return 0;
+
+        if ((xdg = getenv("XDG_CACHE_HOME")) && xdg[0] == '/')
+                snprintf(buf, PATH_MAX, "%s/ww/sessions/%08x", xdg, hash_cstr(cwd));
+        else if ((home = gethome()))
+                snprintf(buf, PATH_MAX, "%s/.cache/ww/sessions/%08x", home, hash_cstr(cwd));
+        else
+                buf[0] = 0;
+
+        free(cwd);
+        return buf[0] != 0;
+}
+
+// Where a monitor was in its buffer.
+typedef struct {
+        buffer   *b;
+        size_t    al;
+        unsigned  cx;
+        size_t    voff;
+        size_t    hoff;
+} session_mon;
+
+ARRAY_DEFINE(session_mon, session_mon_ar);
+
+static void
+write_view(FILE              *fp,
+           int                slot,
+           const buffer_view *v)
+{
+        fprintf(fp, "%d %zu %u %zu %zu %s\n", slot,
+                v->al, v->cx, v->voff, v->hoff, v->buf->path.chars);
+}
+
+static void
+read_view(buffer_view       *v,
+          const session_mon *m)
+{
+        v->al       = m->al;
+        v->cy       = (unsigned)m->al;
+        v->cx       = m->cx;
+        v->wish_col = m->cx;
+        v->voff     = m->voff;
+        v->hoff     = m->hoff;
+}
+
+// Format, most recently used first:
+//   ww-session 1
+//   am <active monitor>
+//   layout <how the monitors are tiled, see layout_spec>
+//   <monitor or -1> <line> <column> <vscroll> <hscroll> <path>
+// A buffer on several monitors has a line for each.
+void
+session_save(const ww *ed)
+{
+        char  path[PATH_MAX];
+        char  tmp[PATH_MAX + 16];
+        char *slash;
+        FILE *fp;
+
+        if (!session_path(path))
+                return;
+
+        strcpy(tmp, path);
+        for (slash = strchr(tmp+1, '/'); slash; slash = strchr(slash+1, '/')) {
+                *slash = 0;
+                if (mkdir(tmp, 0755) != 0 && errno != EEXIST)
+                        return;
+                *slash = '/';
+        }
+
+        snprintf(tmp, sizeof(tmp), "%s.%d", path, (int)getpid());
+
+        if (!(fp = fopen(tmp, "w")))
+                return;
+
+        fprintf(fp, SESSION_MAGIC "\n");
+        fprintf(fp, "am %zu\n", ed->am);
+        fprintf(fp, "layout ");
+        layout_spec(ed->root, fp);
+        fprintf(fp, "\n");
+
+        for (const buffer *b = ed->bufs.mru; b; b = b->mru_next) {
+                if (b->builtin || !file_exists(b->path.chars) || is_dir(b->path.chars))
+                        continue;
+
+                int shown = 0;
+
+                for (size_t i = 0; i < ed->panes.len; ++i) {
+                        if (ww_monitor(ed, i) == b) {
+                                write_view(fp, (int)i, ed->panes.data[i]->view);
+                                shown = 1;
+                        }
+                }
+
+                if (!shown)
+                        write_view(fp, -1, b->v);
+        }
+
+        if (fclose(fp) != 0 || rename(tmp, path) != 0)
+                unlink(tmp);
+}
+
+// Buffers on a monitor are read right away, the rest stay evicted
+// until they are first shown. Returns 0 if nothing was restored.
+int
+session_restore(ww *ed)
+{
+        char            path[PATH_MAX];
+        char           *ln;
+        size_t          cap;
+        ssize_t         n;
+        FILE           *fp;
+        session_mon_ar  mon   = array_empty(session_mon_ar);
+        layout         *shape = NULL;
+        size_t          am    = 0;
+        int             full  = 1;
+
+        if (!session_path(path) || !(fp = fopen(path, "r")))
+                return 0;
+
+        ln  = NULL;
+        cap = 0;
+
+        if ((n = getline(&ln, &cap, fp)) <= 0 || strncmp(ln, SESSION_MAGIC "\n", (size_t)n))
+                goto done;
+
+        if (getline(&ln, &cap, fp) <= 0 || sscanf(ln, "am %zu", &am) != 1)
+                goto done;
+
+        while ((n = getline(&ln, &cap, fp)) > 0) {
+                int          slot;
+                session_mon  m;
+                int          off;
+
+                if (ln[n-1] == '\n')
+                        ln[n-1] = 0;
+
+                if (!strncmp(ln, "layout ", 7)) {
+                        if (!shape)
+                                shape = layout_from_spec(ln+7);
+                        continue;
+                }
+
+                if (sscanf(ln, "%d %zu %u %zu %zu %n", &slot, &m.al, &m.cx, &m.voff, &m.hoff, &off) != 5)
+                        continue;
+
+                if (!file_exists(ln+off) || is_dir(ln+off))
+                        continue;
+
+                // Later lines of a buffer are other monitors showing it.
+                if (!(m.b = bufreg_by_path(&ed->bufs, ln+off))) {
+                        m.b = buffer_load_deferred(str_from(get_basename(ln+off)), str_from(ln+off),
+                                                   (unsigned)glconf.term.w, (unsigned)glconf.term.h,
+                                                   0, 0, ed);
+                        read_view(m.b->v, &m);
+                        ww_add_buffer(ed, m.b);
+                }
+
+                if (slot >= 0 && slot < SESSION_MONITORS) {
+                        while (mon.len <= (size_t)slot)
+                                array_append(mon, (session_mon) {0});
+                        mon.data[slot] = m;
+                }
+        }
+
+ done:
+        free(ln);
+        fclose(fp);
+
+        if (!ed->bufs.len) {
+                layout_free(shape);
+                array_free(mon);
+                return 0;
+        }
+
+        ww_set_layout(ed, shape ? shape : layout_pane());
+
+        for (size_t i = 0; i < ed->panes.len; ++i)
+                full &= i < mon.len && mon.data[i].b != NULL;
+
+        // A layout missing any of its monitors falls back to the first
+        // one on its own.
+        if (!full) {
+                session_mon first = mon.len && mon.data[0].b
+                        ? mon.data[0] : (session_mon) {.b = ed->bufs.mru};
+
+                ww_clear_monitors(ed);
+                array_clear(mon);
+                array_append(mon, first);
+        }
+
+        for (size_t i = 0; i < ed->panes.len; ++i) {
+                buffer *b = ww_show(ed, i, mon.data[i].b);
+
+                if (b->v != &b->home)
+                        read_view(b->v, &mon.data[i]);
+                buffer_ensure_loaded(b);
+        }
+
+        ed->am = am < ed->panes.len ? am : 0;
+        array_free(mon);
+
+        return 1;
+}
@@ -0,0 +1,271 @@
+/*
+ * ww: a simple editor
+ * Copyright (C) 2026 malloc-nbytes
+ * Contact: zdhdev@yahoo.com
+
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "slab.h"
+#include "mem.h"
+#include "error.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#define SLAB_CLASSES (SLAB_MAX / SLAB_ALIGN)
+#define SLAB_BIG     ((uint32_t)-1)
+#define SLAB_CHUNK   (64*SLAB_SIZE) // mapped at a time
+
+typedef struct slab {
+        slab_pool   *owner;
+        struct slab *prev;
+        struct slab *next;
+        uint32_t     cls;  // size class, SLAB_BIG for a block holding one object
+        uint32_t     size; // bytes per object
+} slab;
+
+#define SLAB_HDR (((sizeof(slab) + SLAB_ALIGN - 1) / SLAB_ALIGN) * SLAB_ALIGN)
+
+struct slab_pool {
+        void  *free[SLAB_CLASSES]; // freed objects, linked through their first word
+        char  *bump[SLAB_CLASSES]; // unused tail of the newest slab of each class
+        char  *end[SLAB_CLASSES];
+        slab  *slabs;
+        size_t  bytes;
+        size_t *total;             // also counts `bytes', NULL if none
+};
+
+// Slabs no pool is using, shared by all pools. Their pages are given
+// back to the kernel but the address space is kept.
+static slab *g_spare = NULL;
+static size_t g_page  = 0;
+
+static slab *
+slab_of(const void *obj)
+{
+        return (slab *)((uintptr_t)obj & ~(uintptr_t)(SLAB_SIZE - 1));
+}
+
+static void
+count(slab_pool *p,
+      size_t     n,
+      int        gone)
+{
+        p->bytes = gone ? p->bytes - n : p->bytes + n;
+        if (p->total)
+                *p->total = gone ? *p->total - n : *p->total + n;
+}
+
+// Map a chunk and cut it into slabs. mmap only promises page alignment,
+// so map one slab more than needed and trim both ends.
+static void
+slab_refill(void)
+{
+        char      *mem;
+        uintptr_t  start;
+
+        mem = (char *)mmap(NULL, SLAB_CHUNK + SLAB_SIZE, PROT_READ | PROT_WRITE,
+                           MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+        if (mem == MAP_FAILED)
+                fatal("could not map %d bytes of slabs", SLAB_CHUNK);
+
+        if (!g_page)
+                g_page = (size_t)sysconf(_SC_PAGESIZE);
+
+        start = ((uintptr_t)mem + SLAB_SIZE - 1) & ~(uintptr_t)(SLAB_SIZE - 1);
+
+        if (start > (uintptr_t)mem)
+                (void)munmap(mem, start - (uintptr_t)mem);
+        (void)munmap((char *)start + SLAB_CHUNK,
+                     (size_t)((uintptr_t)mem + SLAB_SIZE - start));
+
+        for (size_t off = SLAB_CHUNK; off > 0; off -= SLAB_SIZE) {
+                slab *s = (slab *)(start + off - SLAB_SIZE);
+                s->next = g_spare;
+                g_spare = s;
+        }
+}
+
+// Small slabs come from the spare list, a big object gets a block of
+// its own from malloc.
+static slab *
+slab_new(slab_pool *p,
+         size_t     sz,
+         uint32_t   cls,
+         uint32_t   size)
+{
+        void *mem;
+        slab *s;
+
+        if (cls != SLAB_BIG) {
+                if (!g_spare)
+                        slab_refill();
+                mem     = g_spare;
+                g_spare = g_spare->next;
+        } else if (posix_memalign(&mem, SLAB_SIZE, sz) != 0) {
+                fatal("could not alloc a %zu byte slab", sz);
+        }
+
+        s        = (slab *)mem;
+        s->owner = p;
+        s->prev  = NULL;
+        s->next  = p->slabs;
+        s->cls   = cls;
+        s->size  = size;
+
+        if (p->slabs)
+                p->slabs->prev = s;
+        p->slabs = s;
+
+        count(p, cls == SLAB_BIG ? sz : SLAB_SIZE, 0);
+
+        return s;
+}
+
+slab_pool *
+slab_pool_create(void)
+{
+        slab_pool *p = (slab_pool *)alloc(sizeof(slab_pool));
+
+        memset(p, 0, sizeof(*p));
+
+        return p;
+}
+
+// Drop every object at once. Anything still pointing into the pool is
+// left dangling.
+void
+slab_pool_reset(slab_pool *p)
+{
+        while (p->slabs) {
+                slab *s = p->slabs;
+
+                p->slabs = s->next;
+
+                if (s->cls == SLAB_BIG) {
+                        free(s);
+                        continue;
+                }
+
+                // Keep the page holding the link.
+                if (g_page < SLAB_SIZE)
+                        (void)madvise((char *)s + g_page, SLAB_SIZE - g_page, MADV_DONTNEED);
+                s->next = g_spare;
+                g_spare = s;
+        }
+
+        count(p, p->bytes, 1);
+        memset(p->free, 0, sizeof(p->free));
+        memset(p->bump, 0, sizeof(p->bump));
+        memset(p->end, 0, sizeof(p->end));
+}
+
+void
+slab_pool_destroy(slab_pool *p)
+{
+        if (!p)
+                return;
+
+        slab_pool_reset(p);
+        free(p);
+}
+
+void *
+slab_alloc(slab_pool *p,
+           size_t     n)
+{
+        size_t  cls;
+        void   *obj;
+
+        n = n ? (n + SLAB_ALIGN - 1) & ~(size_t)(SLAB_ALIGN - 1) : SLAB_ALIGN;
+
+        if (n > SLAB_MAX)
+                return (char *)slab_new(p, SLAB_HDR + n, SLAB_BIG, (uint32_t)n) + SLAB_HDR;
+
+        cls = n/SLAB_ALIGN - 1;
+
+        if ((obj = p->free[cls])) {
+                p->free[cls] = *(void **)obj;
+                return obj;
+        }
+
+        if (!p->bump[cls] || p->bump[cls] + n > p->end[cls]) {
+                slab *s = slab_new(p, SLAB_SIZE, (uint32_t)cls, (uint32_t)n);
+                p->bump[cls] = (char *)s + SLAB_HDR;
+                p->end[cls]  = (char *)s + SLAB_SIZE;
+        }
+
+        obj           = p->bump[cls];
+        p->bump[cls] += n;
+
+        return obj;
+}
+
+void
+slab_free(void *obj)
+{
+        slab      *s;
+        slab_pool *p;
+
+        if (!obj)
+                return;
+
+        s = slab_of(obj);
+        p = s->owner;
+
+        if (s->cls != SLAB_BIG) {
+                *(void **)obj  = p->free[s->cls];
+                p->free[s->cls] = obj;
+                return;
+        }
+
+        if (s->prev)
+                s->prev->next = s->next;
+        else
+                p->slabs = s->next;
+        if (s->next)
+                s->next->prev = s->prev;
+
+        count(p, SLAB_HDR + s->size, 1);
+        free(s);
+}
+
+slab_pool *
+slab_owner(const void *obj)
+{
+        return slab_of(obj)->owner;
+}
+
+size_t
+slab_pool_bytes(const slab_pool *p)
+{
+        return p->bytes;
+}
+
+// Moves what the pool holds from its old total, if any, to `total'.
+void
+slab_pool_count_into(slab_pool *p,
+                     size_t    *total)
+{
+        if (p->total)
+                *p->total -= p->bytes;
+        p->total = total;
+        if (p->total)
+                *p->total += p->bytes;
+}
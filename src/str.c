@@ -18,6 +18,7 @@
  */
 
 #include "str.h"
+#include "colidx.h"
 
 #include <assert.h>
 #include <stdlib.h>
@@ -25,14 +26,181 @@
 #include <stdarg.h>
 #include <stdio.h>
 
+// Storage placed right behind the str itself (see line) belongs to the
+// enclosing object and is never realloc'd or freed.
+int
+str_is_inline(const str *s)
+{
+        return s->chars == (const char *)(s + 1);
+}
+
+// Make room for `len' bytes of text plus the terminating NUL in a
+// single step, at least doubling so repeated appends stay amortized.
+static void
+grow(str *s, size_t len)
+{
+        if (len < s->cap)
+                return;
+
+        size_t cap = s->cap ? s->cap*2 : 2;
+        if (cap < len + 1)
+                cap = len + 1;
+
+        if (str_is_inline(s)) {
+                char *p = (char *)malloc(cap);
+                memcpy(p, s->chars, s->len + 1);
+                s->chars = p;
+        } else {
+                int fresh = s->chars == NULL;
+                s->chars = (char *)realloc(s->chars, cap);
+                if (fresh)
+                        s->chars[0] = 0;
+        }
+
+        s->cap = cap;
+}
+
+// At most one str has a gap open, the line being typed in. Its text is
+// chars[0, at) followed by chars[at+len, s->len+len), so edits at the
+// gap cost no more than the bytes they add or remove. Anything else
+// that touches the str closes the gap first.
+static _Thread_local struct {
+        str    *s;
+        size_t  at;
+        size_t  len;
+} g_gap;
+
+// The gap is at least this wide, and an eighth of the text so that
+// widening it again stays amortized on long lines.
+#define GAP_MIN 64
+
+void
+str_gap_close(void)
+{
+        str *s = g_gap.s;
+
+        if (!s)
+                return;
+
+        memmove(s->chars + g_gap.at,
+                s->chars + g_gap.at + g_gap.len,
+                s->len - g_gap.at + 1);
+
+        g_gap.s = NULL;
+}
+
+static void
+settle(const str *s)
+{
+        if (s == g_gap.s)
+                str_gap_close();
+}
+
+static void
+gap_move(size_t at)
+{
+        str *s = g_gap.s;
+
+        if (at < g_gap.at)
+                memmove(s->chars + at + g_gap.len,
+                        s->chars + at,
+                        g_gap.at - at);
+        else if (at > g_gap.at)
+                memmove(s->chars + g_gap.at,
+                        s->chars + g_gap.at + g_gap.len,
+                        at - g_gap.at);
+
+        g_gap.at = at;
+}
+
+// Make the gap at least `n' bytes wide.
 static void
-try_resize(str *s)
+gap_widen(size_t n)
+{
+        str    *s    = g_gap.s;
+        size_t  want = s->len/8 > GAP_MIN ? s->len/8 : GAP_MIN;
+        size_t  need;
+
+        if (want < n)
+                want = n;
+
+        need = s->len + want + 1;
+
+        if (need > s->cap) {
+                if (str_is_inline(s)) {
+                        char *p = (char *)malloc(need);
+                        memcpy(p, s->chars, s->len + g_gap.len + 1);
+                        s->chars = p;
+                } else {
+                        s->chars = (char *)realloc(s->chars, need);
+                }
+                s->cap = need;
+        }
+
+        memmove(s->chars + g_gap.at + want,
+                s->chars + g_gap.at + g_gap.len,
+                s->len - g_gap.at + 1);
+
+        g_gap.len = want;
+}
+
+// Open the gap of `s' at `at', or move it there, closing the gap of
+// any other str.
+void
+str_gap_at(str *s, size_t at)
 {
-        if (s->len >= s->cap) {
-                s->cap = s->cap ? s->cap*2 : 2;
-                s->chars = (char *)realloc(s->chars, s->cap);
-                memset(s->chars + s->len+1, 0, s->cap - s->len);
+        if (at > s->len)
+                at = s->len;
+
+        if (g_gap.s == s) {
+                gap_move(at);
+                return;
+        }
+
+        str_gap_close();
+
+        g_gap.s   = s;
+        g_gap.at  = at;
+        g_gap.len = 0;
+        gap_widen(1);
+}
+
+int
+str_gapped(const str *s)
+{
+        return s == g_gap.s;
+}
+
+// The text of `s' from `i' up to the gap or the end lies at *p.
+size_t
+str_run(const str   *s,
+        size_t       i,
+        const char **p)
+{
+        if (s != g_gap.s) {
+                *p = s->chars + i;
+                return s->len - i;
+        }
+
+        if (i < g_gap.at) {
+                *p = s->chars + i;
+                return g_gap.at - i;
         }
+
+        *p = s->chars + i + g_gap.len;
+        return s->len - i;
+}
+
+// A column index follows the edits of long strings, see colidx.h.
+static void
+edited(const str *s,
+       size_t     old,
+       size_t     at,
+       size_t     removed,
+       size_t     inserted)
+{
+        if (old >= COLIDX_MIN)
+                colidx_edit(s, at, removed, inserted);
 }
 
 str
@@ -55,17 +223,30 @@ str_from(const char *chars)
         return s;
 }
 
-inline const char *
-str_cstr(const str *s)
+// Closes the gap of `s', if it has one, so `chars' is one piece.
+const char *
+str_cstr(str *s)
 {
+        settle(s);
         return s->chars;
 }
 
 void
 str_append(str *s, char c)
 {
-        try_resize(s);
+        settle(s);
+        grow(s, s->len + 1);
         s->chars[s->len++] = c;
+        s->chars[s->len]   = 0;
+        edited(s, s->len - 1, s->len - 1, 0, 1);
+}
+
+void
+str_append_n(str        *s,
+             const char *chars,
+             size_t      n)
+{
+        str_insert_n(s, s->len, chars, n);
 }
 
 void
@@ -74,22 +255,28 @@ str_concat(str *s, const char *chars)
         if (!chars || !*chars)
                 return;
 
-        for (size_t i = 0; chars[i]; ++i)
-                str_append(s, chars[i]);
+        str_append_n(s, chars, strlen(chars));
+}
+
+void
+str_assign(str        *s,
+           const char *chars,
+           size_t      n)
+{
+        str_cut(s, 0);
+        str_append_n(s, chars, n);
 }
 
 void
 str_clear(str *s)
 {
-        memset(s->chars, 0, s->cap);
-        s->len = 0;
+        str_cut(s, 0);
 }
 
 void
 str_overwrite(str *s, const char *repl)
 {
-        str_clear(s);
-        str_concat(s, repl);
+        str_assign(s, repl ? repl : "", repl ? strlen(repl) : 0);
 }
 
 inline size_t
@@ -101,7 +288,11 @@ str_len(const str *s)
 void
 str_destroy(str *s)
 {
-        if (s->chars)
+        if (s == g_gap.s)
+                g_gap.s = NULL;
+        if (s->len >= COLIDX_MIN)
+                colidx_drop(s);
+        if (s->chars && !str_is_inline(s))
                 free(s->chars);
         s->chars = NULL;
         s->len   = 0;
@@ -112,43 +303,96 @@ void
 str_insert(str    *s,
            size_t  i,
            char    ch)
+{
+        str_insert_n(s, i, &ch, 1);
+}
+
+// Insert `n' bytes at `i' (clamped to the end) with at most one
+// reallocation and one move of the tail. `chars' must not point
+// into `s'.
+void
+str_insert_n(str        *s,
+             size_t      i,
+             const char *chars,
+             size_t      n)
 {
         if (i > s->len)
                 i = s->len;
 
-        try_resize(s);
+        if (s == g_gap.s) {
+                gap_move(i);
+                if (g_gap.len < n)
+                        gap_widen(n);
+                if (n)
+                        memcpy(s->chars+i, chars, n);
+                g_gap.at  += n;
+                g_gap.len -= n;
+                s->len    += n;
+                edited(s, s->len - n, i, 0, n);
+                return;
+        }
+
+        grow(s, s->len + n);
 
-        memmove(s->chars+i+1,
+        memmove(s->chars+i+n,
                 s->chars+i,
                 s->len-i+1);
+        if (n)
+                memcpy(s->chars+i, chars, n);
 
-        s->chars[i] = ch;
-
-        s->len++;
+        s->len += n;
+        edited(s, s->len - n, i, 0, n);
 }
 
+// Remove up to `n' bytes starting at `i' with a single move.
 void
-str_cut(str *s, size_t i)
+str_erase_range(str    *s,
+                size_t  i,
+                size_t  n)
 {
-        if (i >= s->len)
+        if (i >= s->len || n == 0)
                 return;
 
-        memset(s->chars+i, 0, s->len-i);
-        s->len = i;
+        if (n > s->len - i)
+                n = s->len - i;
+
+        if (s == g_gap.s) {
+                if (i + n == g_gap.at)
+                        g_gap.at = i;
+                else
+                        gap_move(i);
+                g_gap.len += n;
+                s->len    -= n;
+                edited(s, s->len + n, i, n, 0);
+                return;
+        }
+
+        memmove(s->chars+i,
+                s->chars+i+n,
+                s->len-(i+n)+1);
+
+        s->len -= n;
+        edited(s, s->len + n, i, n, 0);
 }
 
 void
-str_rm(str *s, size_t i)
+str_cut(str *s, size_t i)
 {
         if (i >= s->len)
                 return;
 
-        memmove(s->chars+i,
-                s->chars+i+1,
-                s->len-i);
+        size_t old = s->len;
+
+        settle(s);
+        s->chars[i] = 0;
+        s->len      = i;
+        edited(s, old, i, old - i, 0);
+}
 
-        s->chars[s->len-1] = 0;
-        --s->len;
+void
+str_rm(str *s, size_t i)
+{
+        str_erase_range(s, i, 1);
 }
 
 char
@@ -156,6 +400,9 @@ str_at(const str *s, size_t i)
 {
         assert(i < s->len);
 
+        if (s == g_gap.s && i >= g_gap.at)
+                i += g_gap.len;
+
         return s->chars[i];
 }
 
@@ -167,7 +414,7 @@ str_pop(str *s)
         if (s->len <= 0)
                 return 0;
 
-        ch = s->chars[s->len-1];
+        ch = str_at(s, s->len-1);
         str_rm(s, s->len-1);
 
         return ch;
@@ -176,8 +423,13 @@ str_pop(str *s)
 void
 str_trim_before(str *s)
 {
-        while (s->len > 0 && s->chars[0] == ' ')
-                str_rm(s, 0);
+        size_t n = 0;
+
+        settle(s);
+        while (n < s->len && s->chars[n] == ' ')
+                ++n;
+
+        str_erase_range(s, 0, n);
 }
 
 str
@@ -214,31 +466,12 @@ str_from_fmt(const char *fmt, ...)
         return s;
 }
 
-void
-str_remove_range(str *s, size_t start, size_t count)
-{
-      if (count == 0 || start >= s->len)
-          return;
-
-      if (start + count > s->len)
-          count = s->len - start;
-
-      memmove(s->chars + start,
-              s->chars + start + count,
-              s->len - (start + count) + 1); // +1 for null
-
-      s->len -= count;
-
-      if (s->len < s->cap)
-          s->chars[s->len] = 0;
-}
-
 str
 str_dup(str s)
 {
         return (str) {
                 .chars = strdup(s.chars),
                 .len   = s.len,
-                .cap   = s.cap,
+                .cap   = s.len + 1,
         };
 }
@@ -0,0 +1,1114 @@
+/*
+ * ww: a simple editor
+ * Copyright (C) 2026 malloc-nbytes
+ * Contact: zdhdev@yahoo.com
+
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "symindex.h"
+#include "hash.h"
+#include "io.h"
+#include "map.h"
+#include "config.h"
+
+#include <ctype.h>
+#include <errno.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#if HAVE_PATH_MAX
+#include <limits.h>
+#else
+#define PATH_MAX 4096
+#endif
+
+#define SYMINDEX_MAGIC "ww-symbols 1"
+#define SYMINDEX_ARENA_CHUNK (64*1024)
+
+// Files bigger than this are generated or data, not worth scanning.
+#define SYMINDEX_MAX_FILE (8*1024*1024)
+
+static const char *g_kind_names[] = {
+        [SYM_FUNC]  = "function",
+        [SYM_TYPE]  = "type",
+        [SYM_MACRO] = "macro",
+};
+
+typedef struct arena_chunk {
+        struct arena_chunk *next;
+        size_t              len;
+        size_t              cap;
+        char                data[];
+} arena_chunk;
+
+typedef struct {
+        const char *path;
+        long long   mtime;
+        long long   size;
+        unsigned    hash;
+        size_t      sym;  // first symbol in `by_file'
+        size_t      nsym;
+} sfile;
+
+ARRAY_DEFINE(sfile, sfile_ar);
+
+// One complete scan. Tables never change once built, the worker and
+// the main thread each hold a reference to the ones they use.
+typedef struct {
+        arena_chunk *arena;
+        sfile_ar     files;   // sorted by path
+        symbol_ar    by_file; // in the order of `files'
+        symbol_ar    by_name;
+        cstr_ar      labels;  // parallel to `by_name', built on demand
+        int          refs;
+} symtab;
+
+MAP_DEFINE(const char *, size_t, path_map);
+MAP_IMPL(const char *, size_t, path_map);
+
+static struct {
+        char            *root;
+        char             cache_path[PATH_MAX];
+        pthread_mutex_t  lock;
+        pthread_cond_t   cond;
+        pthread_t        thread;
+        int              started;
+        int              scanned;  // the first scan is done
+        int              refresh;  // another scan was asked for
+        symtab          *pending;  // published, not yet picked up
+
+        // owned by the main thread
+        symtab          *cur;
+} g_sym = {
+        .lock = PTHREAD_MUTEX_INITIALIZER,
+        .cond = PTHREAD_COND_INITIALIZER,
+};
+
+static char *
+arena_strndup(symtab     *t,
+              const char *s,
+              size_t      n)
+{
+        arena_chunk *c = t->arena;
+
+        if (!c || c->len + n + 1 > c->cap) {
+                size_t cap = n + 1 > SYMINDEX_ARENA_CHUNK ? n + 1 : SYMINDEX_ARENA_CHUNK;
+                c          = (arena_chunk *)malloc(sizeof(arena_chunk) + cap);
+                c->next    = t->arena;
+                c->len     = 0;
+                c->cap     = cap;
+                t->arena   = c;
+        }
+
+        char *p = c->data + c->len;
+        memcpy(p, s, n);
+        p[n] = 0;
+        c->len += n + 1;
+
+        return p;
+}
+
+static symtab *
+symtab_alloc(void)
+{
+        symtab *t = (symtab *)malloc(sizeof(*t));
+
+        t->arena   = NULL;
+        t->files   = array_empty(sfile_ar);
+        t->by_file = array_empty(symbol_ar);
+        t->by_name = array_empty(symbol_ar);
+        t->labels  = array_empty(cstr_ar);
+        t->refs    = 1;
+
+        return t;
+}
+
+// Called with the lock held.
+static void
+symtab_release(symtab *t)
+{
+        if (!t || --t->refs > 0)
+                return;
+
+        while (t->arena) {
+                arena_chunk *next = t->arena->next;
+                free(t->arena);
+                t->arena = next;
+        }
+
+        for (size_t i = 0; i < t->labels.len; ++i)
+                free(t->labels.data[i]);
+
+        array_free(t->files);
+        array_free(t->by_file);
+        array_free(t->by_name);
+        array_free(t->labels);
+        free(t);
+}
+
+static int
+symbol_cmp(const void *a_,
+           const void *b_)
+{
+        const symbol *a = (const symbol *)a_;
+        const symbol *b = (const symbol *)b_;
+        int           c;
+
+        if ((c = strcmp(a->name, b->name)) != 0)
+                return c;
+        if ((c = strcmp(a->path, b->path)) != 0)
+                return c;
+        return a->line < b->line ? -1 : a->line > b->line;
+}
+
+static int
+sfile_cmp(const void *a_,
+          const void *b_)
+{
+        return strcmp(((const sfile *)a_)->path, ((const sfile *)b_)->path);
+}
+
+static void
+symtab_finish(symtab *t)
+{
+        array_reserve(t->by_name, t->by_file.len);
+        memcpy(t->by_name.data, t->by_file.data, t->by_file.len * sizeof(symbol));
+        t->by_name.len = t->by_file.len;
+        qsort(t->by_name.data, t->by_name.len, sizeof(symbol), symbol_cmp);
+}
+
+///////////////////////////////////////////////
+// Scanners
+///////////////////////////////////////////////
+
+static void
+add_symbol(symtab     *t,
+           const char *path,
+           const char *name,
+           size_t      n,
+           unsigned    line,
+           sym_kind    kind)
+{
+        array_append(t->by_file, ((symbol) {
+                .name = arena_strndup(t, name, n),
+                .path = path,
+                .line = line,
+                .kind = kind,
+        }));
+}
+
+static int
+is_ident_start(char c)
+{
+        return isalpha((unsigned char)c) || c == '_';
+}
+
+static int
+is_ident(char c)
+{
+        return isalnum((unsigned char)c) || c == '_';
+}
+
+static int
+word_is(const char *s,
+        size_t      n,
+        const char *kw)
+{
+        return strlen(kw) == n && !memcmp(s, kw, n);
+}
+
+// May follow the parameter list of a function definition.
+static int
+is_fn_qualifier(const char *s,
+                size_t      n)
+{
+        static const char *kws[] = {
+                "const", "volatile", "noexcept", "override", "final", "throw",
+                "mutable", "__attribute__",
+        };
+
+        for (size_t i = 0; i < sizeof(kws)/sizeof(*kws); ++i)
+                if (word_is(s, n, kws[i]))
+                        return 1;
+        return 0;
+}
+
+// Braces opened by these do not nest the definitions inside them.
+static int
+is_transparent_scope(const char *s,
+                     size_t      n)
+{
+        return word_is(s, n, "namespace") || word_is(s, n, "extern");
+}
+
+static int
+is_keyword(const char *s,
+           size_t      n)
+{
+        static const char *kws[] = {
+                "if", "while", "for", "switch", "return", "sizeof", "do",
+                "else", "case", "__attribute__", "alignof", "_Alignof",
+                "decltype", "typeof", "__typeof__", "defined",
+        };
+
+        for (size_t i = 0; i < sizeof(kws)/sizeof(*kws); ++i)
+                if (word_is(s, n, kws[i]))
+                        return 1;
+        return 0;
+}
+
+// A single pass over C or C++ that tracks just enough to find
+// functions with a body, struct/union/enum/class definitions, typedefs
+// and #defines at file scope.
+static void
+scan_c(symtab     *t,
+       const char *path,
+       const char *src,
+       size_t      len)
+{
+        size_t       i          = 0;
+        unsigned     line       = 1;
+        int          bol        = 1;   // only whitespace so far on this line
+        unsigned     depth      = 0;   // braces that count
+        uint64_t     transparent = 0;  // bit per brace level, 64 deep
+        unsigned     level      = 0;   // all braces
+        int          paren      = 0;
+        const char  *last       = NULL; // last identifier at file scope
+        size_t       last_n     = 0;
+        unsigned     last_line  = 0;
+        int          scope_kw   = 0;   // `namespace'/`extern' seen
+
+        // function candidate: name( ... ) then `{'
+        const char  *fn         = NULL;
+        size_t       fn_n       = 0;
+        unsigned     fn_line    = 0;
+        int          fn_params  = 0;   // its parameter list was closed
+
+        // struct/union/enum/class NAME ... `{'
+        const char  *tag        = NULL;
+        size_t       tag_n      = 0;
+        unsigned     tag_line   = 0;
+        int          tag_kw     = 0;
+
+        // typedef ... NAME;
+        int          td         = 0;
+        unsigned     td_level   = 0;
+        const char  *td_name    = NULL;
+        size_t       td_n       = 0;
+        unsigned     td_line    = 0;
+        int          td_star    = 0;   // just saw `(*'
+
+        while (i < len) {
+                char c = src[i];
+
+                if (c == '\n') {
+                        ++line;
+                        bol = 1;
+                        ++i;
+                        continue;
+                }
+                if (isspace((unsigned char)c)) {
+                        ++i;
+                        continue;
+                }
+
+                // comments
+                if (c == '/' && i+1 < len && src[i+1] == '/') {
+                        while (i < len && src[i] != '\n')
+                                ++i;
+                        continue;
+                }
+                if (c == '/' && i+1 < len && src[i+1] == '*') {
+                        i += 2;
+                        while (i+1 < len && !(src[i] == '*' && src[i+1] == '/')) {
+                                if (src[i] == '\n')
+                                        ++line;
+                                ++i;
+                        }
+                        i += 2;
+                        continue;
+                }
+
+                // preprocessor, only #define matters
+                if (c == '#' && bol) {
+                        size_t j = i+1;
+
+                        while (j < len && (src[j] == ' ' || src[j] == '\t'))
+                                ++j;
+                        if (len - j > 6 && !memcmp(src+j, "define", 6) && !is_ident(src[j+6])) {
+                                j += 6;
+                                while (j < len && (src[j] == ' ' || src[j] == '\t'))
+                                        ++j;
+                                size_t k = j;
+                                while (k < len && is_ident(src[k]))
+                                        ++k;
+                                if (k > j && is_ident_start(src[j]))
+                                        add_symbol(t, path, src+j, k-j, line, SYM_MACRO);
+                        }
+
+                        // to the end of the directive, continuations included
+                        while (i < len && src[i] != '\n') {
+                                if (src[i] == '\\' && i+1 < len && src[i+1] == '\n') {
+                                        ++line;
+                                        ++i;
+                                }
+                                ++i;
+                        }
+                        continue;
+                }
+
+                bol = 0;
+
+                // string and character literals
+                if (c == '"' || c == '\'') {
+                        ++i;
+                        while (i < len && src[i] != c && src[i] != '\n') {
+                                if (src[i] == '\\' && i+1 < len) {
+                                        if (src[i+1] == '\n')
+                                                ++line;
+                                        ++i;
+                                }
+                                ++i;
+                        }
+                        ++i;
+                        continue;
+                }
+
+                if (is_ident_start(c)) {
+                        size_t st = i;
+
+                        while (i < len && is_ident(src[i]))
+                                ++i;
+
+                        const char *w = src + st;
+                        size_t      n = i - st;
+
+                        if (td && level == td_level && paren == 0) {
+                                td_name = w;
+                                td_n    = n;
+                                td_line = line;
+                        } else if (td && td_star) {
+                                td_name = w;
+                                td_n    = n;
+                                td_line = line;
+                        }
+                        td_star = 0;
+
+                        if (depth > 0)
+                                continue;
+
+                        if (paren == 0 && word_is(w, n, "typedef")) {
+                                td       = 1;
+                                td_level = level;
+                                td_name  = NULL;
+                        } else if (paren == 0 && (word_is(w, n, "struct") || word_is(w, n, "union")
+                                                  || word_is(w, n, "enum") || word_is(w, n, "class"))) {
+                                tag_kw = 1;
+                                tag    = NULL;
+                        } else if (tag_kw && !tag && paren == 0) {
+                                tag      = w;
+                                tag_n    = n;
+                                tag_line = line;
+                        }
+
+                        if (is_transparent_scope(w, n))
+                                scope_kw = 1;
+
+                        // A macro call without a semicolon, the name
+                        // starts something else.
+                        if (fn_params && paren == 0 && !is_fn_qualifier(w, n)) {
+                                fn        = NULL;
+                                fn_params = 0;
+                        }
+
+                        if (paren == 0 && !fn_params) {
+                                last      = w;
+                                last_n    = n;
+                                last_line = line;
+                        }
+                        continue;
+                }
+
+                switch (c) {
+                case '(':
+                        if (depth == 0 && paren == 0 && !fn_params && last && !td && !is_keyword(last, last_n)) {
+                                fn      = last;
+                                fn_n    = last_n;
+                                fn_line = last_line;
+                        }
+                        if (td && i+1 < len && src[i+1] == '*')
+                                td_star = 1;
+                        ++paren;
+                        break;
+                case ')':
+                        if (paren > 0 && --paren == 0 && fn)
+                                fn_params = 1;
+                        break;
+                case '{':
+                        if (depth == 0 && paren == 0) {
+                                if (fn && fn_params)
+                                        add_symbol(t, path, fn, fn_n, fn_line, SYM_FUNC);
+                                else if (tag_kw && tag)
+                                        add_symbol(t, path, tag, tag_n, tag_line, SYM_TYPE);
+                        }
+                        if (level < 64 && scope_kw && !(fn && fn_params))
+                                transparent |= (uint64_t)1 << level;
+                        else
+                                ++depth;
+                        ++level;
+                        fn = NULL; fn_params = 0;
+                        tag_kw = 0; tag = NULL;
+                        scope_kw = 0;
+                        last = NULL;
+                        break;
+                case '}':
+                        if (level > 0) {
+                                --level;
+                                if (level < 64 && transparent & ((uint64_t)1 << level))
+                                        transparent &= ~((uint64_t)1 << level);
+                                else if (depth > 0)
+                                        --depth;
+                        }
+                        last = NULL;
+                        break;
+                case ';':
+                        if (td && level == td_level && paren == 0) {
+                                if (td_name)
+                                        add_symbol(t, path, td_name, td_n, td_line, SYM_TYPE);
+                                td = 0;
+                        }
+                        if (paren == 0) {
+                                fn = NULL; fn_params = 0;
+                                tag_kw = 0; tag = NULL;
+                                scope_kw = 0;
+                                last = NULL;
+                        }
+                        break;
+                case '=':
+                case ',':
+                        if (paren == 0 && depth == 0) {
+                                fn = NULL; fn_params = 0;
+                                if (c == '=') {
+                                        tag_kw = 0;
+                                        tag = NULL;
+                                }
+                        }
+                        break;
+                default:
+                        break;
+                }
+
+                ++i;
+        }
+}
+
+// `def' and `class' at the start of a line, at any indentation.
+static void
+scan_python(symtab     *t,
+            const char *path,
+            const char *src,
+            size_t      len)
+{
+        unsigned line   = 1;
+        int      quoted = 0; // inside a triple-quoted string
+
+        for (size_t i = 0; i < len; ++line) {
+                size_t eol = i;
+                size_t j   = i;
+                int    triples = 0;
+
+                while (eol < len && src[eol] != '\n')
+                        ++eol;
+
+                for (size_t k = i; k + 2 < eol + 1 && k + 2 < len; ++k)
+                        if ((src[k] == '"' || src[k] == '\'') && src[k+1] == src[k] && src[k+2] == src[k]) {
+                                ++triples;
+                                k += 2;
+                        }
+
+                while (j < eol && (src[j] == ' ' || src[j] == '\t'))
+                        ++j;
+
+                if (!quoted) {
+                        sym_kind kind = SYM_FUNC;
+                        size_t   kw   = 0;
+
+                        if (eol - j > 10 && !memcmp(src+j, "async def ", 10))
+                                kw = 10;
+                        else if (eol - j > 4 && !memcmp(src+j, "def ", 4))
+                                kw = 4;
+                        else if (eol - j > 6 && !memcmp(src+j, "class ", 6)) {
+                                kw   = 6;
+                                kind = SYM_TYPE;
+                        }
+
+                        if (kw) {
+                                size_t st = j + kw;
+                                size_t k;
+
+                                while (st < eol && src[st] == ' ')
+                                        ++st;
+                                for (k = st; k < eol && is_ident(src[k]); ++k)
+                                        ;
+                                if (k > st && is_ident_start(src[st]))
+                                        add_symbol(t, path, src+st, k-st, line, kind);
+                        }
+                }
+
+                if (triples & 1)
+                        quoted = !quoted;
+
+                i = eol + 1;
+        }
+}
+
+typedef void (*scanner)(symtab *, const char *, const char *, size_t);
+
+static scanner
+scanner_for(const char *path)
+{
+        static const char *c_exts[] = {
+                ".c", ".h", ".cc", ".cpp", ".cxx", ".c++", ".hh", ".hpp", ".hxx", ".h++",
+                ".C", ".H", ".inl", ".ipp", ".tcc",
+        };
+        const char *ext = strrchr(path, '.');
+
+        if (!ext || strchr(ext, '/'))
+                return NULL;
+
+        for (size_t i = 0; i < sizeof(c_exts)/sizeof(*c_exts); ++i)
+                if (!strcmp(ext, c_exts[i]))
+                        return scan_c;
+
+        if (!strcmp(ext, ".py") || !strcmp(ext, ".pyi"))
+                return scan_python;
+
+        return NULL;
+}
+
+///////////////////////////////////////////////
+// On-disk index
+///////////////////////////////////////////////
+
+// SYMINDEX_MAGIC root
+// F mtime size hash nsym path
+// kind line name       (nsym times)
+static symtab *
+cache_load(void)
+{
+        FILE    *fp;
+        char    *ln  = NULL;
+        size_t   cap = 0;
+        ssize_t  n;
+        symtab  *t;
+        size_t   left = 0;
+        sfile   *f    = NULL;
+        int      ok   = 0;
+
+        if (!g_sym.cache_path[0] || !(fp = fopen(g_sym.cache_path, "r")))
+                return NULL;
+
+        t = symtab_alloc();
+
+        if ((n = getline(&ln, &cap, fp)) <= 0)
+                goto done;
+        ln[n-1] = 0;
+        if (strncmp(ln, SYMINDEX_MAGIC " ", sizeof(SYMINDEX_MAGIC))
+            || strcmp(ln + sizeof(SYMINDEX_MAGIC), g_sym.root))
+                goto done;
+
+        while ((n = getline(&ln, &cap, fp)) > 0) {
+                int at;
+
+                if (ln[n-1] != '\n')
+                        goto done;
+                ln[n-1] = 0;
+
+                if (left == 0) {
+                        long long mtime, size;
+                        unsigned  hash;
+                        size_t    nsym;
+
+                        if (sscanf(ln, "F %lld %lld %u %zu %n", &mtime, &size, &hash, &nsym, &at) != 4)
+                                goto done;
+
+                        array_append(t->files, ((sfile) {
+                                .path  = arena_strndup(t, ln+at, strlen(ln+at)),
+                                .mtime = mtime,
+                                .size  = size,
+                                .hash  = hash,
+                                .sym   = t->by_file.len,
+                                .nsym  = nsym,
+                        }));
+                        f    = &t->files.data[t->files.len-1];
+                        left = nsym;
+                } else {
+                        unsigned kind, lnum;
+
+                        if (sscanf(ln, "%u %u %n", &kind, &lnum, &at) != 2 || kind > SYM_MACRO)
+                                goto done;
+
+                        add_symbol(t, f->path, ln+at, strlen(ln+at), lnum, (sym_kind)kind);
+                        --left;
+                }
+        }
+
+        ok = left == 0;
+
+ done:
+        free(ln);
+        fclose(fp);
+
+        if (!ok) {
+                symtab_release(t);
+                return NULL;
+        }
+
+        symtab_finish(t);
+        return t;
+}
+
+static void
+cache_store(const symtab *t)
+{
+        char  tmp[PATH_MAX + 16];
+        char *slash;
+        FILE *fp;
+
+        if (!g_sym.cache_path[0])
+                return;
+
+        strcpy(tmp, g_sym.cache_path);
+        for (slash = strchr(tmp+1, '/'); slash; slash = strchr(slash+1, '/')) {
+                *slash = 0;
+                if (mkdir(tmp, 0755) != 0 && errno != EEXIST)
+                        return;
+                *slash = '/';
+        }
+
+        snprintf(tmp, sizeof(tmp), "%s.%d", g_sym.cache_path, (int)getpid());
+
+        if (!(fp = fopen(tmp, "w")))
+                return;
+
+        fprintf(fp, SYMINDEX_MAGIC " %s\n", g_sym.root);
+        for (size_t i = 0; i < t->files.len; ++i) {
+                const sfile *f = &t->files.data[i];
+
+                fprintf(fp, "F %lld %lld %u %zu %s\n", f->mtime, f->size, f->hash, f->nsym, f->path);
+                for (size_t j = f->sym; j < f->sym + f->nsym; ++j) {
+                        const symbol *s = &t->by_file.data[j];
+                        fprintf(fp, "%u %u %s\n", (unsigned)s->kind, s->line, s->name);
+                }
+        }
+
+        if (fclose(fp) != 0 || rename(tmp, g_sym.cache_path) != 0)
+                unlink(tmp);
+}
+
+///////////////////////////////////////////////
+// Worker
+///////////////////////////////////////////////
+
+typedef struct {
+        cstr_ar sources;
+} walk_ctx;
+
+static int
+collect_source(const char *relpath,
+               int         is_dir,
+               void       *ctx)
+{
+        if (!is_dir && scanner_for(relpath))
+                array_append(((walk_ctx *)ctx)->sources, strdup(relpath));
+        return 1;
+}
+
+static unsigned
+path_hash(const char **s)
+{
+        return hash_cstr(*s);
+}
+
+static int
+path_cmp(const char **a,
+         const char **b)
+{
+        return strcmp(*a, *b);
+}
+
+static int
+cstr_cmp(const void *a,
+         const void *b)
+{
+        return strcmp(*(char *const *)a, *(char *const *)b);
+}
+
+// At most `max' bytes, the file may have changed since it was stat'ed.
+static char *
+read_source(const char *path,
+            size_t      max,
+            size_t     *len)
+{
+        FILE *fp;
+        char *buf;
+
+        if (!(fp = fopen(path, "rb")))
+                return NULL;
+
+        buf  = (char *)malloc(max + 1);
+        *len = fread(buf, 1, max, fp);
+        buf[*len] = 0;
+        fclose(fp);
+
+        return buf;
+}
+
+static void
+copy_file_symbols(symtab       *t,
+                  sfile        *dst,
+                  const symtab *prev,
+                  const sfile  *src)
+{
+        dst->sym  = t->by_file.len;
+        dst->nsym = src->nsym;
+
+        for (size_t i = src->sym; i < src->sym + src->nsym; ++i) {
+                const symbol *s = &prev->by_file.data[i];
+                add_symbol(t, dst->path, s->name, strlen(s->name), s->line, s->kind);
+        }
+}
+
+// Builds a new table, reusing whatever `prev' knows about unchanged
+// files. NULL when nothing changed.
+static symtab *
+scan_all(const symtab *prev)
+{
+        walk_ctx  ctx;
+        path_map  old;
+        symtab   *t;
+        int       changed;
+
+        ctx.sources = array_empty(cstr_ar);
+        walkdir_each(g_sym.root, collect_source, &ctx);
+        qsort(ctx.sources.data, ctx.sources.len, sizeof(char *), cstr_cmp);
+
+        old = path_map_create(path_hash, path_cmp);
+        if (prev)
+                for (size_t i = 0; i < prev->files.len; ++i)
+                        path_map_insert(&old, prev->files.data[i].path, i);
+
+        t       = symtab_alloc();
+        changed = !prev || prev->files.len != ctx.sources.len;
+
+        for (size_t i = 0; i < ctx.sources.len; ++i) {
+                const char  *rel = ctx.sources.data[i];
+                char         full[PATH_MAX];
+                struct stat  st;
+                size_t      *pi;
+                const sfile *was;
+                sfile        f;
+
+                snprintf(full, sizeof(full), "%s/%s", g_sym.root, rel);
+                if (stat(full, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size > SYMINDEX_MAX_FILE) {
+                        changed = 1;
+                        continue;
+                }
+
+                pi  = path_map_get(&old, rel);
+                was = pi ? &prev->files.data[*pi] : NULL;
+
+                f = (sfile) {
+                        .path  = arena_strndup(t, rel, strlen(rel)),
+                        .mtime = (long long)st.st_mtim.tv_sec * 1000000000LL + st.st_mtim.tv_nsec,
+                        .size  = (long long)st.st_size,
+                        .hash  = was ? was->hash : 0,
+                        .sym   = t->by_file.len,
+                        .nsym  = 0,
+                };
+
+                if (was && was->mtime == f.mtime && was->size == f.size) {
+                        copy_file_symbols(t, &f, prev, was);
+                        array_append(t->files, f);
+                        continue;
+                }
+
+                // Touched, but maybe not changed.
+                changed = 1;
+
+                size_t len;
+                char  *src = read_source(full, (size_t)st.st_size, &len);
+                if (!src)
+                        continue;
+
+                f.size = (long long)len;
+                f.hash = hash_bytes(src, len);
+
+                if (was && was->size == f.size && was->hash == f.hash)
+                        copy_file_symbols(t, &f, prev, was);
+                else {
+                        scanner_for(rel)(t, f.path, src, len);
+                        f.nsym = t->by_file.len - f.sym;
+                }
+
+                free(src);
+                array_append(t->files, f);
+        }
+
+        for (size_t i = 0; i < ctx.sources.len; ++i)
+                free(ctx.sources.data[i]);
+        array_free(ctx.sources);
+        path_map_destroy(&old);
+
+        if (!changed) {
+                pthread_mutex_lock(&g_sym.lock);
+                symtab_release(t);
+                pthread_mutex_unlock(&g_sym.lock);
+                return NULL;
+        }
+
+        qsort(t->files.data, t->files.len, sizeof(sfile), sfile_cmp);
+        symtab_finish(t);
+        return t;
+}
+
+static void
+publish(symtab *t)
+{
+        pthread_mutex_lock(&g_sym.lock);
+        symtab_release(g_sym.pending);
+        g_sym.pending = t;
+        ++t->refs;
+        pthread_mutex_unlock(&g_sym.lock);
+}
+
+static void *
+worker(void *arg)
+{
+        (void)arg;
+
+        symtab *prev = cache_load();
+        symtab *next;
+
+        if (prev)
+                publish(prev);
+
+        while (1) {
+                if ((next = scan_all(prev))) {
+                        publish(next);
+                        cache_store(next);
+                        pthread_mutex_lock(&g_sym.lock);
+                        symtab_release(prev);
+                        pthread_mutex_unlock(&g_sym.lock);
+                        prev = next;
+                }
+
+                pthread_mutex_lock(&g_sym.lock);
+                g_sym.scanned = 1;
+                pthread_cond_broadcast(&g_sym.cond);
+                while (!g_sym.refresh)
+                        pthread_cond_wait(&g_sym.cond, &g_sym.lock);
+                g_sym.refresh = 0;
+                pthread_mutex_unlock(&g_sym.lock);
+        }
+
+        return NULL;
+}
+
+void
+symindex_start(const char *root)
+{
+        const char *xdg;
+        const char *home;
+        char       *real;
+
+        if (g_sym.started)
+                return;
+
+        if (!(real = get_realpath(root)))
+                return;
+
+        g_sym.started = 1;
+        g_sym.root    = real;
+
+        // One index per project, named after its path.
+        if ((xdg = getenv("XDG_CACHE_HOME")) && xdg[0] == '/')
+                snprintf(g_sym.cache_path, sizeof(g_sym.cache_path), "%s/ww/symbols/%08x",
+                         xdg, hash_cstr(real));
+        else if ((home = gethome()))
+                snprintf(g_sym.cache_path, sizeof(g_sym.cache_path), "%s/.cache/ww/symbols/%08x",
+                         home, hash_cstr(real));
+
+        if (pthread_create(&g_sym.thread, NULL, worker, NULL) != 0) {
+                // no thread, one scan inline and no updates
+                symtab *t = scan_all(NULL);
+                if (t)
+                        publish(t);
+                g_sym.scanned = 1;
+                return;
+        }
+
+        pthread_detach(g_sym.thread);
+}
+
+void
+symindex_refresh(void)
+{
+        if (!g_sym.started)
+                return;
+
+        pthread_mutex_lock(&g_sym.lock);
+        g_sym.refresh = 1;
+        pthread_cond_broadcast(&g_sym.cond);
+        pthread_mutex_unlock(&g_sym.lock);
+}
+
+int
+symindex_ready(void)
+{
+        int ready;
+
+        if (!g_sym.started)
+                return 0;
+
+        pthread_mutex_lock(&g_sym.lock);
+        ready = g_sym.scanned;
+        pthread_mutex_unlock(&g_sym.lock);
+
+        return ready;
+}
+
+// The newest table, NULL if there is none yet.
+static symtab *
+current(void)
+{
+        if (!g_sym.started)
+                return NULL;
+
+        pthread_mutex_lock(&g_sym.lock);
+
+        if (g_sym.pending) {
+                symtab_release(g_sym.cur);
+                g_sym.cur     = g_sym.pending;
+                g_sym.pending = NULL;
+        }
+
+        pthread_mutex_unlock(&g_sym.lock);
+
+        return g_sym.cur;
+}
+
+// First definition whose name is not less than `name'.
+static size_t
+lower_bound(const symtab *t,
+            const char   *name)
+{
+        size_t lo = 0;
+        size_t hi = t->by_name.len;
+
+        while (lo < hi) {
+                size_t mid = lo + (hi - lo)/2;
+                if (strcmp(t->by_name.data[mid].name, name) < 0)
+                        lo = mid + 1;
+                else
+                        hi = mid;
+        }
+
+        return lo;
+}
+
+const symbol *
+symindex_lookup(const char *name,
+                size_t     *n)
+{
+        symtab *t = current();
+        size_t  lo, hi;
+
+        *n = 0;
+        if (!t)
+                return NULL;
+
+        lo = lower_bound(t, name);
+        for (hi = lo; hi < t->by_name.len && !strcmp(t->by_name.data[hi].name, name); ++hi)
+                ;
+
+        *n = hi - lo;
+        return *n ? &t->by_name.data[lo] : NULL;
+}
+
+char *
+symindex_label(const symbol *s)
+{
+        size_t  n = strlen(s->name) + strlen(s->path) + 32;
+        char   *l = (char *)malloc(n);
+
+        snprintf(l, n, "%s [%s] %s:%u", s->name, g_kind_names[s->kind], s->path, s->line);
+
+        return l;
+}
+
+static void
+build_labels(symtab *t)
+{
+        if (t->labels.len != t->by_name.len) {
+                array_reserve(t->labels, t->by_name.len);
+                for (size_t i = t->labels.len; i < t->by_name.len; ++i)
+                        array_append(t->labels, symindex_label(&t->by_name.data[i]));
+        }
+}
+
+cstr_ar
+symindex_labels(void)
+{
+        symtab *t = current();
+
+        if (!t)
+                return array_empty(cstr_ar);
+
+        build_labels(t);
+        return t->labels;
+}
+
+// This stays on the table the caller got its labels from, picking up
+// a newer one would free them.
+const symbol *
+symindex_from_label(const char *label)
+{
+        symtab       *t = g_sym.cur;
+        const symbol *s = NULL;
+        char         *name;
+        size_t        lo;
+
+        if (!t)
+                return NULL;
+
+        build_labels(t);
+
+        name = strndup(label, strcspn(label, " "));
+        lo   = lower_bound(t, name);
+
+        for (; lo < t->by_name.len && !strcmp(t->by_name.data[lo].name, name); ++lo) {
+                if (!strcmp(t->labels.data[lo], label)) {
+                        s = &t->by_name.data[lo];
+                        break;
+                }
+        }
+
+        free(name);
+        return s;
+}
@@ -20,198 +20,396 @@
 #include "trie.h"
 #include "array.h"
 
+#include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
 
-typedef struct node node;
+#define TRIE_ARENA_CHUNK (64*1024)
+
+// Path compressed trie. Nodes live in one array and refer to each other
+// by index, 0 doubles as "none" since the root is never a child. Every
+// word is stored once in the arena and edge labels are views into it.
+typedef struct {
+        const char *label;
+        const char *word;  // the word spelled up to here, if one was ever inserted
+        uint32_t    len;
+        uint32_t    child; // first child, siblings are sorted by first byte
+        uint32_t    next;
+        uint32_t    size;  // words in this subtree
+        size_t      count; // occurrences of `word', 0 if it is not in the trie
+} tnode;
+
+typedef struct chunk {
+        struct chunk *next;
+        size_t        len;
+        size_t        cap;
+        char          data[];
+} chunk;
+
+typedef struct {
+        tnode    *nodes;
+        uint32_t  n;
+        uint32_t  cap;
+        chunk    *arena;
+} trie;
+
+static const char *
+intern(trie       *t,
+       const char *s,
+       size_t      n)
+{
+        chunk *c = t->arena;
+
+        if (!c || c->len + n + 1 > c->cap) {
+                size_t cap = n + 1 > TRIE_ARENA_CHUNK ? n + 1 : TRIE_ARENA_CHUNK;
+                c          = (chunk *)malloc(sizeof(chunk) + cap);
+                c->next    = t->arena;
+                c->len     = 0;
+                c->cap     = cap;
+                t->arena   = c;
+        }
+
+        char *p = c->data + c->len;
+        memcpy(p, s, n);
+        p[n] = 0;
+        c->len += n + 1;
+
+        return p;
+}
+
+static uint32_t
+node_new(trie       *t,
+         const char *label,
+         uint32_t    len)
+{
+        if (t->n == t->cap) {
+                t->cap   = t->cap ? t->cap*2 : 64;
+                t->nodes = (tnode *)realloc(t->nodes, sizeof(tnode) * t->cap);
+        }
+
+        t->nodes[t->n] = (tnode) {
+                .label = label,
+                .word  = NULL,
+                .len   = len,
+                .child = 0,
+                .next  = 0,
+                .size  = 0,
+                .count = 0,
+        };
+
+        return t->n++;
+}
+
+static size_t
+common_prefix(const char *a,
+              size_t      alen,
+              const char *b,
+              size_t      blen)
+{
+        size_t i = 0;
+        while (i < alen && i < blen && a[i] == b[i])
+                ++i;
+        return i;
+}
+
+static uint32_t
+find_child(const trie *t,
+           uint32_t    parent,
+           char        c)
+{
+        uint32_t ch = t->nodes[parent].child;
+
+        while (ch && (unsigned char)t->nodes[ch].label[0] < (unsigned char)c)
+                ch = t->nodes[ch].next;
+
+        return ch && t->nodes[ch].label[0] == c ? ch : 0;
+}
+
+// Node at which `s' ends exactly, 0 if there is none. With `partial',
+// `s' may also end inside an edge, the node below it is returned.
+static uint32_t
+walk(const trie *t,
+     const char *s,
+     int         partial)
+{
+        size_t   len = strlen(s);
+        size_t   pos = 0;
+        uint32_t cur = 0;
 
-ARRAY_DEFINE(node *, nodep_ar);
+        while (pos < len) {
+                uint32_t     ch = find_child(t, cur, s[pos]);
+                const tnode *n;
+                size_t       m;
 
-struct node {
-        char ch;
-        int is_end_of_word;
-        nodep_ar children;
-};
+                if (!ch)
+                        return 0;
+
+                n = &t->nodes[ch];
+                m = common_prefix(n->label, n->len, s + pos, len - pos);
+
+                if (m == len - pos && (partial || m == n->len))
+                        return ch;
+                if (m < n->len)
+                        return 0;
+
+                pos += m;
+                cur  = ch;
+        }
+
+        return cur;
+}
 
 int
 trie_empty(void *t)
 {
-        return !t || ((node *)t)->children.len == 0;
+        return !t || ((trie *)t)->nodes[0].size == 0;
 }
 
 void *
 trie_alloc(void)
 {
-        node *root;
-        if (!(root = malloc(sizeof(node))))
+        trie *t;
+
+        if (!(t = (trie *)calloc(1, sizeof(trie))))
                 return NULL;
-        root->ch = '\0';
-        root->is_end_of_word = 0;
-        root->children = array_empty(nodep_ar);
-        return (void *)root;
+
+        (void)node_new(t, "", 0);
+
+        return (void *)t;
+}
+
+int
+trie_contains(void       *trie_,
+              const char *word)
+{
+        trie     *t = (trie *)trie_;
+        uint32_t  n;
+
+        if (!t || !word || !*word)
+                return 0;
+
+        n = walk(t, word, 0);
+        return n && t->nodes[n].count;
 }
 
-static node *
-node_alloc(char ch)
+const char *
+trie_find(void       *trie_,
+          const char *word)
 {
-        node *n;
-        if (!(n = malloc(sizeof(node))))
+        trie     *t = (trie *)trie_;
+        uint32_t  n;
+
+        if (!t || !word || !*word)
                 return NULL;
-        n->ch = ch;
-        n->is_end_of_word = 0;
-        n->children = array_empty(nodep_ar);
-        return n;
+
+        n = walk(t, word, 0);
+        return n && t->nodes[n].count ? t->nodes[n].word : NULL;
 }
 
-int
-trie_insert(void       *trie,
-            const char *word)
+const char *
+trie_insert(void       *trie_,
+            const char *word,
+            size_t      n_)
 {
-        if (!trie || !word)
-                return 0;
+        trie       *t = (trie *)trie_;
+        size_t      len;
+        size_t      pos;
+        uint32_t    cur;
+        uint32_t    n;
+        const char *w;
+
+        if (!t || !word || !*word || !n_)
+                return NULL;
 
-        node   *root    = (node *)trie;
-        node   *current = root;
-        size_t  len     = strlen(word);
-
-        for (size_t i = 0; i < len; ++i) {
-                char ch = word[i];
-                node *next = NULL;
-
-                // Search for child with matching character
-                for (size_t j = 0; j < current->children.len; ++j) {
-                        node *child = current->children.data[j];
-                        if (child->ch == ch) {
-                                next = child;
-                                break;
-                        }
+        // Known node, maybe removed earlier: its word is still interned.
+        if ((n = walk(t, word, 0)) && t->nodes[n].word) {
+                if (t->nodes[n].count) {
+                        t->nodes[n].count += n_;
+                        return t->nodes[n].word;
                 }
+                w = t->nodes[n].word;
+        } else {
+                w = intern(t, word, strlen(word));
+        }
+
+        len = strlen(w);
+        pos = 0;
+        cur = 0;
+
+        while (1) {
+                uint32_t prev, ch;
+                size_t   m;
+
+                t->nodes[cur].size++;
 
-                if (!next) {
-                        next = node_alloc(ch);
-                        if (!next)
-                                return 0;
-                        array_append(current->children, next);
+                if (pos == len) {
+                        t->nodes[cur].word  = w;
+                        t->nodes[cur].count = n_;
+                        return w;
                 }
-                current = next;
 
-        }
+                prev = 0;
+                ch   = t->nodes[cur].child;
+                while (ch && (unsigned char)t->nodes[ch].label[0] < (unsigned char)w[pos]) {
+                        prev = ch;
+                        ch   = t->nodes[ch].next;
+                }
 
-        current->is_end_of_word = 1;
-        return 1;
-}
+                if (!ch || t->nodes[ch].label[0] != w[pos]) {
+                        uint32_t leaf = node_new(t, w + pos, (uint32_t)(len - pos));
+
+                        t->nodes[leaf].word  = w;
+                        t->nodes[leaf].count = n_;
+                        t->nodes[leaf].size  = 1;
+                        t->nodes[leaf].next  = ch;
+                        if (prev)
+                                t->nodes[prev].next = leaf;
+                        else
+                                t->nodes[cur].child = leaf;
+                        return w;
+                }
 
-static node *
-trie_find_prefix_node(void       *trie,
-                      const char *prefix)
-{
-        // Find deepest node matching prefix
+                m = common_prefix(t->nodes[ch].label, t->nodes[ch].len, w + pos, len - pos);
 
-        if (!trie || !prefix)
-                return NULL;
+                // Split the edge, the upper half takes ch's place.
+                if (m < t->nodes[ch].len) {
+                        uint32_t mid = node_new(t, t->nodes[ch].label, (uint32_t)m);
+
+                        t->nodes[mid].next  = t->nodes[ch].next;
+                        t->nodes[mid].child = ch;
+                        t->nodes[mid].size  = t->nodes[ch].size;
+                        t->nodes[ch].next   = 0;
+                        t->nodes[ch].label += m;
+                        t->nodes[ch].len   -= (uint32_t)m;
 
-        node   *root    = (node *)trie;
-        node   *current = root;
-        size_t  len     = strlen(prefix);
-
-        for (size_t i = 0; i < len; ++i) {
-                char ch    = prefix[i];
-                int  found = 0;
-                for (size_t j = 0; j < current->children.len; ++j) {
-                        node *child = current->children.data[j];
-                        if (child->ch == ch) {
-                                current = child;
-                                found   = 1;
-                                break;
-                        }
+                        if (prev)
+                                t->nodes[prev].next = mid;
+                        else
+                                t->nodes[cur].child = mid;
+
+                        ch = mid;
                 }
 
-                if (!found)
-                        return NULL;
+                cur  = ch;
+                pos += m;
         }
-
-        return current;
 }
 
-static void
-collect_words(node    *n,
-              char    *buffer,
-              size_t   buf_pos,
-              size_t   buf_size,
-              char   **results,
-              size_t  *count,
-              size_t   max_results)
+int
+trie_remove(void       *trie_,
+            const char *word,
+            size_t      n)
 {
-        if (!n || *count >= max_results)
-                return;
+        trie     *t = (trie *)trie_;
+        size_t    len;
+        size_t    pos;
+        uint32_t  cur;
 
-        if (n->is_end_of_word) {
-                buffer[buf_pos] = '\0';
-                if (*count < max_results) {
-                        results[(*count)++] = strdup(buffer);
-                }
+        if (!t || !word || !*word || !(cur = walk(t, word, 0)) || !t->nodes[cur].count)
+                return 0;
+
+        if (t->nodes[cur].count > n) {
+                t->nodes[cur].count -= n;
+                return 0;
         }
 
-        for (size_t i = 0; i < n->children.len; ++i) {
-                node *child = n->children.data[i];
-                if (buf_pos + 1 >= buf_size) return;
-                buffer[buf_pos] = child->ch;
-                collect_words(child, buffer, buf_pos + 1, buf_size,
-                              results, count, max_results);
+        // Nodes are kept so the word can come back without allocating.
+        len = strlen(word);
+        pos = 0;
+        cur = 0;
+
+        while (1) {
+                t->nodes[cur].size--;
+                if (pos == len)
+                        break;
+                cur  = find_child(t, cur, word[pos]);
+                pos += t->nodes[cur].len;
         }
+
+        t->nodes[cur].count = 0;
+        return 1;
 }
 
-char **
-trie_get_completions(void       *trie,
-                     const char *prefix,
-                     size_t      max_results,
-                     size_t     *out_count)
+size_t
+trie_get_completions(void        *trie_,
+                     const char  *prefix,
+                     trie_entry  *out,
+                     size_t       max_results)
 {
-        *out_count = 0;
-
-        if (!trie || !prefix)
-                return NULL;
+        trie      *t = (trie *)trie_;
+        uint32_t   start;
+        size_t     count;
+        uint32_t   stack[256];
+        size_t     sp;
 
-        node *start = trie_find_prefix_node(trie, prefix);
-        if (!start)
-                return NULL;
-
-        char **results = calloc(max_results, sizeof(char *));
-        if (!results)
-                return NULL;
+        if (!t || !prefix)
+                return 0;
 
-        char buffer[256];
-        strncpy(buffer, prefix, sizeof(buffer) - 1);
-        buffer[sizeof(buffer) - 1] = '\0';
+        if (!(start = walk(t, prefix, 1)) && *prefix)
+                return 0;
 
-        size_t count = 0;
-        collect_words(start, buffer, strlen(prefix), sizeof(buffer),
-                      results, &count, max_results);
+        // Depth first, children are already in order. Descending into a
+        // node always pushes its siblings first, so the stack only grows
+        // with depth.
+        count = 0;
+        sp    = 0;
+        stack[sp++] = start;
+
+        while (sp > 0 && count < max_results) {
+                uint32_t     i = stack[--sp];
+                const tnode *n = &t->nodes[i];
+
+                // Siblings go first even past a subtree emptied by
+                // trie_remove.
+                if (i != start && n->next && sp < sizeof(stack)/sizeof(*stack))
+                        stack[sp++] = n->next;
+
+                if (n->size == 0)
+                        continue;
+
+                if (n->count)
+                        out[count++] = (trie_entry) {
+                                .word  = n->word,
+                                .count = n->count,
+                        };
+
+                if (n->child && sp < sizeof(stack)/sizeof(*stack))
+                        stack[sp++] = n->child;
+        }
 
-        *out_count = count;
-        return results;
+        return count;
 }
 
-static void
-trie_destroy_node(node *n)
+size_t
+trie_count(void       *trie_,
+           const char *prefix)
 {
-        if (!n)
-                return;
+        trie     *t = (trie *)trie_;
+        uint32_t  start;
 
-        for (size_t i = 0; i < n->children.len; ++i) {
-                trie_destroy_node(n->children.data[i]);
-        }
+        if (!t || !prefix)
+                return 0;
+
+        if (!(start = walk(t, prefix, 1)) && *prefix)
+                return 0;
 
-        array_free(n->children);
-        free(n);
+        return t->nodes[start].size;
 }
 
 void
-trie_destroy(void *trie)
+trie_destroy(void *trie_)
 {
-        if (!trie)
+        trie *t = (trie *)trie_;
+
+        if (!t)
                 return;
 
-        trie_destroy_node((node *)trie);
-}
+        while (t->arena) {
+                chunk *next = t->arena->next;
+                free(t->arena);
+                t->arena = next;
+        }
 
+        free(t->nodes);
+        free(t);
+}
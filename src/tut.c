@@ -140,13 +140,13 @@ tut_alloc(ww *ed, const char *chapter)
         name = chapter;
 
         if (!strcmp(chapter, TUT_CH1_NAME))
-                lns = lines_from(g_tut01);
+                lns = lines_from(NULL, g_tut01);
         else if (!strcmp(chapter, TUT_CH2_NAME))
-                lns = lines_from(g_tut02);
+                lns = lines_from(NULL, g_tut02);
         else if (!strcmp(chapter, TUT_CH3_NAME))
-                lns = lines_from(g_tut03);
+                lns = lines_from(NULL, g_tut03);
         else if (!strcmp(chapter, TUT_CH4_NAME))
-                lns = lines_from(g_tut04);
+                lns = lines_from(NULL, g_tut04);
         else
                 return NULL;
 
@@ -0,0 +1,325 @@
+/*
+ * ww: a simple editor
+ * Copyright (C) 2026 malloc-nbytes
+ * Contact: zdhdev@yahoo.com
+
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "wordindex.h"
+
+#include <ctype.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#define WORD_MAX 1024
+
+typedef struct {
+        const char *word;
+        size_t      line;
+} occurrence;
+
+ARRAY_DEFINE(occurrence, occurrence_ar);
+
+typedef void (*word_visit)(const char *word, void *ctx);
+
+// Every word of every buffer, counted once per occurrence.
+static void *g_words = NULL;
+
+// Calls `visit' for each word of `s': a letter or '_', then letters,
+// digits and '_'. The line being typed in may be gapped, so it is read
+// a run at a time.
+static void
+each_word(const str  *s,
+          word_visit  visit,
+          void       *ctx)
+{
+        char   buf[WORD_MAX];
+        size_t n = 0;
+
+        for (size_t i = 0; i < s->len; ) {
+                const char *p;
+                size_t      run = str_run(s, i, &p);
+
+                for (size_t j = 0; j < run; ++j) {
+                        unsigned char ch = (unsigned char)p[j];
+
+                        if (isalpha(ch) || ch == '_' || (n && isdigit(ch))) {
+                                if (n < WORD_MAX-1)
+                                        buf[n++] = (char)ch;
+                                continue;
+                        }
+
+                        if (n) {
+                                buf[n] = 0;
+                                visit(buf, ctx);
+                                n = 0;
+                        }
+                }
+
+                i += run;
+        }
+
+        if (n) {
+                buf[n] = 0;
+                visit(buf, ctx);
+        }
+}
+
+// First ref whose word is not below `word' by address.
+static size_t
+lower_bound(const wordref_ar *refs,
+            const char       *word)
+{
+        size_t lo = 0;
+        size_t hi = refs->len;
+
+        while (lo < hi) {
+                size_t mid = lo + (hi - lo)/2;
+
+                if ((uintptr_t)refs->data[mid].word < (uintptr_t)word)
+                        lo = mid + 1;
+                else
+                        hi = mid;
+        }
+
+        return lo;
+}
+
+static int
+occurrence_cmp(const void *a_,
+               const void *b_)
+{
+        const occurrence *a = (const occurrence *)a_;
+        const occurrence *b = (const occurrence *)b_;
+
+        if (a->word != b->word)
+                return (uintptr_t)a->word < (uintptr_t)b->word ? -1 : 1;
+        if (a->line != b->line)
+                return a->line < b->line ? -1 : 1;
+        return 0;
+}
+
+static void
+drop(const wordref_ar *refs)
+{
+        for (size_t i = 0; i < refs->len; ++i)
+                (void)trie_remove(g_words, refs->data[i].word, refs->data[i].count);
+}
+
+typedef struct {
+        occurrence_ar *occ;
+        wordref_ar    *refs;
+        size_t         line;
+        size_t         emptied; // refs whose count went to 0
+} visit_ctx;
+
+static void
+visit_occurrence(const char *word,
+                 void       *ctx_)
+{
+        visit_ctx *ctx = (visit_ctx *)ctx_;
+
+        array_append(*ctx->occ, ((occurrence) {
+                .word = trie_insert(g_words, word, 1),
+                .line = ctx->line,
+        }));
+}
+
+// The occurrences of the rows in `runs', sorted by word address.
+static occurrence_ar
+occurrences(const linep_ar *lines,
+            const row_run  *runs,
+            size_t          n)
+{
+        occurrence_ar occ = array_empty(occurrence_ar);
+        visit_ctx     ctx = { .occ = &occ };
+
+        for (size_t i = 0; i < n; ++i) {
+                for (size_t r = runs[i].from; r < runs[i].to; ++r) {
+                        ctx.line = r;
+                        each_word(&lines->data[r]->txt, visit_occurrence, &ctx);
+                }
+        }
+
+        if (occ.len)
+                qsort(occ.data, occ.len, sizeof(*occ.data), occurrence_cmp);
+
+        return occ;
+}
+
+void
+wordindex_update(wordref_ar     *refs,
+                 const linep_ar *lines)
+{
+        occurrence_ar occ;
+        wordref_ar    next;
+        row_run       all = { .from = 0, .to = lines->len };
+
+        if (!g_words)
+                g_words = trie_alloc();
+
+        // New occurrences are counted before the old ones are dropped, a
+        // word that stays never leaves the trie.
+        occ  = occurrences(lines, &all, 1);
+        next = array_empty(wordref_ar);
+
+        for (size_t i = 0; i < occ.len; ++i) {
+                if (next.len && array_at(next, next.len-1).word == occ.data[i].word) {
+                        array_at(next, next.len-1).count++;
+                        array_at(next, next.len-1).line = occ.data[i].line;
+                } else {
+                        array_append(next, ((wordref) {
+                                .word  = occ.data[i].word,
+                                .count = 1,
+                                .line  = occ.data[i].line,
+                        }));
+                }
+        }
+
+        drop(refs);
+        array_free(*refs);
+        array_free(occ);
+        *refs = next;
+}
+
+void
+wordindex_add_rows(wordref_ar     *refs,
+                   const linep_ar *lines,
+                   const row_run  *runs,
+                   size_t          n)
+{
+        occurrence_ar occ;
+        wordref_ar    next;
+        size_t        i;
+        size_t        j;
+
+        if (!g_words)
+                g_words = trie_alloc();
+
+        occ = occurrences(lines, runs, n);
+
+        if (!occ.len) {
+                array_free(occ);
+                return;
+        }
+
+        next = array_empty(wordref_ar);
+        array_reserve(next, refs->len + occ.len);
+
+        // Both are sorted by word address, so one merge does it.
+        for (i = j = 0; i < refs->len || j < occ.len; ) {
+                wordref ref;
+
+                if (j == occ.len || (i < refs->len
+                                     && (uintptr_t)refs->data[i].word < (uintptr_t)occ.data[j].word)) {
+                        next.data[next.len++] = refs->data[i++];
+                        continue;
+                }
+
+                if (i < refs->len && refs->data[i].word == occ.data[j].word)
+                        ref = refs->data[i++];
+                else
+                        ref = (wordref) { .word = occ.data[j].word };
+
+                for (; j < occ.len && occ.data[j].word == ref.word; ++j) {
+                        ref.count++;
+                        ref.line = occ.data[j].line;
+                }
+
+                next.data[next.len++] = ref;
+        }
+
+        array_free(*refs);
+        array_free(occ);
+        *refs = next;
+}
+
+// Words the buffer never counted in are left alone, they belong to
+// other buffers. Emptied refs stay until all of the rows are done.
+static void
+visit_remove(const char *word,
+             void       *ctx_)
+{
+        visit_ctx  *ctx = (visit_ctx *)ctx_;
+        const char *w   = trie_find(g_words, word);
+        size_t      i;
+
+        if (!w)
+                return;
+
+        i = lower_bound(ctx->refs, w);
+        if (i == ctx->refs->len || ctx->refs->data[i].word != w || !ctx->refs->data[i].count)
+                return;
+
+        (void)trie_remove(g_words, w, 1);
+        if (--ctx->refs->data[i].count == 0)
+                ++ctx->emptied;
+}
+
+void
+wordindex_remove_rows(wordref_ar     *refs,
+                      const linep_ar *lines,
+                      const row_run  *runs,
+                      size_t          n)
+{
+        visit_ctx ctx = { .refs = refs };
+        size_t    w   = 0;
+
+        if (!g_words)
+                return;
+
+        for (size_t i = 0; i < n; ++i)
+                for (size_t r = runs[i].from; r < runs[i].to; ++r)
+                        each_word(&lines->data[r]->txt, visit_remove, &ctx);
+
+        if (!ctx.emptied)
+                return;
+
+        for (size_t i = 0; i < refs->len; ++i)
+                if (refs->data[i].count)
+                        refs->data[w++] = refs->data[i];
+        refs->len = w;
+}
+
+void
+wordindex_release(wordref_ar *refs)
+{
+        if (g_words)
+                drop(refs);
+        array_free(*refs);
+}
+
+const wordref *
+wordindex_find(const wordref_ar *refs,
+               const char       *word)
+{
+        size_t i = lower_bound(refs, word);
+
+        return i < refs->len && refs->data[i].word == word ? &refs->data[i] : NULL;
+}
+
+size_t
+wordindex_completions(const char *prefix,
+                      trie_entry *out,
+                      size_t      max_results)
+{
+        return trie_get_completions(g_words, prefix, out, max_results);
+}
+
+size_t
+wordindex_count(const char *prefix)
+{
+        return trie_count(g_words, prefix);
+}
@@ -29,13 +29,19 @@
 #include "confirmbox.h"
 #include "colors.h"
 #include "glconf.h"
+#include "compile.h"
+#include "manindex.h"
+#include "fileindex.h"
+#include "symindex.h"
+#include "session.h"
 
 #include <assert.h>
+#include <errno.h>
+#include <poll.h>
 #include <string.h>
 #include <stdio.h>
 #include <unistd.h>
 #include <sys/wait.h>
-#include <regex.h>
 
 #ifdef WITH_LLM
         #include <pthread.h>
@@ -46,9 +52,12 @@
 
 static volatile sig_atomic_t g_resize_flag = 0;
 
-static buffer *
-get_buffer_by_name(ww         *ed,
-                   const char *name);
+static int
+jump_to_location(ww         *ed,
+                 const char *filename,
+                 int         row,
+                 int         col,
+                 buffer     *from);
 
 static void
 resize_signal_handler(int sig)
@@ -57,6 +66,23 @@ resize_signal_handler(int sig)
         g_resize_flag = 1;
 }
 
+// Lay the panes out again, only needed once the terminal was resized or
+// the splits changed.
+static void
+relayout(ww *ed)
+{
+        layout_place(ed->root, 0, 0, (unsigned)glconf.term.w, (unsigned)glconf.term.h);
+        array_clear(ed->panes);
+        layout_panes(ed->root, &ed->panes);
+}
+
+static void
+damage_all(ww *ed)
+{
+        for (size_t i = 0; i < ed->panes.len; ++i)
+                ed->panes.data[i]->damaged = 1;
+}
+
 static void
 handle_resize(ww *ed)
 {
@@ -76,6 +102,8 @@ handle_resize(ww *ed)
         glconf.term.w = win_width;
         glconf.term.h = win_height;
 
+        relayout(ed);
+        damage_all(ed);
         ww_display_monitors(ed, BA_REDRAW);
 }
 
@@ -135,10 +163,10 @@ switch_to_convo_buf(ww *ed)
                                        str_from("Ollama Response"),
                                        (unsigned)glconf.term.w,
                                        (unsigned)glconf.term.h,
-                                       0, 0, lines_from("\n"), ed);
+                                       0, 0, lines_from(NULL, "\n"), ed);
                 ww_add_buffer(ed, convobuf);
                 ww_make_buffer_primary_by_name(ed, "Ollama Response");
-        } else if (!strcmp(ed->monitors[0]->name.chars, "Ollama Response")) {
+        } else if (!strcmp(ww_monitor(ed, 0)->name.chars, "Ollama Response")) {
                 ww_make_buffer_primary_by_name(ed, "Ollama Response");
         }
 }
@@ -323,11 +351,12 @@ send_to_model(ww *ed)
         cstr_ar files       = array_empty(cstr_ar);
         size_t  prompt_size = strlen(user_prompt) + 256;
 
-        for (size_t i = 0; i < ed->buffers.len; ++i) {
-                if (!strcmp(ed->buffers.data[i]->name.chars, "Ollama Response"))
+        for (buffer *b = ed->bufs.mru; b; b = b->mru_next) {
+                if (!strcmp(b->name.chars, "Ollama Response"))
                         continue;
 
-                char *file = buffer_to_cstr(ed->buffers.data[i]);
+                buffer_ensure_loaded(b);
+                char *file = buffer_to_cstr(b);
 
                 if (!file)
                         continue;
@@ -495,6 +524,9 @@ poll_llm_response(ww *ed)
 
         pthread_mutex_unlock(&g_llm.mutex);
 
+        // The response may go into the buffer being typed in.
+        str_gap_close();
+
         buffer *convobuf = get_buffer_by_name(ed, "Ollama Response");
 
         if (!convobuf) {
@@ -521,57 +553,116 @@ poll_llm_response(ww *ed)
 
 #endif // WITH_LLM
 
-static ssize_t
-get_buffer_by_path(ww *ed, const char *path)
+static buffer *
+get_buffer_by_name(ww         *ed,
+                   const char *name)
 {
-        for (size_t i = 0; i < ed->buffers.len; ++i) {
-                if (!strcmp(ed->buffers.data[i]->path.chars, path)) {
-                        return (ssize_t)i;
-                }
-        }
+        return bufreg_by_name(&ed->bufs, name);
+}
+
+static buffer *
+get_buffer_by_path(ww         *ed,
+                   const char *path)
+{
+        return bufreg_by_path(&ed->bufs, path);
+}
 
-        return -1;
+static int
+on_monitor(const ww     *ed,
+           const buffer *b)
+{
+        for (size_t i = 0; i < ed->panes.len; ++i)
+                if (ww_monitor(ed, i) == b)
+                        return 1;
+        return 0;
 }
 
-static void
-sort_buffers(ww *ed)
+static buffer *
+get_random_nonopen_buffer(ww *ed)
 {
-        if (ed->buffers.len <= 1)
-                return;
+        for (buffer *b = ed->bufs.mru; b; b = b->mru_next) {
+                if (!on_monitor(ed, b))
+                        return b;
+        }
 
-        const buffer *curbuf = ed->monitors[ed->am];
-        buffer *curbufi      = NULL;
-        size_t idx           = 0;
+        return NULL;
+}
 
-        for (size_t i = 0; i < ed->buffers.len; ++i) {
-                if (!strcmp(ed->buffers.data[i]->name.chars, curbuf->name.chars)) {
-                        curbufi = ed->buffers.data[i];
-                        idx = i;
-                        break;
+// `dead' is about to be freed along with all of its views, the
+// monitors showing it show `b' instead.
+static void
+replace_dead(ww     *ed,
+             buffer *dead,
+             buffer *b)
+{
+        for (size_t i = 0; i < ed->panes.len; ++i) {
+                if (ww_monitor(ed, i) == dead) {
+                        ed->panes.data[i]->view = NULL;
+                        ww_show(ed, i, b);
                 }
         }
+}
 
-        if (!curbufi) {
-                assert(0);
+// Evict the least recently used buffers that are off screen until the
+// text kept in memory fits in `buffer-memory' again.
+static void
+enforce_memory_budget(ww *ed)
+{
+        size_t budget = glconf.runtime.buffer_memory;
+
+        if (!budget)
                 return;
-        }
 
-        for (size_t i = idx; i > 0; --i)
-                ed->buffers.data[i] = ed->buffers.data[i-1];
+        for (buffer *b = ed->bufs.lru; b && ed->bufs.resident > budget; b = b->mru_prev)
+                if (!on_monitor(ed, b))
+                        (void)buffer_evict(b);
+}
 
-        ed->buffers.data[0]   = curbufi;
+// The active buffer becomes the most recently used.
+static void
+sort_buffers(ww *ed)
+{
+        buffer_ensure_loaded(ww_monitor(ed, ed->am));
+        bufreg_touch(&ed->bufs, ww_monitor(ed, ed->am));
+        enforce_memory_budget(ed);
+}
+
+// Only the first `owned' entries came from lsdir().
+static void
+free_file_list(cstr_ar *files,
+               size_t   owned)
+{
+        for (size_t i = 0; i < owned; ++i)
+                free(files->data[i]);
+        array_free(*files);
 }
 
 static void
 find_file(ww *ed)
 {
         cstr_ar  files;
+        size_t   owned;
         char    *chosen_file = NULL;
         str      cwd         = str_from(".");
 
  reload_dir:
 
-        files          = lsdir(str_cstr(&cwd));
+        files = lsdir(str_cstr(&cwd));
+        owned = files.len;
+
+        // From the starting directory the whole project tree is offered,
+        // top level files are already listed by lsdir().
+        if (!strcmp(str_cstr(&cwd), ".") && worth_indexing(".")) {
+                fileindex_start(".");
+
+                cstr_ar tree = fileindex_files();
+
+                array_reserve(files, files.len + tree.len);
+                for (size_t i = 0; i < tree.len; ++i)
+                        if (strchr(tree.data[i], '/'))
+                                files.data[files.len++] = tree.data[i];
+        }
+
         char *selected = minibuffer_input(ed, "find-file", NULL, files);
 
         if (!selected)
@@ -581,7 +672,7 @@ find_file(ww *ed)
                 str_concat(&cwd, "/..");
 
                 free(selected);
-                array_free(files);
+                free_file_list(&files, owned);
                 goto reload_dir;
         }
 
@@ -593,7 +684,7 @@ find_file(ww *ed)
                 str_destroy(&cwd);
                 cwd = fullpath;
                 free(selected);
-                array_free(files);
+                free_file_list(&files, owned);
                 goto reload_dir;
         }
 
@@ -607,18 +698,18 @@ find_file(ww *ed)
         free(selected);
 
  done:
-        array_free(files);
+        free_file_list(&files, owned);
         str_destroy(&cwd);
 
         if (!chosen_file) {
-                buffer_draw(ed->monitors[ed->am]);
+                buffer_draw(ww_monitor(ed, ed->am));
                 return;
         }
 
-        for (size_t i = 0; i < 4; ++i) {
-                if (ed->monitors[i] && !strcmp(ed->monitors[i]->path.chars, chosen_file)) {
-                        ed->am = (uint8_t)i;
-                        buffer_draw(ed->monitors[ed->am]);
+        for (size_t i = 0; i < ed->panes.len; ++i) {
+                if (ww_monitor(ed, i) && !strcmp(ww_monitor(ed, i)->path.chars, chosen_file)) {
+                        ed->am = i;
+                        buffer_draw(buffer_view_use(ed->panes.data[i]->view));
                         return;
                 }
         }
@@ -626,63 +717,50 @@ find_file(ww *ed)
         if (!ww_buffer_exists_by_path(ed, chosen_file)) {
                 if (!file_exists(chosen_file))
                         create_file(chosen_file, 1);
-                ww_add_buffer(ed, buffer_from(str_from(get_basename(chosen_file)),
+                ww_add_buffer(ed, buffer_load(str_from(get_basename(chosen_file)),
                                               str_from(chosen_file),
                                               (unsigned)glconf.term.w, (unsigned)glconf.term.h,
-                                              0, 0,
-                                              lines_from(load_file(chosen_file)), ed));
+                                              0, 0, ed));
         }
 
-        ssize_t idx = get_buffer_by_path(ed, chosen_file);
+        buffer *b = get_buffer_by_path(ed, chosen_file);
 
         free(chosen_file);
 
-        if (idx == -1)
+        if (!b)
                 return;
 
-        ed->monitors[ed->am] = ed->buffers.data[idx];
+        ww_show(ed, ed->am, b);
         sort_buffers(ed);
 }
 
-static buffer *
-get_buffer_by_name(ww         *ed,
-                   const char *name)
-{
-        for (size_t i = 0; i < ed->buffers.len; ++i) {
-                if (!strcmp(ed->buffers.data[i]->name.chars, name))
-                        return ed->buffers.data[i];
-        }
-        return NULL;
-}
-
 void
 ww_switch_buffer(ww *ed)
 {
-        cstr_ar names;
-        char *selected;
+        cstr_ar  names;
+        char    *selected;
+        buffer  *b;
 
         names = array_empty(cstr_ar);
 
-        for (size_t i = 0; i < ed->buffers.len; ++i) {
-                int found = 0;
-                for (size_t j = 0; j < 4; ++j) {
-                        if (ed->monitors[j] && !strcmp(ed->buffers.data[i]->name.chars,
-                                                       ed->monitors[j]->name.chars)) {
-                                found = 1;
-                                break;
-                        }
-                }
-                if (!found)
-                        array_append(names, strdup(str_cstr(&ed->buffers.data[i]->name)));
-        }
+        // Most recently used first, the ones on screen last: they can be
+        // shown again in another monitor.
+        for (buffer *it = ed->bufs.mru; it; it = it->mru_next)
+                if (!on_monitor(ed, it))
+                        array_append(names, strdup(str_cstr(&it->name)));
+        for (buffer *it = ed->bufs.mru; it; it = it->mru_next)
+                if (on_monitor(ed, it) && it != ww_monitor(ed, ed->am))
+                        array_append(names, strdup(str_cstr(&it->name)));
 
         selected = minibuffer_input(ed, "switch-buffer", NULL, names);
 
         if (!selected || strlen(selected) == 0)
                 goto done;
 
-        ed->monitors[ed->am] = get_buffer_by_name(ed, selected);
+        if (!(b = get_buffer_by_name(ed, selected)))
+                goto done;
 
+        ww_show(ed, ed->am, b);
         sort_buffers(ed);
 
  done:
@@ -695,65 +773,48 @@ ww_switch_buffer(ww *ed)
 void
 ww_make_buffer_primary_by_name(ww *ed, const char *name)
 {
-        ssize_t idx;
-
-        idx = -1;
-
-        for (size_t i = 0; i < ed->buffers.len; ++i) {
-                if (!strcmp(ed->buffers.data[i]->name.chars, name))
-                        idx = (ssize_t)i;
-        }
+        buffer *b;
 
-        if (idx != -1)
-                ww_make_buffer_primary(ed, (size_t)idx);
+        if ((b = get_buffer_by_name(ed, name)))
+                ww_make_buffer_primary(ed, b);
 }
 
 void
 ww_make_buffer_primary_by_path(ww *ed, const char *path)
 {
-        ssize_t idx;
-
-        idx = -1;
-
-        for (size_t i = 0; i < ed->buffers.len; ++i) {
-                if (!strcmp(ed->buffers.data[i]->path.chars, path)) {
-                        idx = (ssize_t)i;
-                }
-        }
+        buffer *b;
 
-        if (idx != -1) {
-                ww_make_buffer_primary(ed, (size_t)idx);
-        }
+        if ((b = get_buffer_by_path(ed, path)))
+                ww_make_buffer_primary(ed, b);
 }
 
 ww
 ww_create(void)
 {
-        return (ww) {
-                .buffers  = array_empty(bufferp_ar),
-                .monitors = {NULL, NULL, NULL, NULL},
-                .am       = 0,
+        ww ed = (ww) {
+                .root  = layout_pane(),
+                .panes = array_empty(layoutp_ar),
+                .am    = 0,
         };
+
+        bufreg_init(&ed.bufs);
+        relayout(&ed);
+
+        return ed;
 }
 
 int
-ww_buffer_exists_by_name(const ww   *ed,
+ww_buffer_exists_by_name(ww         *ed,
                          const char *name)
 {
-        for (size_t i = 0; i < ed->buffers.len; ++i)
-                if (!strcmp(ed->buffers.data[i]->name.chars, name))
-                        return 1;
-        return 0;
+        return get_buffer_by_name(ed, name) != NULL;
 }
 
 int
-ww_buffer_exists_by_path(const ww   *ed,
+ww_buffer_exists_by_path(ww         *ed,
                          const char *path)
 {
-        for (size_t i = 0; i < ed->buffers.len; ++i)
-                if (!strcmp(ed->buffers.data[i]->path.chars, path))
-                        return 1;
-        return 0;
+        return get_buffer_by_path(ed, path) != NULL;
 }
 
 void
@@ -762,193 +823,177 @@ ww_add_buffer(ww *ed, buffer *b)
         if (ww_buffer_exists_by_name(ed, b->name.chars))
                 str_overwrite(&b->name, b->path.chars);
 
-        //array_append(ed->buffers, NULL);
-        array_append(ed->buffers, b);
+        bufreg_add(&ed->bufs, b);
+
+        diag_index_attach(&g_compile_diags, b);
+}
+
+buffer *
+ww_monitor(const ww *ed,
+           size_t    i)
+{
+        const layout *pane = i < ed->panes.len ? ed->panes.data[i] : NULL;
+
+        return pane && pane->view ? pane->view->buf : NULL;
+}
+
+buffer *
+ww_show(ww     *ed,
+        size_t  i,
+        buffer *b)
+{
+        layout *pane = ed->panes.data[i];
+        int     home_used = 0;
+
+        if (pane->view && pane->view->buf == b)
+                return buffer_view_use(pane->view);
+
+        if (pane->view)
+                buffer_view_close(pane->view);
+
+        pane->view    = NULL;
+        pane->damaged = 1;
+
+        if (!b)
+                return NULL;
+
+        for (size_t j = 0; j < ed->panes.len; ++j)
+                home_used |= ed->panes.data[j]->view == &b->home;
 
-        //for (size_t i = ed->buffers.len-1; i > 0; --i)
-        //        ed->buffers.data[i] = ed->buffers.data[i-1];
+        pane->view = home_used ? buffer_view_open(b) : &b->home;
+        layout_fit(pane);
 
-        //ed->buffers.data[0] = b;
+        return buffer_view_use(pane->view);
+}
+
+void
+ww_set_layout(ww     *ed,
+              layout *root)
+{
+        for (size_t i = 0; i < ed->panes.len; ++i)
+                ww_show(ed, i, NULL);
+
+        layout_free(ed->root);
+        ed->root = root;
+        ed->am   = 0;
+        relayout(ed);
 }
 
 void
 ww_clear_monitors(ww *ed)
 {
-        ed->monitors[0] = NULL;
-        ed->monitors[1] = NULL;
-        ed->monitors[2] = NULL;
-        ed->monitors[3] = NULL;
+        ww_set_layout(ed, layout_pane());
 }
 
 void
-ww_make_buffer_primary(ww *ed, size_t idx)
+ww_make_buffer_primary(ww *ed, buffer *b)
 {
-        //assert(idx < 4);
+        // Keep the place of the view it was edited through.
+        buffer_view keep = *b->v;
 
         ww_clear_monitors(ed);
-        ed->monitors[0] = ed->buffers.data[idx];
-        ed->am = 0;
+        b->home = keep;
+        ww_show(ed, 0, b);
         sort_buffers(ed);
 }
 
-static void
-draw_monitor_based_on_action(ww            *ed,
-                             buffer_action  ba,
-                             size_t         idx)
+// Actions after which the whole screen is stale, the minibuffer and
+// prompts draw over it.
+static int
+damages_all(buffer_action ba)
 {
-        if (!ed->monitors[idx])
-                return;
-
-        if (ba == BA_REDRAW
-            || ba == BA_REQ_SPLITVER
-            || ba == BA_REQ_JMPBUF
-            || ba == BA_REQ_SWITCHBUFFER
+        return ba == BA_REQ_SWITCHBUFFER
             || ba == BA_REQ_FINDFILE
-            || ba == BA_REQ_MAXIMIZEMON
             || ba == BA_REQ_COMPILE
             || ba == BA_REQ_RECOMPILE
             || ba == BA_REQ_CLOSE_BUILTIN
-            || ba == BA_REQ_SPLITHOR
             || ba == BA_REQ_KILLBUF
             || ba == BA_REQ_SWITCHCOMPL
             || ba == BA_REQ_ERRJMP
             || ba == BA_REQ_NEXTERROR
+            || ba == BA_REQ_PREVERROR
+            || ba == BA_REQ_GOTODEF
 #ifdef WITH_LLM
-            || ba == BA_REQ_CONVO)
-#else
-            )
-            #endif
-                buffer_draw(ed->monitors[idx]);
-        else if (ba == BA_XY)
-                buffer_drawxy(ed->monitors[idx]);
+            || ba == BA_REQ_CONVO
+#endif
+            ;
 }
 
-void
-ww_display_monitors(ww *ed, buffer_action ba)
+static void
+draw_pane(layout *pane)
 {
-        buffer *opened[4] = {0};
-        size_t opened_n = 0;
-
-        for (size_t i = 0; i < 4; ++i) {
-                for (size_t j = 0; j < 4; ++j) {
-                        if (opened[j] && ed->monitors[i] && opened[j] == ed->monitors[i])
-                                ed->monitors[i] = ww_helpbuf_alloc(0, 0, 0, 0, ed);
-                }
-
-                if (ed->monitors[i]) {
-                        ed->monitors[i]->size.w  = (unsigned)glconf.term.w;
-                        ed->monitors[i]->size.h  = (unsigned)glconf.term.h;
-                        ed->monitors[i]->size.ws = 0;
-                        ed->monitors[i]->size.hs = 0;
-
-                        opened[opened_n++] = ed->monitors[i];
-                }
-        }
-
-        if (ed->monitors[1]) {
-                ed->monitors[0]->size.w  /= 2;
-                ed->monitors[1]->size.w  /= 2;
-                ed->monitors[1]->size.ws  = (unsigned)glconf.term.w/2;
-        }
-
-        if (ed->monitors[2]) {
-                ed->monitors[2]->size.hs = (unsigned)glconf.term.h/2;
-                ed->monitors[0]->size.h /= 2;
-                if (ed->monitors[1])
-                        ed->monitors[1]->size.h /= 2;
-        }
-
-        if (ba == BA_NOP)
+        if (!pane->view || !pane->damaged)
                 return;
 
-        for (size_t i = 0; i < 4; ++i) {
-                if (i != ed->am && ed->monitors[i])
-                        draw_monitor_based_on_action(ed, ba, i);
-        }
-
-        // Draw active monitor lastly to not re-draw.
-        draw_monitor_based_on_action(ed, ba, ed->am);
-
-        fflush(stdout);
+        pane->damaged = 0;
+        buffer_draw(buffer_view_use(pane->view));
 }
 
-static void
-split_vertical(ww *ed)
+void
+ww_display_monitors(ww *ed, buffer_action ba)
 {
-        // TODO: check for monitor[2]
-        /*if (ed->buffers.len <= 1)
-                return;*/
+        buffer *ab = ww_monitor(ed, ed->am);
+        layout *active;
 
-        buffer *b = NULL;
+        if (damages_all(ba))
+                damage_all(ed);
 
-        for (size_t i = 0; i < ed->buffers.len; ++i) {
-                b = ed->buffers.data[i];
+        // A redraw of the active buffer is also how edits made through
+        // one view reach the other panes showing it.
+        for (size_t i = 0; ba == BA_REDRAW && i < ed->panes.len; ++i)
+                if (ww_monitor(ed, i) == ab)
+                        ed->panes.data[i]->damaged = 1;
 
-                for (size_t j = 0; j < 4; ++j) {
-                        if (!ed->monitors[j])
-                                continue;
-                        if (!strcmp(ed->monitors[j]->name.chars,
-                                    ed->buffers.data[i]->name.chars)) {
-                                b = NULL;
-                                break;
-                        }
-                }
-
-                if (b)
-                        break;
+        for (size_t i = 0; i < ed->panes.len; ++i) {
+                if (ww_monitor(ed, i))
+                        buffer_ensure_loaded(ww_monitor(ed, i));
+                if (i != ed->am)
+                        draw_pane(ed->panes.data[i]);
         }
 
-        if (!b) {
-                b = ww_helpbuf_alloc((unsigned)glconf.term.w, (unsigned)glconf.term.w, 0, 0, ed);
-                array_append(ed->buffers, b);
-        }
+        // Draw active monitor lastly to not re-draw, this also leaves
+        // its buffer edited through the active monitor's view.
+        active = ed->panes.data[ed->am];
 
-        ed->monitors[1] = b;
-        //ed->monitors[1] = ed->monitors[ed->ab];
-        ed->am = 1;
+        if (active->view && active->damaged)
+                draw_pane(active);
+        else if (active->view && (ba == BA_XY || ba == BA_REQ_JMPBUF))
+                buffer_drawxy(buffer_view_use(active->view));
+        else if (active->view)
+                buffer_view_use(active->view);
+
+        fflush(stdout);
 }
 
-static void
-split_horizontal(ww *ed)
+// Split the active pane in two and show `b', or another buffer that is
+// not on screen, in the new half which becomes active. Returns 0 if the
+// pane is too small to split.
+static int
+split(ww          *ed,
+      layout_kind  kind,
+      buffer      *b)
 {
-        /*if (ed->buffers.len <= 1)
-                return;*/
-
-        buffer *b = NULL;
-
-        for (size_t i = 0; i < ed->buffers.len; ++i) {
-                b = ed->buffers.data[i];
-
-                for (size_t j = 0; j < 4; ++j) {
-                        if (!ed->monitors[j])
-                                continue;
-                        if (!strcmp(ed->monitors[j]->name.chars,
-                                    ed->buffers.data[i]->name.chars)) {
-                                b = NULL;
-                                break;
-                        }
-                }
+        if (!layout_split(ed->panes.data[ed->am], kind))
+                return 0;
 
-                if (b)
-                        break;
-        }
+        relayout(ed);
+        ed->am += 1;
 
-        if (!b) {
+        if (!b && !(b = get_random_nonopen_buffer(ed))) {
                 b = ww_helpbuf_alloc((unsigned)glconf.term.w, (unsigned)glconf.term.w, 0, 0, ed);
-                array_append(ed->buffers, b);
+                bufreg_add(&ed->bufs, b);
         }
 
-        ed->monitors[2] = b;
-        ed->am          = 2;
+        ww_show(ed, ed->am, b);
+        return 1;
 }
 
 static void
 jump_buffer(ww *ed)
 {
         do {
-                ed->am = (uint8_t)(ed->am + 1)
-                        % (sizeof(ed->monitors)/sizeof(*ed->monitors));
-        } while (!ed->monitors[ed->am]);
+                ed->am = (ed->am + 1) % ed->panes.len;
+        } while (!ww_monitor(ed, ed->am));
 }
 
 static char **
@@ -981,30 +1026,9 @@ make_command(str *s)
         return ar.data;
 }
 
+// Also called with no bytes once the output has been quiet for a frame.
 typedef void (*output_callback)(const char *chunk, size_t len, void *userdata);
 
-static void
-append_to_buffer_callback(const char *chunk,
-                          size_t      len,
-                          void       *userdata)
-{
-        buffer *b = (buffer *)userdata;
-        char tmp[len + 1];
-        memcpy(tmp, chunk, len);
-        tmp[len] = '\0';
-
-        linep_ar new_lines = lines_from(tmp);
-        for (size_t i = 0; i < new_lines.len; ++i) {
-                array_append(b->lines, new_lines.data[i]);
-                ++b->al;
-                ++b->cy;
-        }
-        array_free(new_lines);
-
-        buffer_adjust_scroll(b);
-        buffer_draw(b);
-}
-
 static void
 capture_command_output_stream(str             *input,
                               output_callback  cb,
@@ -1039,10 +1063,24 @@ capture_command_output_stream(str             *input,
         // parent
         close(pipefd[1]);
 
-        char buf[4096];
-        ssize_t n;
-        while ((n = read(pipefd[0], buf, sizeof(buf))) > 0)
+        char          buf[4096];
+        ssize_t       n;
+        struct pollfd pfd = { .fd = pipefd[0], .events = POLLIN };
+
+        for (;;) {
+                int ready = poll(&pfd, 1, COMPILE_SINK_FRAME_MS);
+
+                if (ready < 0 && errno == EINTR)
+                        continue;
+                if (ready == 0) {
+                        cb(buf, 0, userdata);
+                        continue;
+                }
+                if (ready < 0 || (n = read(pipefd[0], buf, sizeof(buf))) <= 0)
+                        break;
+
                 cb(buf, (size_t)n, userdata); // sending chunk to buffer
+        }
 
         close(pipefd[0]);
         waitpid(pid, NULL, 0);
@@ -1072,42 +1110,48 @@ do_compilation(ww *ed)
                 buffer_make_builtin(b);
         } else {
                 exists = 1;
-                for (size_t i = 0; i < b->lines.len; ++i)
-                        line_free(b->lines.data[i]);
-                array_clear(b->lines);
+                buffer_clear_lines(b);
         }
 
         if (!exists)
                 ww_add_buffer(ed, b);
 
-        ed->monitors[ed->am] = ed->buffers.data[get_buffer_by_path(ed, BUFFER_BUILTIN_COMPILE)];
+        ww_show(ed, ed->am, b);
 
-        ed->monitors[ed->am]->cx = 0;
-        ed->monitors[ed->am]->al = 0;
-        ed->monitors[ed->am]->cy = 0;
+        ww_monitor(ed, ed->am)->v->cx = 0;
+        ww_monitor(ed, ed->am)->v->al = 0;
+        ww_monitor(ed, ed->am)->v->cy = 0;
 
         hide_cursor();
 
-#pragma GCC diagnostic push
-#pragma GCC diagnostic ignored "-Wtype-limits"
         char buf[1024] = {0};
         sprintf(buf, COMPILATION_HEADER, str_cstr(&input));
-        linep_ar header = lines_from(buf);
-        for (int i = (int)header.len-1; i >= 0; --i)
-                array_insert_at(ed->monitors[ed->am]->lines, 0, header.data[i]);
-#pragma GCC diagnostic pop
-        buffer_adjust_scroll(ed->monitors[ed->am]);
-
-        buffer_draw(ed->monitors[ed->am]);
-        capture_command_output_stream(&input, append_to_buffer_callback, ed->monitors[ed->am]);
-        array_append(ed->monitors[ed->am]->lines, line_from(str_from("\n")));
-        array_append(ed->monitors[ed->am]->lines, line_from(str_from("[ Done ] ")));
-        ed->monitors[ed->am]->al = ed->monitors[ed->am]->lines.len-1;
-        ed->monitors[ed->am]->cy = (unsigned)ed->monitors[ed->am]->lines.len-1;
-        buffer_adjust_scroll(ed->monitors[ed->am]);
+        linep_ar header = lines_from(ww_monitor(ed, ed->am)->pool, buf);
+        lines_splice(&ww_monitor(ed, ed->am)->lines, 0, 0, header.data, header.len);
+        buffer_adjust_scroll(ww_monitor(ed, ed->am));
+
+        buffer_draw(ww_monitor(ed, ed->am));
+
+        compile_sink sink;
+
+        diag_index_clear(&g_compile_diags);
+        compile_sink_init(&sink, ww_monitor(ed, ed->am), header.len,
+                          glconf.runtime.compile_max_lines, &g_compile_diags);
+        capture_command_output_stream(&input, compile_sink_feed, &sink);
+        compile_sink_finish(&sink);
+        array_free(header);
+
+        for (buffer *it = ed->bufs.mru; it; it = it->mru_next)
+                diag_index_attach(&g_compile_diags, it);
+
+        array_append(ww_monitor(ed, ed->am)->lines, line_alloc(ww_monitor(ed, ed->am)->pool));
+        array_append(ww_monitor(ed, ed->am)->lines, line_from_cstr(ww_monitor(ed, ed->am)->pool, "[ Done ] "));
+        ww_monitor(ed, ed->am)->v->al = ww_monitor(ed, ed->am)->lines.len-1;
+        ww_monitor(ed, ed->am)->v->cy = (unsigned)ww_monitor(ed, ed->am)->lines.len-1;
+        buffer_adjust_scroll(ww_monitor(ed, ed->am));
 
         str_destroy(&input);
-        buffer_draw(ed->monitors[ed->am]);
+        buffer_draw(ww_monitor(ed, ed->am));
 
         show_cursor();
 
@@ -1182,17 +1226,13 @@ tutorial(ww *ed)
         if (!input || strlen(input) == 0)
                 goto done;
 
-        ssize_t idx = get_buffer_by_path(ed, input);
-
-        if (idx == -1) {
+        if (!(b = get_buffer_by_path(ed, input))) {
                 b = tut_alloc(ed, input);
                 if (!b) goto done;
                 ww_add_buffer(ed, b);
         }
-        else
-                b = ed->buffers.data[(size_t)idx];
 
-        ed->monitors[ed->am] = b;
+        ww_show(ed, ed->am, b);
 
 done:
         array_free(chapters);
@@ -1201,49 +1241,24 @@ done:
 static void
 help(ww *ed)
 {
-        ssize_t idx;
         buffer *b;
 
-        if ((idx = get_buffer_by_path(ed, BUFFER_BUILTIN_HELP)) == -1) {
+        if (!(b = get_buffer_by_path(ed, BUFFER_BUILTIN_HELP))) {
                 b = ww_helpbuf_alloc((unsigned)glconf.term.w, (unsigned)glconf.term.w, 0, 0, ed);
-                array_append(ed->buffers, b);
+                bufreg_add(&ed->bufs, b);
         }
-        else
-                b = ed->buffers.data[(size_t)idx];
 
-        ed->monitors[ed->am] = b;
+        ww_show(ed, ed->am, b);
 }
 
 static void
 man(ww *ed)
 {
         char *input_raw;
-        cstr_ar lns;
-        FILE *fp;
-        char ln[1024];
         buffer *b;
         int exists;
 
-        lns = array_empty(cstr_ar);
-
-        if (!(fp = popen("man -k .", "r"))) {
-                perror("popen");
-                return;
-        }
-
-        while (fgets(ln, sizeof(ln), fp)) {
-                for (size_t i = 0; ln[i]; ++i) {
-                        if (ln[i] == ' ') {
-                                ln[i] = 0;
-                                break;
-                        }
-                }
-                array_append(lns, strdup(ln));
-        }
-
-        pclose(fp);
-
-        input_raw = minibuffer_input(ed, "man", NULL, lns);
+        input_raw = minibuffer_input(ed, "man", NULL, manindex_get());
 
         if (!input_raw || strlen(input_raw) == 0)
                 goto done;
@@ -1261,30 +1276,31 @@ man(ww *ed)
                 buffer_make_builtin(b);
         } else {
                 exists = 1;
-                for (size_t i = 0; i < b->lines.len; ++i)
-                        line_free(b->lines.data[i]);
-                array_clear(b->lines);
+                buffer_clear_lines(b);
         }
 
         if (!exists)
                 ww_add_buffer(ed, b);
 
-        ed->monitors[ed->am] = ed->buffers.data[get_buffer_by_path(ed, BUFFER_BUILTIN_MAN)];
+        ww_show(ed, ed->am, b);
 
         str cmd = str_from("man ");
         str_concat(&cmd, input_raw);
-        capture_command_output_stream(&cmd, append_to_buffer_callback, ed->monitors[ed->am]);
+
+        compile_sink sink;
+
+        compile_sink_init(&sink, ww_monitor(ed, ed->am), 0, 0, NULL);
+        capture_command_output_stream(&cmd, compile_sink_feed, &sink);
+        compile_sink_finish(&sink);
         str_destroy(&cmd);
 
-        ed->monitors[ed->am]->cx = 0;
-        ed->monitors[ed->am]->al = 0;
-        ed->monitors[ed->am]->cy = 0;
-        buffer_adjust_scroll(ed->monitors[ed->am]);
+        ww_monitor(ed, ed->am)->v->cx = 0;
+        ww_monitor(ed, ed->am)->v->al = 0;
+        ww_monitor(ed, ed->am)->v->cy = 0;
+        buffer_adjust_scroll(ww_monitor(ed, ed->am));
 
 done:
-        for (size_t i = 0; i < lns.len; ++i)
-                free(lns.data[i]);
-        array_free(lns);
+        free(input_raw);
 }
 
 static void
@@ -1299,6 +1315,91 @@ toggle_autobracket(void)
         glconf.flags ^= FK_NOAUTOBRACKET;
 }
 
+// The symbol commands start the index on demand, but not over all of
+// / or $HOME (see main.c).
+static int
+symbols_available(ww *ed)
+{
+        if (!worth_indexing(".")) {
+                buffer_notify(ww_monitor(ed, ed->am), "no symbol index for / or $HOME");
+                return 0;
+        }
+
+        symindex_start(".");
+        return 1;
+}
+
+static void
+symbols(ww *ed)
+{
+        char         *inp;
+        const symbol *s;
+        const char   *label;
+
+        if (!symbols_available(ed))
+                return;
+
+        // What is there so far can be picked from right away.
+        label = symindex_ready() ? "symbols" : "symbols (indexing...)";
+
+        if (!(inp = minibuffer_input(ed, label, NULL, symindex_labels())))
+                return;
+
+        if ((s = symindex_from_label(inp)))
+                (void)jump_to_location(ed, s->path, (int)s->line, 1, ww_monitor(ed, ed->am));
+
+        free(inp);
+}
+
+static void
+goto_definition(ww *ed)
+{
+        buffer       *b = ww_monitor(ed, ed->am);
+        const symbol *defs;
+        size_t        n;
+        str           word;
+
+        if (!symbols_available(ed))
+                return;
+
+        word = buffer_word_at_cursor(b);
+        defs = word.len ? symindex_lookup(str_cstr(&word), &n) : NULL;
+        str_destroy(&word);
+
+        if (!defs) {
+                buffer_draw(b);
+                if (!symindex_ready())
+                        buffer_notify(b, "indexing...");
+                return;
+        }
+
+        if (n == 1) {
+                (void)jump_to_location(ed, defs->path, (int)defs->line, 1, b);
+                return;
+        }
+
+        // More than one, let the user pick.
+        cstr_ar cands = array_empty(cstr_ar);
+        char   *inp;
+
+        for (size_t i = 0; i < n; ++i)
+                array_append(cands, symindex_label(&defs[i]));
+
+        if ((inp = minibuffer_input(ed, "definition", NULL, cands))) {
+                for (size_t i = 0; i < n; ++i) {
+                        if (!strcmp(cands.data[i], inp)) {
+                                (void)jump_to_location(ed, defs[i].path, (int)defs[i].line, 1, b);
+                                break;
+                        }
+                }
+                free(inp);
+        }
+
+        for (size_t i = 0; i < n; ++i)
+                free(cands.data[i]);
+        array_free(cands);
+}
+
 static void
 metax(ww *ed)
 {
@@ -1314,13 +1415,13 @@ metax(ww *ed)
                 return;
 
         if (!strcmp(inp, WW_CMD_SAVE))
-                buffer_save(ed->monitors[ed->am]);
+                buffer_save(ww_monitor(ed, ed->am));
         else if (!strcmp(inp, WW_CMD_FIND_FILE))
                 find_file(ed);
         else if (!strcmp(inp, WW_CMD_COMPILE))
                 compile(ed);
         else if (!strcmp(inp, WW_CMD_SEARCH))
-                buffer_search(ed->monitors[ed->am], 0);
+                buffer_search(ww_monitor(ed, ed->am), 0);
         else if (!strcmp(inp, WW_CMD_TOGGLE_SPACEMODE))
                 toggle_spacemode();
         else if (!strcmp(inp, WW_CMD_SPACEAMT))
@@ -1331,12 +1432,17 @@ metax(ww *ed)
                 tutorial(ed);
         else if (!strcmp(inp, WW_CMD_HELP))
                 help(ed);
-        else if (!strcmp(inp, WW_CMD_QUIT))
+        else if (!strcmp(inp, WW_CMD_QUIT)) {
+                if (glconf.prelude.restore)
+                        session_save(ed);
                 exit(0);
+        }
         else if (!strcmp(inp, WW_CMD_MAN))
                 man(ed);
         else if (!strcmp(inp, WW_CMD_TOGGLE_AUTOBRACKET))
                 toggle_autobracket();
+        else if (!strcmp(inp, WW_CMD_SYMBOLS))
+                symbols(ed);
 #ifdef WITH_LLM
         else if (!strcmp(inp, WW_CMD_PROMPT))
                 switch_to_convo_buf(ed);
@@ -1349,239 +1455,162 @@ metax(ww *ed)
 static void
 close_builtin(ww *ed)
 {
-        if (ed->buffers.len <= 1)
+        if (ed->bufs.len <= 1)
                 return;
-        ed->monitors[ed->am] = ed->buffers.data[1];
+        ww_show(ed, ed->am, ed->bufs.mru->mru_next);
         sort_buffers(ed);
 }
 
-static buffer *
-get_random_nonopen_buffer(ww *ed)
-{
-        for (size_t i = 0; i < ed->buffers.len; ++i) {
-                const char *name  = ed->buffers.data[i]->name.chars;
-                int         found = 0;
-
-                for (int j = 0; j < 4; ++j) {
-                        if (ed->monitors[j] && !strcmp(name, ed->monitors[j]->name.chars)) {
-                                found = 1;
-                                break;
-                        }
-                }
-
-                if (!found)
-                        return ed->buffers.data[i];
-        }
-
-        return NULL;
-}
-
 static void
 kill_current_buffer(ww *ed)
 {
-        size_t  idx;
+        buffer *dead = ww_monitor(ed, ed->am);
         buffer *b;
 
-        idx = (size_t)get_buffer_by_path(ed, ed->monitors[ed->am]->path.chars);
+        bufreg_remove(&ed->bufs, dead);
 
-        array_rm_at(ed->buffers, idx);
-
-        if (ed->buffers.len == 0) {
-                buffer_free(ed->monitors[ed->am]);
-                ed->monitors[ed->am] = NULL;
+        if (ed->bufs.len == 0) {
+                replace_dead(ed, dead, NULL);
+                buffer_free(dead);
                 return;
         }
 
         if (!(b = get_random_nonopen_buffer(ed))) {
-                idx = (size_t)get_buffer_by_path(ed, ed->monitors[0]->path.chars);
-                buffer_free(ed->monitors[ed->am]);
-                ed->monitors[ed->am] = NULL;
-                ww_make_buffer_primary(ed, idx);
+                b = ww_monitor(ed, 0) != dead ? ww_monitor(ed, 0) : ed->bufs.mru;
+                replace_dead(ed, dead, NULL);
+                buffer_free(dead);
+                ww_make_buffer_primary(ed, b);
                 return;
         }
 
-        buffer_free(ed->monitors[ed->am]);
-        ed->monitors[ed->am] = b;
+        replace_dead(ed, dead, b);
+        buffer_free(dead);
+        ww_show(ed, ed->am, b);
 }
 
 static void
 switch_to_compilation_buffer(ww *ed)
 {
-        for (size_t i = 0; i < ed->buffers.len; ++i) {
-                if (!strcmp(str_cstr(&ed->buffers.data[i]->name),
-                            BUFFER_BUILTIN_COMPILE)) {
-                        ed->monitors[ed->am] = ed->buffers.data[i];
-                        sort_buffers(ed);
-                        return;
-                }
+        buffer *b;
+
+        if ((b = get_buffer_by_name(ed, BUFFER_BUILTIN_COMPILE))) {
+                ww_show(ed, ed->am, b);
+                sort_buffers(ed);
         }
 }
 
 static int
-try_jump_to_error(ww *ed, buffer *compilation)
+jump_to_location(ww         *ed,
+                 const char *filename,
+                 int         row,
+                 int         col,
+                 buffer     *from)
 {
-        const line *ln       = NULL;
-        char       *filename = NULL;
-        int         row      = -1;
-        int         col      = -1;
-        buffer     *ab       = compilation ? compilation : ed->monitors[ed->am];
-
-        if (!ab || ab->al >= ab->lines.len)
-                return 0;
-
-        ln = ab->lines.data[ab->al];
-
-        regex_t regex;
-        regmatch_t matches[5];
-
-        const char *gcc_pattern = "([^[:space:]:]+):([0-9]+):([0-9]+):";
-        if (regcomp(&regex, gcc_pattern, REG_EXTENDED) == 0) {
-                if (regexec(&regex, ln->txt.chars, 4, matches, 0) == 0) {
-                        int fname_len = matches[1].rm_eo - matches[1].rm_so;
-                        filename = malloc((size_t)fname_len + 1);
-                        if (filename) {
-                                memcpy(filename, ln->txt.chars + matches[1].rm_so, (size_t)fname_len);
-                                filename[fname_len] = '\0';
-                                row = atoi(ln->txt.chars + matches[2].rm_so);
-                                col = atoi(ln->txt.chars + matches[3].rm_so);
-                        }
-                }
-                regfree(&regex);
-        }
-
-        if (!filename) {
-                const char *py_pattern = "File \"([^\"]+)\", line ([0-9]+)";
-                if (regcomp(&regex, py_pattern, REG_EXTENDED) == 0) {
-                        if (regexec(&regex, ln->txt.chars, 3, matches, 0) == 0) {
-                                int fname_len = matches[1].rm_eo - matches[1].rm_so;
-                                filename = malloc((size_t)fname_len + 1);
-                                if (filename) {
-                                        memcpy(filename, ln->txt.chars + matches[1].rm_so, (size_t)fname_len);
-                                        filename[fname_len] = '\0';
-                                        row = atoi(ln->txt.chars + matches[2].rm_so);
-                                        col = 0;                    // Python rarely gives column
-                                }
-                        }
-                        regfree(&regex);
-                }
-        }
-
-        if (!filename) {
-                const char *py_caret_pattern = "File \"([^\"]+)\", line ([0-9]+),";
-                if (regcomp(&regex, py_caret_pattern, REG_EXTENDED) == 0) {
-                        if (regexec(&regex, ln->txt.chars, 3, matches, 0) == 0) {
-                                int fname_len = matches[1].rm_eo - matches[1].rm_so;
-                                filename = malloc((size_t)fname_len + 1);
-                                if (filename) {
-                                        memcpy(filename, ln->txt.chars + matches[1].rm_so, (size_t)fname_len);
-                                        filename[fname_len] = '\0';
-                                        row = atoi(ln->txt.chars + matches[2].rm_so);
-                                        col = 0;
-                                }
-                        }
-                        regfree(&regex);
-                }
-        }
-
-        if (!filename || row == -1) {
-                if (filename) free(filename);
-                buffer_draw(ab);
-                return 0;
-        }
-
         char *real = get_realpath(filename);
-        if (!real) {
-                free(filename);
-                buffer_draw(ab);
+
+        if (!real || row <= 0) {
+                free(real);
+                buffer_draw(from);
                 return 0;
         }
 
-        buffer *b = NULL;
-        if (!ww_buffer_exists_by_path(ed, real)) {
-                b = buffer_from(str_from(filename), str_from(real),
+        buffer *b = get_buffer_by_path(ed, real);
+        if (!b) {
+                b = buffer_load(str_from(filename), str_from(real),
                                 (unsigned)glconf.term.w, (unsigned)glconf.term.h,
-                                0, 0, lines_from(load_file(real)), ed);
+                                0, 0, ed);
                 ww_add_buffer(ed, b);
-        } else {
-                b = ed->buffers.data[(size_t)get_buffer_by_path(ed, real)];
         }
 
         int found_buffer = -1;
-        for (size_t i = 0; i < 4; ++i) {
-                if (ed->monitors[i] && !strcmp(ed->monitors[i]->path.chars, real)) {
+        for (size_t i = 0; i < ed->panes.len; ++i) {
+                if (ww_monitor(ed, i) && !strcmp(ww_monitor(ed, i)->path.chars, real)) {
                         found_buffer = (int)i;
                         break;
                 }
         }
 
         if (found_buffer == -1)
-                ed->monitors[ed->am] = b;
+                ww_show(ed, ed->am, b);
         else
-                ed->am = (uint8_t)found_buffer;
+                buffer_view_use(ed->panes.data[ed->am = (size_t)found_buffer]->view);
 
-        buffer_jump_to_verts(ed->monitors[ed->am], (size_t)(col > 0 ? col-1 : 0), (size_t)row-1);
+        buffer_jump_to_verts(ww_monitor(ed, ed->am), (size_t)(col > 0 ? col-1 : 0), (size_t)row-1);
 
-        free(filename);
         free(real);
-        buffer_draw(ed->monitors[ed->am]);
+        buffer_draw(ww_monitor(ed, ed->am));
         sort_buffers(ed);
 
         return 1;
 }
 
+static int
+try_jump_to_error(ww *ed, buffer *compilation)
+{
+        buffer     *ab = compilation ? compilation : ww_monitor(ed, ed->am);
+        const diag *d  = NULL;
+        diag        parsed;
+        int         ok;
+
+        if (!ab || ab->v->al >= ab->lines.len)
+                return 0;
+
+        if (!strcmp(ab->name.chars, BUFFER_BUILTIN_COMPILE)) {
+                if (!(d = diag_index_at_bufline(&g_compile_diags, ab->v->al))) {
+                        buffer_draw(ab);
+                        return 0;
+                }
+                return jump_to_location(ed, d->file, d->row, d->col, ab);
+        }
+
+        if (!diag_parse_line(ab->lines.data[ab->v->al]->txt.chars, &parsed)) {
+                buffer_draw(ab);
+                return 0;
+        }
+
+        ok = jump_to_location(ed, parsed.file, parsed.row, parsed.col, ab);
+        diag_free(&parsed);
+
+        return ok;
+}
+
 static void
 jmp_next_error(ww *ed, int prev)
 {
-        buffer  *b;
-        ssize_t  idx;
-        size_t   old_al;
+        buffer     *b;
+        const diag *d;
+        size_t      src;
+        size_t      out;
 
-        if ((idx = get_buffer_by_path(ed, BUFFER_BUILTIN_COMPILE)) == -1)
+        if (!(b = get_buffer_by_path(ed, BUFFER_BUILTIN_COMPILE)))
                 return;
-        else
-                b = ed->buffers.data[(size_t)idx];
-
-        old_al = b->al;
 
-        if (!prev) {
-                b->al = (b->al+1) % b->lines.len;
-                b->cy = (b->cy+1) % (unsigned)b->lines.len;
-        } else {
-                if (b->al == 0)
-                        b->al = b->lines.len;
-                if (b->cy == 0)
-                        b->cy = (unsigned)b->lines.len;
-                --b->al;
-                --b->cy;
-        }
+        if (!(d = diag_index_step(&g_compile_diags, b->v->al, prev)))
+                return;
 
-        do {
-                if (try_jump_to_error(ed, b))
-                        break;
+        b->v->al = diag_index_bufline(&g_compile_diags, d);
+        b->v->cy = (unsigned)b->v->al;
+        b->v->cx = 0;
 
-                if (!prev) {
-                        b->al = (b->al+1) % b->lines.len;
-                        b->cy = (b->cy+1) % (unsigned)b->lines.len;
-                } else {
-                        if (b->al == 0)
-                                b->al = b->lines.len;
-                        if (b->cy == 0)
-                                b->cy = (unsigned)b->lines.len;
-                        --b->al;
-                        --b->cy;
-                }
-        } while (b->al != old_al);
+        (void)jump_to_location(ed, d->file, d->row, d->col, b);
 
-        ed->monitors[0] = ed->monitors[ed->am];
-        ed->monitors[2] = b;
+        // The output stays in view in a pane of its own, below the source
+        // unless it is on screen already.
+        src = ed->am;
 
-        buffer_center_view(ed->monitors[0]);
-        buffer_center_view(ed->monitors[2]);
+        for (out = 0; out < ed->panes.len; ++out)
+                if (out != src && ww_monitor(ed, out) == b)
+                        break;
 
-        buffer_adjust_scroll(ed->monitors[0]);
-        buffer_adjust_scroll(ed->monitors[2]);
+        if (out < ed->panes.len || split(ed, LAYOUT_ROWS, b)) {
+                out = out < ed->panes.len ? out : ed->am;
+                buffer_center_view(ww_show(ed, out, b));
+                buffer_adjust_scroll(b);
+        }
 
-        ed->am = 0;
+        ed->am = src;
+        buffer_center_view(buffer_view_use(ed->panes.data[src]->view));
+        buffer_adjust_scroll(ww_monitor(ed, src));
 
         sort_buffers(ed);
 }
@@ -1593,8 +1622,7 @@ maybe_exit(ww *ed)
         str msg = str_from(BOLD "You have unsaved buffers, really exit?\n");
         str_concat(&msg, "The following have unsaved changes" RESET ":\n");
 
-        for (size_t i = 0; i < ed->buffers.len; ++i) {
-                const buffer *b = ed->buffers.data[i];
+        for (const buffer *b = ed->bufs.mru; b; b = b->mru_next) {
                 if (!b->saved) {
                         ok = 0;
                         str_concat(&msg, BOLD RED "*" RESET " ");
@@ -1627,17 +1655,19 @@ ww_run(ww *ed)
 
         signal(SIGWINCH, resize_signal_handler);
 
-        ed->monitors[ed->am]->al = glconf.prelude.start_row-1;
-        ed->monitors[ed->am]->cy = (unsigned)glconf.prelude.start_row-1;
-        buffer_adjust_scroll(ed->monitors[ed->am]);
-        buffer_center_view(ed->monitors[ed->am]);
+        if (glconf.prelude.start_row > 0) {
+                ww_monitor(ed, ed->am)->v->al = glconf.prelude.start_row-1;
+                ww_monitor(ed, ed->am)->v->cy = (unsigned)glconf.prelude.start_row-1;
+                buffer_adjust_scroll(ww_monitor(ed, ed->am));
+                buffer_center_view(ww_monitor(ed, ed->am));
+        }
 
         ww_display_monitors(ed, BA_REDRAW);
-        //gotoxy(0, ed->monitors[ed->am]->cy);
+        //gotoxy(0, ww_monitor(ed, ed->am)->v->cy);
         fflush(stdout);
 
-        while (ed->monitors[0]) {
-                assert(ed->am < 4);
+        while (ww_monitor(ed, 0)) {
+                assert(ed->am < ed->panes.len);
 
                 handle_resize(ed);
 
@@ -1645,33 +1675,39 @@ ww_run(ww *ed)
                 poll_llm_response(ed);
 #endif
 
-                buffer *b = ed->monitors[ed->am];
+                buffer *b = ww_monitor(ed, ed->am);
                 buffer_action act = buffer_process(b);
 
                 if (act == BA_REQ_EXIT) {
-                        if (maybe_exit(ed))
+                        if (maybe_exit(ed)) {
+                                // Only a session that was asked for is kept.
+                                if (glconf.prelude.restore)
+                                        session_save(ed);
                                 break;
+                        }
+                        damage_all(ed);
                         act = BA_REDRAW;
                 }
                 else if (act == BA_REQ_FINDFILE)     find_file(ed);
                 else if (act == BA_REQ_SWITCHBUFFER) ww_switch_buffer(ed);
                 else if (act == BA_REQ_MAXIMIZEMON)
-                        ww_make_buffer_primary_by_name(ed, ed->monitors[ed->am]->name.chars);
+                        ww_make_buffer_primary_by_name(ed, ww_monitor(ed, ed->am)->name.chars);
                 else if (act == BA_REQ_METAX) {
                         metax(ed);
-                        buffer_draw(ed->monitors[ed->am]);
+                        buffer_draw(ww_monitor(ed, ed->am));
                 }
-                else if (act == BA_REQ_SPLITVER)      split_vertical(ed);
+                else if (act == BA_REQ_SPLITVER)      (void)split(ed, LAYOUT_COLS, NULL);
                 else if (act == BA_REQ_JMPBUF)        jump_buffer(ed);
                 else if (act == BA_REQ_COMPILE)       compile(ed);
                 else if (act == BA_REQ_RECOMPILE)     do_compilation(ed);
                 else if (act == BA_REQ_CLOSE_BUILTIN) close_builtin(ed);
-                else if (act == BA_REQ_SPLITHOR)      split_horizontal(ed);
+                else if (act == BA_REQ_SPLITHOR)      (void)split(ed, LAYOUT_ROWS, NULL);
                 else if (act == BA_REQ_KILLBUF)       kill_current_buffer(ed);
                 else if (act == BA_REQ_SWITCHCOMPL)   switch_to_compilation_buffer(ed);
                 else if (act == BA_REQ_ERRJMP)        (void)try_jump_to_error(ed, NULL);
                 else if (act == BA_REQ_NEXTERROR)     jmp_next_error(ed, 0);
                 else if (act == BA_REQ_PREVERROR)     jmp_next_error(ed, 1);
+                else if (act == BA_REQ_GOTODEF)       goto_definition(ed);
 #ifdef WITH_LLM
                 else if (act == BA_REQ_CONVO)
                         send_to_model(ed);